@@ -0,0 +1,83 @@
+#pragma once
+#include "LLMProvider.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ai_chat_sdk
+{
+    // 批处理配置
+    struct BatchOptions
+    {
+        size_t _concurrency = 8;          // 同时在途的请求数
+        bool _ordered = true;             // true：按输入顺序写出结果 (在线模式暂存乱序到达的结果；续跑与 Batch API 模式结束时对输出文件做外部排序)
+        size_t _reorderWindow = 0;        // 有序写出时，读取位置最多领先已写出位置多少行 (0 表示 _concurrency * 64)
+        bool _resume = true;              // 输出文件已存在时跳过其中已完成的行
+        bool _retryFailed = true;         // 续跑时重新执行上次失败的行
+        int _maxAttempts = 3;             // 单行最多尝试次数 (模型返回空串视为失败)
+        int _retryBackoffMs = 500;        // 重试间隔，按尝试次数线性增长
+        int64_t _requestTimeoutMs = 0;    // 单行的总预算 (含所有重试与退避)，0 表示不限；通过 timeout_ms 传给 Provider
+        size_t _syncEvery = 64;           // 每写出多少行 fsync 一次输出文件 (断点)
+        double _progressIntervalSec = 10; // 进度日志间隔
+
+        // OpenAI Batch API (/v1/files + /v1/batches)：整批上传，服务端异步执行，成本更低但延迟以小时计
+        bool _useBatchApi = false;
+        std::string _batchEndpoint = "https://api.openai.com";
+        std::string _apiKey;
+        std::string _model;                 // 为空时使用 provider->getModelName()
+        std::string _transport = "httplib"; // 传输层名称，同 initModel 的 transport
+        int _pollIntervalSec = 30;          // 轮询批任务状态的间隔
+    };
+
+    // 批处理结果统计
+    struct BatchReport
+    {
+        uint64_t _total = 0;     // 输入中的有效行数
+        uint64_t _skipped = 0;   // 续跑时跳过的已完成行
+        uint64_t _succeeded = 0; // 本次成功的行
+        uint64_t _failed = 0;    // 本次失败的行 (含无法解析的输入)
+        uint64_t _cancelled = 0; // 因取消未完成、下次续跑会重新执行的行
+        int64_t _promptTokens = 0;
+        int64_t _completionTokens = 0;
+        double _elapsedSec = 0;
+
+        double requestsPerSec() const { return _elapsedSec > 0 ? (_succeeded + _failed) / _elapsedSec : 0.0; }
+        double tokensPerSec() const { return _elapsedSec > 0 ? (_promptTokens + _completionTokens) / _elapsedSec : 0.0; }
+    };
+
+    /**
+     * @brief JSONL 批处理：流式读取输入、有界并发调用模型、按序或乱序写出结果，支持断点续跑
+     *
+     * 输入每行一个 JSON 对象：
+     *   {"id": "可选，原样写回", "messages": [{"role": "user", "content": "..."}], "params": {"temperature": 0}}
+     *   或简写 {"id": "...", "prompt": "...", "system": "可选"}
+     * 输出每行一个 JSON 对象：
+     *   {"index": 行号, "id": "...", "ok": true, "content": "...", "usage": {...}}
+     *   失败时 {"index": 行号, "id": "...", "ok": false, "error": "..."}
+     * 行号为输入中非空行的序号 (从 0 开始)，续跑时以它识别已完成的行，因此续跑前不能修改输入文件。
+     * 有序模式下，被取消的运行只保证本次写出的部分有序；续跑完成后整个输出文件按行号重排。
+     *
+     * 读取、请求、写出在不同线程中流水执行，读取受在途请求数约束，任意时刻内存中只有有限行。
+     */
+    class BatchRunner
+    {
+    public:
+        BatchRunner(std::shared_ptr<LLMProvider> provider, const BatchOptions &options = BatchOptions());
+
+        // 执行批处理，阻塞到全部完成或被取消
+        // 返回 false 表示无法打开输入 / 输出文件或 Batch API 调用失败；单行失败只计入 report._failed
+        bool run(const std::string &inputFile, const std::string &outputFile, BatchReport &report,
+                 CancelTokenPtr cancelToken = nullptr);
+
+    private:
+        bool runOnline(const std::string &inputFile, const std::string &outputFile, BatchReport &report,
+                       const CancelTokenPtr &cancelToken);
+        bool runBatchApi(const std::string &inputFile, const std::string &outputFile, BatchReport &report,
+                         const CancelTokenPtr &cancelToken);
+
+    private:
+        std::shared_ptr<LLMProvider> _provider;
+        BatchOptions _options;
+    };
+
+} // end ai_chat_sdk
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace ai_chat_sdk
+{
+    // 取消令牌：由调用方持有，可在任意线程调用 cancel() 中止正在进行的请求
+    class CancelToken
+    {
+    public:
+        // 请求取消 (可重复调用，只有第一次生效)
+        void cancel();
+        // 是否已被取消
+        bool isCancelled() const;
+
+        // 注册取消回调 (用于打断阻塞中的网络读写)，若已取消则立即执行且不再登记
+        // 回调 (包括注册时立即执行的情况) 都在令牌内部锁中执行，每个回调最多执行一次，不能在回调里再访问该令牌
+        // 返回值为回调ID，用于 removeHook
+        uint64_t addHook(std::function<void()> hook);
+        // 注销取消回调
+        void removeHook(uint64_t hookId);
+
+        // 全局统计：因取消而提前结束的请求数
+        static uint64_t cancelledRequests();
+        // 请求因取消而结束时由 Provider 调用
+        static void recordCancelledRequest();
+
+    private:
+        std::atomic<bool> _cancelled{false};
+        std::mutex _mutex;
+        std::map<uint64_t, std::function<void()>> _hooks; // 回调ID -> 取消回调
+        uint64_t _nextHookId = 1;
+
+        static std::atomic<uint64_t> _cancelledRequests;
+    };
+
+    using CancelTokenPtr = std::shared_ptr<CancelToken>;
+
+    // 取消回调的 RAII 守卫：析构时自动注销，保证回调不会在请求结束后被触发
+    class CancelHookGuard
+    {
+    public:
+        CancelHookGuard(const CancelTokenPtr &token, std::function<void()> hook)
+            : _token(token)
+        {
+            if (_token)
+            {
+                _hookId = _token->addHook(std::move(hook));
+            }
+        }
+
+        ~CancelHookGuard()
+        {
+            if (_token)
+            {
+                _token->removeHook(_hookId);
+            }
+        }
+
+        CancelHookGuard(const CancelHookGuard &) = delete;
+        CancelHookGuard &operator=(const CancelHookGuard &) = delete;
+
+    private:
+        CancelTokenPtr _token;
+        uint64_t _hookId = 0;
+    };
+
+} // end ai_chat_sdk
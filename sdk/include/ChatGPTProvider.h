@@ -29,12 +29,14 @@ namespace ai_chat_sdk
 
         // 发送消息 - 全量返回
         virtual std::string sendMessage(const std::vector<Message> &messages,
-                                        const std::map<std::string, std::string> &requestParam) override;
+                                        const std::map<std::string, std::string> &requestParam,
+                                        CancelTokenPtr cancelToken = nullptr, TokenUsage *usage = nullptr) override;
 
         // 发送消息 - 增量返回 - 流式响应
         virtual std::string sendMessageStream(const std::vector<Message> &messages,
                                               const std::map<std::string, std::string> &requestParam,
-                                              std::function<void(const std::string &, bool)> callback) override;
+                                              std::function<void(const std::string &, bool)> callback,
+                                              CancelTokenPtr cancelToken = nullptr, TokenUsage *usage = nullptr) override;
     };
 
 } // namespace ai_chat_sdk
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+#include <sys/types.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace ai_chat_sdk
+{
+    /**
+     * @brief 消息内容的外部数据源
+     *
+     * 大文档 (文档问答中动辄数 MB) 通过 Message::_contentSource 按引用挂到消息上，
+     * 发送时由 StreamingBody 分块读取并即时做 JSON 转义，内存中不保留完整副本。
+     * 实现必须支持从任意偏移重复读取 (重试、请求合并)，并允许多个线程同时读取。
+     */
+    class ContentSource
+    {
+    public:
+        virtual ~ContentSource() = default;
+
+        // 从 offset 开始最多读取 len 字节到 buf，返回实际字节数，0 表示结束，-1 表示出错
+        virtual ssize_t read(uint64_t offset, char *buf, size_t len) const = 0;
+        // 总字节数，未知时返回 -1
+        virtual int64_t size() const = 0;
+        // 内容标识，参与请求合并与缓存的 key：内容相同的源返回相同的标识
+        virtual std::string identity() const = 0;
+        // 内容位于连续内存 (如映射文件) 时返回起始地址，读取方可以跳过一次复制
+        virtual const char *data() const { return nullptr; }
+        // 直接访问 data() 的 [0, end) 之前调用：底层数据已被截断时返回 false，读取方应放弃读取
+        virtual bool dataValid(uint64_t /*end*/) const { return true; }
+    };
+
+    using ContentSourcePtr = std::shared_ptr<const ContentSource>;
+
+    // 只读映射的文件：页面按需换入，常驻内存随读取进度变化，与文件大小无关
+    // 发送期间文件被截断时，读取在访问已失效的页面之前失败 (返回 -1)，不会触发 SIGBUS；
+    // 原地改写 (大小不变) 的内容会被读到但无法察觉，附加的文件在请求结束前不应原地修改
+    class MappedFileSource : public ContentSource
+    {
+    public:
+        // 打开并映射文件，失败 (不存在、无权限、不是普通文件) 时记录错误并返回 nullptr
+        static std::shared_ptr<MappedFileSource> open(const std::string &path);
+        ~MappedFileSource();
+
+        MappedFileSource(const MappedFileSource &) = delete;
+        MappedFileSource &operator=(const MappedFileSource &) = delete;
+
+        virtual ssize_t read(uint64_t offset, char *buf, size_t len) const override;
+        virtual int64_t size() const override { return static_cast<int64_t>(_size); }
+        // 路径 + 大小 + 修改时间，文件被改写后标识随之变化
+        virtual std::string identity() const override;
+        virtual const char *data() const override { return _data; }
+        // 重新检查文件大小，文件仍不短于 end 时返回 true
+        virtual bool dataValid(uint64_t end) const override;
+
+        std::string_view view() const { return std::string_view(_data, _size); }
+
+    private:
+        MappedFileSource() = default;
+
+    private:
+        std::string _path;
+        const char *_data = nullptr; // 空文件时为 nullptr
+        size_t _size = 0;
+        int64_t _mtimeNs = 0;
+        int _fd = -1; // 保持打开，用于检查文件是否被截断
+    };
+
+    // 由回调分块产生的内容，例如分段读取对象存储或数据库中的文档
+    class CallbackSource : public ContentSource
+    {
+    public:
+        // 语义同 ContentSource::read，会被并发、重复调用
+        using Reader = std::function<ssize_t(uint64_t offset, char *buf, size_t len)>;
+
+        // identity 为空时使用对象地址，此时不同实例之间不会合并或命中缓存
+        explicit CallbackSource(Reader reader, int64_t size = -1, std::string identity = "");
+
+        virtual ssize_t read(uint64_t offset, char *buf, size_t len) const override;
+        virtual int64_t size() const override { return _size; }
+        virtual std::string identity() const override;
+
+    private:
+        Reader _reader;
+        int64_t _size;
+        std::string _identity;
+    };
+
+    // 把数据源的全部内容读入字符串 (无法流式发送时的回退路径)，读取失败返回 false
+    bool readAll(const ContentSource &source, std::string &out);
+
+} // end ai_chat_sdk
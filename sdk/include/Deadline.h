@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include "CancelToken.h"
+#include "transport/HttpTransport.h"
+
+namespace ai_chat_sdk
+{
+    // 单次请求的超时策略，单位毫秒，0 表示不限制
+    struct TimeoutPolicy
+    {
+        int64_t _totalMs = 0;       // 总预算：从调用开始到返回，调用方的 SLA
+        int64_t _connectMs = 30000; // 建立连接 (含代理与 TLS 握手)
+        int64_t _firstTokenMs = 0;  // 流式：请求发出到第一个内容增量，用于尽早放弃慢上游
+        int64_t _idleMs = 60000;    // 两次收到数据之间的最长间隔
+    };
+
+    // 用 timeout_ms / connect_timeout_ms / first_token_timeout_ms / idle_timeout_ms 覆盖 policy 中的对应项
+    // 配置 (initModel) 与请求参数 (requestParam) 使用同一组名称
+    void applyTimeoutParams(const std::map<std::string, std::string> &params, TimeoutPolicy &policy);
+    // 是否为超时参数 (不发给模型、不参与缓存键)
+    bool isTimeoutParam(const std::string &name);
+
+    /**
+     * @brief 一次请求的截止时间监视
+     *
+     * 构造时开始计时，由进程内共享的监视线程检查总预算、首 token 与空闲超时，
+     * 任一超时就取消 token()；调用方的 cancelToken 被取消时 token() 同样被取消。
+     * Provider 把 token() 交给传输层，并用 apply() 把剩余预算写入 HttpRequest。
+     */
+    class RequestDeadline
+    {
+    public:
+        RequestDeadline(const TimeoutPolicy &policy, const CancelTokenPtr &cancelToken);
+        ~RequestDeadline();
+
+        RequestDeadline(const RequestDeadline &) = delete;
+        RequestDeadline &operator=(const RequestDeadline &) = delete;
+
+        // 传给传输层的取消令牌
+        const CancelTokenPtr &token() const;
+        // 写入连接超时、读空闲超时 (秒，向上取整)、绝对截止时间与上传进度回调 (刷新空闲计时)
+        void apply(HttpRequest &request) const;
+
+        // 收到任意数据：刷新空闲计时 (流式与非流式响应都应调用)
+        void onData();
+        // 收到第一个内容增量：此后不再检查首 token 超时
+        void onFirstToken();
+
+        // 传输失败 (transferOk 为 false) 且因超时中止时返回原因
+        // ("deadline exceeded" / "first token timeout" / "idle timeout")，否则返回 nullptr
+        // 传输成功时总是返回 nullptr：截止时间边缘完整收到的响应不丢弃
+        const char *expired(bool transferOk) const;
+        // 总预算剩余毫秒数，不限制时返回 INT64_MAX
+        int64_t remainingMs() const;
+
+        // 全局统计：因超时而提前结束的请求数
+        static uint64_t timedOutRequests();
+
+    public:
+        struct State;
+
+    private:
+        std::shared_ptr<State> _state;
+        std::unique_ptr<CancelHookGuard> _parentGuard; // 调用方取消时转发到 token()
+    };
+
+} // end ai_chat_sdk
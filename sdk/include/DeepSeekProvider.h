@@ -3,6 +3,7 @@
 #include <functional>
 #include <string>
 #include <map>
+#include <memory_resource>
 #include <vector>
 #include "common.h"
 
@@ -21,10 +22,23 @@ namespace ai_chat_sdk
         // 获取模型描述
         virtual std::string getModelDesc() const;
         // 发送消息 - 全量返回
-        virtual std::string sendMessage(const std::vector<Message> &messages, const std::map<std::string, std::string> &requestParam);
+        virtual std::string sendMessage(const std::vector<Message> &messages, const std::map<std::string, std::string> &requestParam,
+                                        CancelTokenPtr cancelToken = nullptr, TokenUsage *usage = nullptr);
         // 发送消息 - 增量返回 - 流式响应
         virtual std::string sendMessageStream(const std::vector<Message> &messages,
                                               const std::map<std::string, std::string> &requestParam,
-                                              std::function<void(const std::string &, bool)> callback); // callback: 对模型返回的增量数据如何处理，第一个参数为增量数据，第二个参数为是否为最后一个增量数据
+                                              std::function<void(const std::string &, bool)> callback, // callback: 对模型返回的增量数据如何处理，第一个参数为增量数据，第二个参数为是否为最后一个增量数据
+                                              CancelTokenPtr cancelToken = nullptr, TokenUsage *usage = nullptr);
+        // 发送消息 - 增量返回 - 异步：reactor 传输下 SSE 解析与回调都在事件循环线程上执行
+        virtual void sendMessageStreamAsync(const std::vector<Message> &messages,
+                                            const std::map<std::string, std::string> &requestParam,
+                                            std::function<void(const std::string &, bool)> callback,
+                                            StreamCompletion onComplete, CancelTokenPtr cancelToken = nullptr);
+
+    private:
+        // 构造流式请求 (请求体、请求头)，请求体无法完整构造时返回 false
+        bool buildStreamRequest(const ProviderConfig &snapshot, const std::vector<Message> &messages,
+                                const std::map<std::string, std::string> &requestParam,
+                                std::pmr::memory_resource *resource, HttpRequest &request) const;
     };
 } // end ai_chat_sdk
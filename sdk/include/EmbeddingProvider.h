@@ -0,0 +1,62 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "CancelToken.h"
+#include "transport/HttpTransport.h"
+
+namespace ai_chat_sdk
+{
+    // 文本向量化接口 (语义缓存使用)
+    class EmbeddingProvider
+    {
+    public:
+        virtual ~EmbeddingProvider() = default;
+
+        // 计算 text 的向量，长度为 dimension()；失败返回 false
+        virtual bool embed(const std::string &text, std::vector<float> &vector, CancelTokenPtr cancelToken = nullptr) = 0;
+        // 向量维度
+        virtual size_t dimension() const = 0;
+        // 名称，写入快照用于校验 (不同模型的向量不能混用)
+        virtual std::string name() const = 0;
+    };
+
+    using EmbeddingProviderPtr = std::shared_ptr<EmbeddingProvider>;
+
+    // OpenAI 兼容的 /v1/embeddings 接口
+    class OpenAIEmbeddingProvider : public EmbeddingProvider
+    {
+    public:
+        // dimension 通过 dimensions 参数传给服务端 (text-embedding-3 系列支持截断为更短的向量)
+        OpenAIEmbeddingProvider(const std::string &endpoint, const std::string &apiKey,
+                                const std::string &model = "text-embedding-3-small", size_t dimension = 1536,
+                                const std::string &transport = "httplib");
+
+        virtual bool embed(const std::string &text, std::vector<float> &vector, CancelTokenPtr cancelToken = nullptr) override;
+        virtual size_t dimension() const override { return _dimension; }
+        virtual std::string name() const override { return "openai:" + _model + ":" + std::to_string(_dimension); }
+
+    private:
+        std::string _apiKey;
+        std::string _model;
+        size_t _dimension;
+        HttpTransportPtr _transport;
+    };
+
+    // 本地哈希向量：字符 n-gram 特征哈希到固定维度 (feature hashing)
+    // 不需要网络，结果确定；字面相近的改写 (增删个别字词、标点、大小写) 相似度高，
+    // 适合测试以及对召回要求不高的场景，真正的同义改写需要语义模型
+    class HashEmbeddingProvider : public EmbeddingProvider
+    {
+    public:
+        explicit HashEmbeddingProvider(size_t dimension = 256);
+
+        virtual bool embed(const std::string &text, std::vector<float> &vector, CancelTokenPtr cancelToken = nullptr) override;
+        virtual size_t dimension() const override { return _dimension; }
+        virtual std::string name() const override { return "hash:" + std::to_string(_dimension); }
+
+    private:
+        size_t _dimension;
+    };
+
+} // end ai_chat_sdk
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace ai_chat_sdk
+{
+    /**
+     * @brief 内存中的 HNSW (Hierarchical Navigable Small World) 近似最近邻索引
+     *
+     * 距离为 1 - 余弦相似度，写入的向量必须已归一化。
+     * 节点以槽位号 (0 ~ capacity-1) 标识，由调用方分配；删除只打标记，
+     * 之后向同一槽位写入新向量时先断开旧连接再重新插入，因此内存上限由 capacity 决定。
+     * 非线程安全：调用方负责加锁 (search 可并发，add / remove 需独占)。
+     */
+    class HnswIndex
+    {
+    public:
+        // m：每层的最大连接数 (第 0 层为 2m)；efConstruction：插入时的候选集大小
+        HnswIndex(size_t dimension, size_t capacity, size_t m = 16, size_t efConstruction = 200, unsigned seed = 100);
+
+        // 写入槽位 slot，已有向量时替换
+        void add(uint32_t slot, const float *vector);
+        // 删除槽位 (标记删除，仍参与图遍历，不出现在结果中)
+        void remove(uint32_t slot);
+
+        // 返回最近的 k 个 (距离, 槽位)，按距离升序；ef 为搜索候选集大小 (不小于 k)
+        std::vector<std::pair<float, uint32_t>> search(const float *query, size_t k, size_t ef) const;
+
+        const float *vector(uint32_t slot) const { return &_vectors[static_cast<size_t>(slot) * _dimension]; }
+        bool contains(uint32_t slot) const { return slot < _nodes.size() && _nodes[slot]._level >= 0 && !_nodes[slot]._deleted; }
+        size_t size() const { return _size; }
+        size_t dimension() const { return _dimension; }
+        size_t capacity() const { return _capacity; }
+        // 向量与邻接表占用的字节数 (估算)
+        size_t memoryBytes() const;
+
+    private:
+        struct Node
+        {
+            int _level = -1; // -1 表示槽位从未使用
+            bool _deleted = false;
+            std::vector<std::vector<uint32_t>> _links; // 每层的邻居
+        };
+        using Candidate = std::pair<float, uint32_t>; // (距离, 槽位)
+
+        float distance(const float *query, uint32_t slot) const;
+        int randomLevel();
+        // 在 level 层从 entries 出发做贪心 + 候选集搜索，返回最多 ef 个最近节点 (含已删除节点)
+        std::vector<Candidate> searchLayer(const float *query, const std::vector<Candidate> &entries, size_t ef, int level) const;
+        // 启发式选邻居：优先保留彼此不相近的候选，使图在不同方向上都有出边
+        std::vector<uint32_t> selectNeighbors(std::vector<Candidate> candidates, size_t maxCount) const;
+        // 断开槽位的出边以及邻居指向它的边
+        void unlink(uint32_t slot);
+        // 重新选择入口节点 (入口被替换时)
+        void resetEntryPoint(uint32_t excluded);
+
+    private:
+        size_t _dimension;
+        size_t _capacity;
+        size_t _m;
+        size_t _maxM0;
+        size_t _efConstruction;
+        double _levelMult;
+        std::mt19937 _rng;
+
+        std::vector<float> _vectors; // 按槽位连续存放
+        std::vector<Node> _nodes;
+        int64_t _entryPoint = -1;
+        int _maxLevel = -1;
+        size_t _size = 0; // 未删除的节点数
+    };
+
+} // end ai_chat_sdk
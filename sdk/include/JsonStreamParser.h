@@ -0,0 +1,158 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ai_chat_sdk
+{
+    enum class JsonEventType
+    {
+        BeginObject,
+        EndObject,  // 对象已完整结束
+        BeginArray,
+        EndArray,   // 数组已完整结束
+        StringPart, // 字符串值的新增片段：每个输入块最多一次，字符串结束时再补最后一段
+        Value,      // 完整的标量值 (字符串、数字、true / false、null)
+    };
+
+    enum class JsonValueType
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Object,
+        Array,
+    };
+
+    // 解析事件，其中的 string_view 只在回调期间有效
+    struct JsonEvent
+    {
+        JsonEventType _type = JsonEventType::Value;
+        JsonValueType _valueType = JsonValueType::Null;
+        std::string_view _path; // JSON Pointer (RFC 6901)，如 /items/0/name，根容器为 ""
+        std::string_view _key;  // 父节点是对象时为字段名，否则为空
+        int64_t _index = -1;    // 父节点是数组时为元素下标，否则为 -1
+        size_t _depth = 0;      // 外层容器的个数，根容器为 0
+        std::string_view _text; // Value：反转义后的字符串或数字原文；StringPart：新增片段
+        bool _bool = false;     // Value 且类型为 Bool 时的取值
+
+        // 字段或数组元素完整结束 (Value / EndObject / EndArray)
+        bool completed() const
+        {
+            return _type == JsonEventType::Value || _type == JsonEventType::EndObject || _type == JsonEventType::EndArray;
+        }
+        double asDouble() const;
+        int64_t asInt() const;
+    };
+
+    /**
+     * @brief 增量 JSON 解析器
+     *
+     * 挂在 sendMessageStream 的增量数据上，每个值在语法上完整时立即回调，
+     * 不必等整个响应结束：字段、数组元素一结束就能处理，长字符串还能逐段拿到。
+     * 状态保存在解析器中，增量可以在任意字节处切分 (包括转义序列与 \uXXXX 中间)。
+     * 容器栈与字符串缓冲区在 reset() 后保留容量，稳定运行时不再分配内存。
+     *
+     * 根值必须是对象或数组：之前的内容 (如 ```json 代码块标记、说明文字) 被跳过，
+     * 根容器结束后的内容被忽略。字符串中未转义的控制字符按原样接受 (部分模型会输出原始换行)。
+     * 不是线程安全的，同一时刻只能由一个线程调用 feed。
+     */
+    class JsonStreamParser
+    {
+    public:
+        using Handler = std::function<void(const JsonEvent &)>;
+
+        explicit JsonStreamParser(Handler handler);
+
+        // 处理一段输入，遇到语法错误返回 false，之后的输入都被忽略
+        bool feed(std::string_view chunk);
+        // 输入结束：根容器已完整结束返回 true，否则记录错误并返回 false
+        bool finish();
+        // 清空状态以解析下一个响应，保留已分配的缓冲区
+        void reset();
+
+        bool done() const { return _state == State::Done; }
+        bool failed() const { return _state == State::Error; }
+        // 错误描述 (含出错位置的字节偏移)
+        const std::string &error() const { return _error; }
+        // 已处理的输入字节数
+        uint64_t consumed() const { return _consumed; }
+
+    private:
+        enum class State
+        {
+            Preamble,   // 等待根容器开始
+            Structural, // 等待下一个记号
+            String,
+            Escape,
+            Unicode,
+            Number,
+            Literal,
+            Done,
+            Error,
+        };
+
+        // 下一个记号的语法要求
+        enum class Expect
+        {
+            Value,
+            ValueOrEnd, // 数组第一个元素或 ]
+            KeyOrEnd,   // 对象第一个字段或 }
+            Key,
+            Colon,
+            CommaOrEnd,
+        };
+
+        struct Frame
+        {
+            bool _object = false;
+            int64_t _index = 0;  // 数组中当前元素的下标
+            size_t _pathLen = 0; // 容器自身路径的长度
+            std::string _key;    // 对象中当前字段名
+        };
+
+    private:
+        size_t structural(std::string_view chunk, size_t i);
+        size_t scanString(std::string_view chunk, size_t i);
+        void beginValue();
+        void openContainer(bool object);
+        void closeContainer(char c);
+        void finishString();
+        void finishNumber();
+        void finishValue();
+        void appendCodepoint(uint32_t cp);
+        void flushSurrogate();
+        void flushStringPart();
+        void emit(JsonEventType type, JsonValueType valueType, std::string_view text = std::string_view(), bool flag = false);
+        void fail(const std::string &message, size_t pos);
+
+    private:
+        Handler _handler;
+        State _state = State::Preamble;
+        Expect _expect = Expect::Value;
+        std::vector<Frame> _frames; // 容器栈，弹出时不销毁元素以复用其中的字符串
+        size_t _depth = 0;          // 当前打开的容器数
+        std::string _path;          // 当前值的路径
+        std::string _text;          // 当前字符串 / 数字
+        std::string *_target = nullptr; // 字符串写入位置：_text 或字段名
+        bool _inKey = false;
+        size_t _partStart = 0;      // _text 中尚未作为 StringPart 发出的起点
+        uint32_t _unicode = 0;      // \uXXXX 累积值
+        int _hexDigits = 0;
+        uint32_t _highSurrogate = 0; // 等待低位代理的高位代理
+        const char *_literal = nullptr; // 正在匹配的 true / false / null
+        size_t _literalPos = 0;
+        uint64_t _consumed = 0;
+        std::string _error;
+    };
+
+    // 把解析器接到 sendMessageStream 的回调上：增量先交给 parser，再原样转发给 next (可为空)
+    // 最后一个增量到达时调用 parser->finish()；调用方保留 parser 以便事后检查 done() / error()
+    std::function<void(const std::string &, bool)> streamJsonCallback(std::shared_ptr<JsonStreamParser> parser,
+                                                                     std::function<void(const std::string &, bool)> next = nullptr);
+
+} // end ai_chat_sdk
@@ -1,16 +1,61 @@
 #pragma once
+#include <atomic>
 #include <functional>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include "common.h"
+#include "CancelToken.h"
+#include "Deadline.h"
+#include "PromptCache.h"
+#include "transport/HttpTransport.h"
 
 namespace ai_chat_sdk
 {
+    // Provider 累计的 token 用量，用于观察前缀缓存命中率
+    struct UsageStats
+    {
+        uint64_t _responses = 0;         // 带 usage 的响应数
+        int64_t _promptTokens = 0;       // 输入 token 总数
+        int64_t _cachedPromptTokens = 0; // 命中前缀缓存的输入 token 总数
+        int64_t _completionTokens = 0;   // 输出 token 总数
+
+        double cacheHitRatio() const { return _promptTokens > 0 ? double(_cachedPromptTokens) / _promptTokens : 0.0; }
+    };
+
+    // 模型配置快照：initModel / rotateApiKey 构造新快照后整体发布，发布后不再修改
+    // 进行中的请求持有自己拿到的快照直到结束，因此配置可以在满负载下热更新
+    struct ProviderConfig
+    {
+        std::string _apiKey;                                      // API密钥
+        std::string _endpoint;                                    // 模型API endpoint  base url
+        HttpTransportPtr _transport;                              // 传输层 (根据 transport 配置创建)
+        RequestLayout _requestLayout = RequestLayout::Default;    // 请求体布局 (request_layout)
+        bool _streamUsage = false;                                // 流式请求附带 stream_options.include_usage (stream_usage)
+        TimeoutPolicy _timeoutPolicy;                             // sendMessage 的默认超时：连接 30 秒，读空闲 60 秒
+        TimeoutPolicy _streamTimeoutPolicy = {0, 30000, 0, 300000}; // sendMessageStream 的默认超时：读空闲 300 秒
+
+        // 读取超时配置 (timeout_ms / connect_timeout_ms / first_token_timeout_ms / idle_timeout_ms)，
+        // 作为全量与流式请求的默认值，requestParam 中的同名参数可逐请求覆盖
+        void loadTimeouts(const std::map<std::string, std::string> &modelConfig)
+        {
+            applyTimeoutParams(modelConfig, _timeoutPolicy);
+            applyTimeoutParams(modelConfig, _streamTimeoutPolicy);
+        }
+    };
+
+    using ProviderConfigPtr = std::shared_ptr<const ProviderConfig>;
+
     // LLMProvider 类
+    // 同一个实例可以被多个线程同时使用：请求路径只读取配置快照，initModel / rotateApiKey 可与请求并发执行
     class LLMProvider
     {
     public:
+        LLMProvider();
+        virtual ~LLMProvider() = default;
+
         // 初始化模型
         virtual bool initModel(const std::map<std::string, std::string> &modelConfig) = 0;
         // 检测模型是否有效
@@ -20,15 +65,82 @@ namespace ai_chat_sdk
         // 获取模型描述
         virtual std::string getModelDesc() const = 0;
         // 发送消息 - 全量返回
-        virtual std::string sendMessage(const std::vector<Message> &messages, const std::map<std::string, std::string> &requestParam) = 0;
+        // cancelToken: 可选的取消令牌，调用方可在任意线程取消请求
+        // usage: 可选，返回本次请求的 token 用量 (含前缀缓存命中数)，响应中没有 usage 时 _valid 为 false
+        virtual std::string sendMessage(const std::vector<Message> &messages, const std::map<std::string, std::string> &requestParam,
+                                        CancelTokenPtr cancelToken = nullptr, TokenUsage *usage = nullptr) = 0;
         // 发送消息 - 增量返回 - 流式响应
         virtual std::string sendMessageStream(const std::vector<Message> &messages,
                                               const std::map<std::string, std::string> &requestParam,
-                                              std::function<void(const std::string &, bool)> callback) = 0; // callback: 对模型返回的增量数据如何处理，第一个参数为增量数据，第二个参数为是否为最后一个增量数据
+                                              std::function<void(const std::string &, bool)> callback, // callback: 对模型返回的增量数据如何处理，第一个参数为增量数据，第二个参数为是否为最后一个增量数据
+                                              CancelTokenPtr cancelToken = nullptr,                     // 取消后仍会以 callback("", true) 结束，且只调用一次
+                                              TokenUsage *usage = nullptr) = 0;
+        // 发送消息 - 增量返回 - 异步
+        // 立即返回，不占用调用线程；结束时调用 onComplete(完整回复, usage)，失败时完整回复为空
+        // 使用 reactor 传输时 callback 与 onComplete 都在事件循环线程上执行，不能阻塞，也不能再同步等待其它请求
+        // 调用方需保证 Provider 存活到 onComplete 返回
+        // 默认实现在当前线程调用 sendMessageStream，支持异步传输的 Provider 应覆盖
+        using StreamCompletion = std::function<void(const std::string &, const TokenUsage &)>;
+        virtual void sendMessageStreamAsync(const std::vector<Message> &messages,
+                                            const std::map<std::string, std::string> &requestParam,
+                                            std::function<void(const std::string &, bool)> callback,
+                                            StreamCompletion onComplete, CancelTokenPtr cancelToken = nullptr)
+        {
+            TokenUsage usage;
+            std::string fullResponse = sendMessageStream(messages, requestParam, std::move(callback), cancelToken, &usage);
+            if (onComplete)
+                onComplete(fullResponse, usage);
+        }
+
+        // 累计 token 用量 (所有线程)
+        UsageStats usageStats() const
+        {
+            UsageStats stats;
+            stats._responses = _usageResponses.load(std::memory_order_relaxed);
+            stats._promptTokens = _usagePromptTokens.load(std::memory_order_relaxed);
+            stats._cachedPromptTokens = _usageCachedTokens.load(std::memory_order_relaxed);
+            stats._completionTokens = _usageCompletionTokens.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+        // 热更新 API Key：复制当前快照、替换密钥后发布，进行中的请求继续使用旧密钥
+        // 尚未 initModel 时返回 false
+        virtual bool rotateApiKey(const std::string &apiKey);
+        // 配置版本号，每发布一次快照加一
+        uint64_t configVersion() const { return _configVersion.load(std::memory_order_acquire); }
+
+    protected:
+        // 当前配置快照 (未初始化时为空)
+        // 热路径无锁：每个线程缓存最近读到的快照，版本号未变时直接复用
+        ProviderConfigPtr config() const;
+        // 发布新快照，之后开始的请求使用新配置
+        void publishConfig(const std::shared_ptr<ProviderConfig> &config);
+
+        // 记录一次响应的 usage，并写回调用方
+        void recordUsage(const TokenUsage &usage, TokenUsage *out)
+        {
+            if (out)
+                *out = usage;
+            if (!usage._valid)
+                return;
+            _usageResponses.fetch_add(1, std::memory_order_relaxed);
+            _usagePromptTokens.fetch_add(usage._promptTokens, std::memory_order_relaxed);
+            _usageCachedTokens.fetch_add(usage._cachedPromptTokens, std::memory_order_relaxed);
+            _usageCompletionTokens.fetch_add(usage._completionTokens, std::memory_order_relaxed);
+        }
 
     protected:
-        bool _isAvailable = false; // 标记模型是否有效
-        std::string _apiKey;       // API密钥
-        std::string _endpoint;     // 模型API endpoint  base url
+        std::atomic<bool> _isAvailable{false}; // 标记模型是否有效
+
+    private:
+        const uint64_t _providerId;             // 线程本地快照缓存的键 (进程内唯一，不复用)
+        std::atomic<uint64_t> _configVersion{0};
+        ProviderConfigPtr _config;              // 只通过 std::atomic_load / std::atomic_store 访问
+        std::mutex _publishMutex;               // 串行化发布 (rotateApiKey 需要读-改-写)
+
+        std::atomic<uint64_t> _usageResponses{0};
+        std::atomic<int64_t> _usagePromptTokens{0};
+        std::atomic<int64_t> _usageCachedTokens{0};
+        std::atomic<int64_t> _usageCompletionTokens{0};
     };
 } // end ai_chat_sdk
@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "common.h"
+#include "util/jsonWriter.h"
+
+namespace Json
+{
+    class Value;
+}
+
+namespace ai_chat_sdk
+{
+    struct BodySplice;
+
+    // 请求体布局
+    // DeepSeek / OpenAI 对 "消息前缀与近期请求完全一致" 的请求自动命中前缀缓存 (更便宜、首 token 更快)，
+    // CacheAware 布局保证相同的历史前缀序列化出逐字节相同的 JSON：
+    // - 固定字段顺序：model、messages 在前，stream / temperature / max_tokens 等易变参数在后
+    // - 消息保持调用方给出的顺序，不做重排；调用方应把 system 消息放在最前并只在末尾追加历史
+    // - 消息内容中的 \r\n 统一为 \n，数值使用最短可还原表示
+    enum class RequestLayout
+    {
+        Default,
+        CacheAware
+    };
+
+    // 解析配置项 request_layout："default" / "cache_aware"，无法识别时返回 Default
+    RequestLayout parseRequestLayout(const std::string &value);
+
+    // 写出 messages 数组 (调用方已写好 key)
+    // 带 _contentSource 的消息：splices 非空时只记录插入点 (发送时流式读取)，否则把内容完整读入请求体
+    // 外部内容读取失败时返回 false，writer 中的文档不完整，调用方应放弃本次请求
+    bool writeMessages(JsonWriter &writer, const std::vector<Message> &messages, RequestLayout layout,
+                       std::vector<BodySplice> *splices = nullptr);
+
+    // 解析响应中的 usage 对象，兼容以下字段：
+    // - DeepSeek：prompt_tokens / completion_tokens / prompt_cache_hit_tokens
+    // - OpenAI Chat Completions：prompt_tokens_details.cached_tokens
+    // - OpenAI Responses：input_tokens / output_tokens / input_tokens_details.cached_tokens
+    // usage 不是对象时返回 false
+    bool parseUsage(const Json::Value &usage, TokenUsage &out);
+
+} // end ai_chat_sdk
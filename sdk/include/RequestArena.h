@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+
+namespace ai_chat_sdk
+{
+    // 单次请求的内存池：请求构造、响应解析中的临时字符串 / 容器都从这里分配，
+    // 请求结束时一次性释放 (std::pmr::monotonic_buffer_resource)。
+    // 首块缓冲区常驻并重复使用，请求规模不超过它时完全不访问堆。
+    class RequestArena
+    {
+    public:
+        explicit RequestArena(size_t initialBytes = 16 * 1024);
+
+        RequestArena(const RequestArena &) = delete;
+        RequestArena &operator=(const RequestArena &) = delete;
+
+        std::pmr::memory_resource *resource() { return &_counting; }
+
+        // 释放本次请求分配的全部内存，首块缓冲区保留
+        void reset();
+
+        // 本次请求已从内存池分配的字节数
+        size_t bytesUsed() const { return _bytesUsed; }
+
+        // 全局统计 (所有线程累计)：分配路径只写本线程的计数器，stats() 读取时汇总
+        struct Stats
+        {
+            uint64_t _scopes = 0;              // ArenaScope 次数 (请求数)
+            uint64_t _arenaAllocations = 0;    // 由内存池满足的分配次数
+            uint64_t _arenaBytes = 0;          // 由内存池满足的字节数
+            uint64_t _upstreamAllocations = 0; // 内存池向堆申请新块的次数
+            uint64_t _upstreamBytes = 0;       // 内存池向堆申请的字节数
+        };
+        static Stats stats();
+
+    private:
+        friend class ArenaScope;
+
+        // 统计分配次数的 memory_resource，只转发给下游
+        class CountingResource : public std::pmr::memory_resource
+        {
+        public:
+            CountingResource(std::pmr::memory_resource *next, bool upstream, size_t *bytesUsed)
+                : _next(next), _upstream(upstream), _bytesUsed(bytesUsed)
+            {
+            }
+            void setNext(std::pmr::memory_resource *next) { _next = next; }
+
+        protected:
+            void *do_allocate(size_t bytes, size_t alignment) override;
+            void do_deallocate(void *p, size_t bytes, size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+        private:
+            std::pmr::memory_resource *_next;
+            bool _upstream;
+            size_t *_bytesUsed;
+        };
+
+        std::unique_ptr<char[]> _initial;
+        size_t _initialBytes;
+        size_t _bytesUsed = 0;
+        CountingResource _upstream; // 内存池 -> 堆
+        std::pmr::monotonic_buffer_resource _monotonic;
+        CountingResource _counting; // 调用方 -> 内存池
+    };
+
+    // 从当前线程的内存池缓存中借出一个 RequestArena，析构时重置并归还
+    // 可以嵌套使用，每层拿到各自独立的内存池
+    class ArenaScope
+    {
+    public:
+        ArenaScope();
+        ~ArenaScope();
+
+        ArenaScope(const ArenaScope &) = delete;
+        ArenaScope &operator=(const ArenaScope &) = delete;
+
+        RequestArena &arena() { return *_arena; }
+        std::pmr::memory_resource *resource() { return _arena->resource(); }
+
+    private:
+        std::unique_ptr<RequestArena> _arena;
+    };
+
+} // end ai_chat_sdk
@@ -0,0 +1,173 @@
+#pragma once
+#include "LLMProvider.h"
+#include "EmbeddingProvider.h"
+#include "HnswIndex.h"
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ai_chat_sdk
+{
+    // 语义缓存配置
+    struct SemanticCacheOptions
+    {
+        float _threshold = 0.92f;              // 余弦相似度不低于该值才命中
+        size_t _capacity = 10000;              // 最多缓存条数 (同时是 HNSW 的槽位数)
+        size_t _maxBytes = 64 * 1024 * 1024;   // 缓存文本 (问题 + 回复) 的总字节上限
+        size_t _m = 16;                        // HNSW 每层连接数
+        size_t _efConstruction = 200;          // HNSW 插入时的候选集大小
+        size_t _efSearch = 64;                 // HNSW 查询时的候选集大小
+        float _nearMissMargin = 0.05f;         // 最近邻低于阈值但差距在此之内时计为 near miss，用于调整阈值
+        bool _cacheSampled = true;             // false：temperature > 0 (或未指定) 的请求不读写缓存
+    };
+
+    // 缓存统计，命中质量用命中相似度分布与 near miss 衡量
+    struct SemanticCacheStats
+    {
+        uint64_t _lookups = 0;
+        uint64_t _hits = 0;
+        uint64_t _misses = 0;
+        uint64_t _nearMisses = 0;    // 未命中，但最近邻相似度在 [阈值 - margin, 阈值) 内
+        uint64_t _inserts = 0;
+        uint64_t _evictions = 0;
+        uint64_t _embedFailures = 0; // 向量化失败而直接访问模型的请求
+        size_t _entries = 0;
+        size_t _bytes = 0;           // 缓存文本字节数
+        size_t _indexBytes = 0;      // 向量与图结构字节数
+        double _hitSimilaritySum = 0;
+        uint64_t _hitBuckets[4] = {0, 0, 0, 0}; // 命中相似度：[阈值, 0.95) [0.95, 0.98) [0.98, 0.995) [0.995, 1]
+
+        double hitRate() const { return _lookups ? double(_hits) / _lookups : 0.0; }
+        double meanHitSimilarity() const { return _hits ? _hitSimilaritySum / _hits : 0.0; }
+    };
+
+    /**
+     * @brief 向量相似度缓存：HNSW 近似最近邻 + LRU 淘汰
+     *
+     * scope 为请求上下文 (模型、system、历史消息、参数) 的哈希，只有 scope 相同的条目才能命中，
+     * 避免同一个问题在不同对话上下文中返回不合适的回复。条目少的 scope 在自己的条目中精确查找，
+     * 条目多的 scope 走全局 HNSW，并在近邻都属于其他 scope 时扩大搜索范围。线程安全。
+     */
+    class SemanticCache
+    {
+    public:
+        SemanticCache(size_t dimension, const SemanticCacheOptions &options = SemanticCacheOptions());
+
+        // 查找相似度最高且不低于阈值的条目，命中时写入 response / similarity
+        bool lookup(uint64_t scope, const std::vector<float> &vector, std::string &response, float *similarity = nullptr);
+        // 写入条目，超出条数或字节上限时淘汰最久未使用的条目
+        void insert(uint64_t scope, const std::vector<float> &vector, const std::string &query, const std::string &response);
+        void clear();
+        // 向量化失败的请求计数 (由 SemanticCacheProvider 上报)
+        void recordEmbedFailure() { _embedFailures.fetch_add(1, std::memory_order_relaxed); }
+
+        // 快照：保存全部条目 (含向量)，加载时重建索引；embeddingName 不一致时拒绝加载
+        bool save(const std::string &file, const std::string &embeddingName) const;
+        bool load(const std::string &file, const std::string &embeddingName);
+
+        // 调整命中阈值，已有条目保留；可与查询并发调用
+        void setThreshold(float threshold);
+        float threshold() const;
+
+        SemanticCacheStats stats() const;
+        size_t size() const;
+        // 阈值以 threshold() 为准
+        const SemanticCacheOptions &options() const { return _options; }
+
+    private:
+        struct Entry
+        {
+            uint64_t _scope = 0;
+            std::string _query;
+            std::string _response;
+            std::list<uint32_t>::iterator _lru;
+            size_t _scopePos = 0; // 在 _scopeSlots[_scope] 中的位置
+        };
+
+        // 同一 scope 中与 vector 最近的条目，scope 没有条目时返回 false；调用方持有读锁或写锁
+        bool nearestLocked(uint64_t scope, const float *vector, float &distance, uint32_t &slot) const;
+
+        // 调用方持有写锁
+        void insertLocked(uint64_t scope, const float *vector, const std::string &query, const std::string &response);
+        void evictLocked();
+
+    private:
+        size_t _dimension;
+        SemanticCacheOptions _options;
+
+        mutable std::shared_mutex _mutex; // 保护索引与条目
+        HnswIndex _index;
+        std::vector<Entry> _entries;    // 按槽位
+        std::vector<uint32_t> _freeSlots;
+        std::unordered_map<uint64_t, std::vector<uint32_t>> _scopeSlots; // scope -> 槽位
+        size_t _bytes = 0;
+
+        mutable std::mutex _lruMutex;   // 命中时只持有读锁，LRU 链表单独加锁
+        std::list<uint32_t> _lru;       // 头部为最近使用
+
+        std::atomic<uint64_t> _lookups{0};
+        std::atomic<uint64_t> _hits{0};
+        std::atomic<uint64_t> _misses{0};
+        std::atomic<uint64_t> _nearMisses{0};
+        std::atomic<uint64_t> _inserts{0};
+        std::atomic<uint64_t> _evictions{0};
+        std::atomic<uint64_t> _embedFailures{0};
+        std::atomic<uint64_t> _hitBuckets[4];
+        mutable std::mutex _similarityMutex;
+        double _hitSimilaritySum = 0;
+    };
+
+    /**
+     * @brief 语义缓存装饰器：对最后一条 user 消息做向量化，缓存中存在足够相似的问题时直接返回其回复
+     *
+     * 配置项 (initModel)：
+     * - semantic_cache_threshold：命中阈值，覆盖 SemanticCacheOptions::_threshold
+     * - semantic_cache_snapshot：快照文件，initModel 时存在则加载
+     * 请求参数 semantic_cache = "false" 时本次请求不读写缓存。
+     */
+    class SemanticCacheProvider : public LLMProvider
+    {
+    public:
+        SemanticCacheProvider(std::shared_ptr<LLMProvider> inner, EmbeddingProviderPtr embedding,
+                              const SemanticCacheOptions &options = SemanticCacheOptions());
+
+        virtual bool initModel(const std::map<std::string, std::string> &modelConfig) override;
+        virtual bool isAvailable() const override;
+        virtual std::string getModelName() const override;
+        virtual std::string getModelDesc() const override;
+        // 密钥保存在被包装的模型中
+        virtual bool rotateApiKey(const std::string &apiKey) override;
+
+        virtual std::string sendMessage(const std::vector<Message> &messages,
+                                        const std::map<std::string, std::string> &requestParam,
+                                        CancelTokenPtr cancelToken = nullptr, TokenUsage *usage = nullptr) override;
+
+        virtual std::string sendMessageStream(const std::vector<Message> &messages,
+                                              const std::map<std::string, std::string> &requestParam,
+                                              std::function<void(const std::string &, bool)> callback,
+                                              CancelTokenPtr cancelToken = nullptr, TokenUsage *usage = nullptr) override;
+
+        bool saveSnapshot(const std::string &file) const;
+        bool loadSnapshot(const std::string &file);
+        SemanticCacheStats stats() const { return _cache->stats(); }
+        SemanticCache &cache() { return *_cache; }
+
+    private:
+        // 计算 scope 与向量；请求不参与缓存时返回 false
+        bool prepare(const std::vector<Message> &messages, const std::map<std::string, std::string> &requestParam,
+                     const CancelTokenPtr &cancelToken, uint64_t &scope, std::vector<float> &vector);
+
+    private:
+        std::shared_ptr<LLMProvider> _inner;
+        EmbeddingProviderPtr _embedding;
+        SemanticCacheOptions _options;
+        std::unique_ptr<SemanticCache> _cache;
+    };
+
+} // end ai_chat_sdk
@@ -0,0 +1,85 @@
+#pragma once
+#include "LLMProvider.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ai_chat_sdk
+{
+    // 合并去重配置
+    struct SingleFlightOptions
+    {
+        // temperature > 0 (或未指定，使用模型默认值 0.7) 时输出本身带随机性，
+        // 设为 false 则这类请求不合并，各自访问上游
+        bool _dedupSampled = true;
+        // 执行上游调用的工作线程上限 (single_flight_threads)，超出时新的上游调用排队
+        size_t _maxUpstreamThreads = 32;
+    };
+
+    /**
+     * @brief 合并相同的在途请求 (single-flight)
+     *
+     * 包装任意 LLMProvider：模型、消息列表、请求参数与是否流式完全相同的并发请求只发起一次上游调用，
+     * 其余调用方挂在同一次调用上：
+     * - 全量接口：所有调用方拿到同一个结果 (包括失败时的空串)
+     * - 流式接口：后到的调用方先补发已产生的增量，再与其他调用方同步接收后续增量
+     * 上游调用在有上限的工作线程中执行，调用方各自的 cancelToken 只让自己提前返回；
+     * 所有调用方都取消后才取消上游请求。
+     */
+    class SingleFlightProvider : public LLMProvider
+    {
+    public:
+        explicit SingleFlightProvider(std::shared_ptr<LLMProvider> inner, const SingleFlightOptions &options = SingleFlightOptions());
+        ~SingleFlightProvider();
+
+        // 初始化被包装的模型；额外识别配置项 single_flight_sampled ("true" / "false")、single_flight_threads
+        virtual bool initModel(const std::map<std::string, std::string> &modelConfig) override;
+        virtual bool isAvailable() const override;
+        virtual std::string getModelName() const override;
+        virtual std::string getModelDesc() const override;
+        // 密钥保存在被包装的模型中
+        virtual bool rotateApiKey(const std::string &apiKey) override;
+
+        virtual std::string sendMessage(const std::vector<Message> &messages,
+                                        const std::map<std::string, std::string> &requestParam,
+                                        CancelTokenPtr cancelToken = nullptr, TokenUsage *usage = nullptr) override;
+
+        virtual std::string sendMessageStream(const std::vector<Message> &messages,
+                                              const std::map<std::string, std::string> &requestParam,
+                                              std::function<void(const std::string &, bool)> callback,
+                                              CancelTokenPtr cancelToken = nullptr, TokenUsage *usage = nullptr) override;
+
+        // 统计信息
+        struct Stats
+        {
+            uint64_t _upstreamCalls = 0; // 实际发起的上游调用数
+            uint64_t _joined = 0;        // 挂到已有在途请求上的调用数
+            uint64_t _bypassed = 0;      // 因 temperature > 0 未参与合并的调用数
+        };
+        Stats stats() const;
+
+    private:
+        struct Flight;
+        struct Group;
+
+        std::string request(const std::vector<Message> &messages, const std::map<std::string, std::string> &requestParam,
+                            bool stream, const std::function<void(const std::string &, bool)> &callback,
+                            const CancelTokenPtr &cancelToken, TokenUsage *usage);
+        // 是否参与合并
+        bool shouldDedup(const std::map<std::string, std::string> &requestParam) const;
+
+    private:
+        std::shared_ptr<LLMProvider> _inner;
+        SingleFlightOptions _options;
+        std::shared_ptr<Group> _group; // 在途请求表与工作线程
+
+        std::atomic<uint64_t> _upstreamCalls{0};
+        std::atomic<uint64_t> _joined{0};
+        std::atomic<uint64_t> _bypassed{0};
+    };
+
+} // end ai_chat_sdk
@@ -1,10 +1,13 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <ctime>
+#include <memory>
 #include <vector>
 
 namespace ai_chat_sdk
 {
+    class ContentSource;
 
     // 消息结构
     struct Message
@@ -13,6 +16,8 @@ namespace ai_chat_sdk
         std::string _role;      // 角色，如user、assistant等
         std::string _content;   // 消息内容
         std::time_t _timestamp; // 消息发送时间戳
+        // 可选的外部内容 (见 ContentSource.h)：非空时代替 _content 发送，大文档按引用传递、发送时流式读取
+        std::shared_ptr<const ContentSource> _contentSource;
 
         // 构造函数
         Message(const std::string &role = "", const std::string &content = "")
@@ -21,6 +26,16 @@ namespace ai_chat_sdk
         }
     };
 
+    // 单次请求的 token 用量 (来自响应中的 usage 字段)
+    struct TokenUsage
+    {
+        bool _valid = false;             // 响应中是否带有 usage
+        int64_t _promptTokens = 0;       // 输入 token 数
+        int64_t _cachedPromptTokens = 0; // 其中命中服务端前缀缓存的 token 数
+        int64_t _completionTokens = 0;   // 输出 token 数
+        int64_t _totalTokens = 0;        // 总 token 数
+    };
+
     // 模型的公共配置信息
     struct Config
     {
@@ -0,0 +1,133 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ai_chat_sdk
+{
+    // 时间轮：O(1) 添加 / 取消定时器，精度为一个 tick
+    // 只在所属 EventLoop 线程中使用，不加锁
+    class TimerWheel
+    {
+    public:
+        using TimerId = uint64_t;
+
+        TimerWheel(uint32_t tickMs = 100, size_t slotCount = 1024);
+
+        // delayMs 之后执行 fn (向上取整到 tick)
+        TimerId add(uint32_t delayMs, std::function<void()> fn);
+        // 取消尚未触发的定时器
+        void cancel(TimerId id);
+        // 推进到 nowMs，执行所有到期的定时器
+        void advance(int64_t nowMs);
+        // 距离下一个 tick 的毫秒数，没有定时器时返回 -1
+        int nextTimeoutMs(int64_t nowMs) const;
+
+        size_t size() const { return _index.size(); }
+
+    private:
+        struct Timer
+        {
+            TimerId _id;
+            uint64_t _rounds; // 还需转过的整圈数
+            std::function<void()> _fn;
+        };
+
+        uint32_t _tickMs;
+        std::vector<std::list<Timer>> _slots;
+        std::unordered_map<TimerId, std::pair<size_t, std::list<Timer>::iterator>> _index;
+        std::unordered_set<TimerId> _firing; // 本次 advance 中已到期、尚未执行的定时器
+        uint64_t _currentTick = 0;
+        int64_t _startMs = -1;
+        TimerId _nextId = 1;
+    };
+
+    // 基于 epoll 的事件循环，一个线程驱动任意多个非阻塞 fd
+    // fd / 定时器相关接口只能在循环线程调用，其它线程通过 post 投递任务
+    class EventLoop
+    {
+    public:
+        // events 为 epoll 事件 (EPOLLIN / EPOLLOUT / EPOLLERR ...)
+        using IoHandler = std::function<void(uint32_t events)>;
+
+        EventLoop();
+        ~EventLoop();
+
+        // 启动 / 停止循环线程
+        void start();
+        void stop();
+
+        // 投递任务到循环线程执行 (线程安全)
+        void post(std::function<void()> task);
+        bool inLoopThread() const;
+        // 当前线程所运行的事件循环，非循环线程返回 nullptr
+        static EventLoop *current();
+
+        // 注册 / 修改 / 注销 fd (水平触发)
+        bool addFd(int fd, uint32_t events, IoHandler handler);
+        bool modifyFd(int fd, uint32_t events);
+        void removeFd(int fd);
+
+        TimerWheel::TimerId runAfter(uint32_t delayMs, std::function<void()> fn);
+        void cancelTimer(TimerWheel::TimerId id);
+
+        // 当前注册的 fd 数量 (近似值，可在任意线程读取)
+        size_t fdCount() const { return _fdCount.load(std::memory_order_relaxed); }
+
+        // 单调时钟毫秒数
+        static int64_t nowMs();
+
+    private:
+        void run();
+        void wakeup();
+        void runPending();
+
+    private:
+        struct FdEntry
+        {
+            uint32_t _generation;
+            std::shared_ptr<IoHandler> _handler;
+        };
+
+        int _epollFd = -1;
+        int _wakeupFd = -1;
+        std::thread _thread;
+        std::atomic<bool> _running{false};
+
+        std::mutex _mutex;
+        std::vector<std::function<void()>> _pending; // 其它线程投递的任务
+
+        std::unordered_map<int, FdEntry> _fds; // 只在循环线程访问
+        uint32_t _nextGeneration = 1;           // 区分复用的 fd 编号，丢弃已注销 fd 的陈旧事件
+        std::atomic<size_t> _fdCount{0};
+        TimerWheel _timers;
+    };
+
+    // 进程内共享的一组事件循环，请求按轮询分配到各个循环
+    class EventLoopPool
+    {
+    public:
+        // 第一次调用时以 threadCount 个线程创建，之后的参数被忽略
+        // 故意不析构 (请求可能在任意循环线程上最后释放)，进程退出时停止所有循环
+        static EventLoopPool &shared(size_t threadCount);
+
+        explicit EventLoopPool(size_t threadCount);
+        ~EventLoopPool();
+
+        EventLoop &next();
+        void stop();
+        size_t size() const { return _loops.size(); }
+
+    private:
+        std::vector<std::unique_ptr<EventLoop>> _loops;
+        std::atomic<size_t> _next{0};
+    };
+
+} // end ai_chat_sdk
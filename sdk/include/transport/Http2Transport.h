@@ -0,0 +1,32 @@
+#pragma once
+#include "HttpTransport.h"
+
+namespace ai_chat_sdk
+{
+    // 基于 nghttp2 的 HTTP/2 传输
+    // 每个 endpoint 维护少量长连接，多个请求 / SSE 流在同一连接上多路复用：
+    // - https:// 通过 TLS + ALPN 协商 h2，http:// 使用 h2c (prior knowledge)，便于对接本地 h2 服务测试
+    // - 每个连接一个 I/O 线程独占 nghttp2 会话，调用线程只通过命令队列与之交互
+    // - 关闭自动 WINDOW_UPDATE：数据交给 BodyHandler 处理完才归还窗口，消费慢的流不会撑爆内存
+    // - 取消请求时发送 RST_STREAM(CANCEL)，只结束该流，连接继续服务其它请求
+    // 需要以 CHATSDK_WITH_NGHTTP2 编译，否则 createTransport("http2") 回退到 httplib
+    class Http2Transport : public HttpTransport
+    {
+    public:
+        Http2Transport(const std::string &endpoint, const TransportOptions &options = TransportOptions());
+        ~Http2Transport();
+
+        virtual bool send(const HttpRequest &request, HttpResponse &response,
+                          const BodyHandler &bodyHandler, const CancelTokenPtr &cancelToken) override;
+
+        virtual std::string name() const override { return "http2"; }
+
+        // 当前打开的连接数 (用于观察多路复用效果)
+        size_t connectionCount() const;
+
+    private:
+        struct Impl;
+        std::shared_ptr<Impl> _impl;
+    };
+
+} // end ai_chat_sdk
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include "../CancelToken.h"
+
+namespace ai_chat_sdk
+{
+    class StreamingBody;
+
+    // 传输层请求
+    struct HttpRequest
+    {
+        std::string _method = "POST";
+        std::string _path;                          // 例如 /chat/completions
+        std::map<std::string, std::string> _headers; // 请求头
+        std::string _body;                          // 请求体
+        std::shared_ptr<const StreamingBody> _streamingBody; // 非空时忽略 _body，边读边发 (HTTP/1.1 使用 chunked 编码)
+        int _connectTimeoutSec = 30;                // 连接超时
+        int _readTimeoutSec = 60;                   // 两次读之间的超时
+        int64_t _deadlineMs = 0;                    // 绝对截止时间 (steadyNowMs)，0 表示不限；到达后以 "deadline exceeded" 失败
+        std::function<void()> _onUploadProgress;    // 流式请求体每发出一块调用一次，可为空
+    };
+
+    // 传输层响应
+    struct HttpResponse
+    {
+        int _status = 0;    // HTTP 状态码，收到响应头之前为 0
+        std::string _body;  // 未设置 BodyHandler 时为完整响应体
+        std::string _error; // 网络错误描述
+    };
+
+    // 响应体数据回调：每收到一块数据调用一次，返回 false 中止接收
+    // 调用时 HttpResponse::_status 已经有效
+    using BodyHandler = std::function<bool(const char *data, size_t len)>;
+
+    using HttpResponsePtr = std::shared_ptr<HttpResponse>;
+
+    // 异步请求完成回调，ok 的含义与 send 的返回值相同
+    using CompletionHandler = std::function<void(bool ok)>;
+
+    // 传输层配置
+    struct TransportOptions
+    {
+        std::string _proxyHost; // HTTP 代理，为空时直连
+        int _proxyPort = 0;
+        size_t _maxConnections = 2;            // http2：每个 endpoint 的最大连接数
+        uint32_t _maxStreamsPerConnection = 100; // http2：单连接最大并发流 (同时受服务端 SETTINGS 限制)
+        uint32_t _streamWindowSize = 256 * 1024; // http2：单个流的接收窗口，控制未消费数据的上限
+        size_t _ioThreads = 2;                   // reactor：进程内共享的事件循环线程数 (首次创建时生效)
+    };
+
+    // 解析后的 base url
+    struct HttpEndpoint
+    {
+        bool _tls = true;
+        std::string _host;
+        int _port = 443;
+        std::string _authority; // host[:port]，用作 Host / :authority
+    };
+
+    // 单调时钟的当前毫秒数，HttpRequest::_deadlineMs 以此为基准
+    int64_t steadyNowMs();
+    // 把超时 (秒) 限制在截止时间之内，向上取整且不小于 1 秒；deadlineMs 为 0 时原样返回
+    int clampTimeoutSec(int timeoutSec, int64_t deadlineMs);
+
+    // 解析 http(s)://host[:port][/...]，路径部分被忽略
+    bool parseEndpoint(const std::string &url, HttpEndpoint &endpoint);
+
+    // 传输层接口：Provider 只负责构造请求、解析响应，网络收发交给具体的传输实现
+    class HttpTransport
+    {
+    public:
+        virtual ~HttpTransport() = default;
+
+        // 发送请求并阻塞到响应结束
+        // bodyHandler 为空时响应体写入 response._body，否则逐块交给 bodyHandler
+        // 返回 false 表示网络错误、被取消或 bodyHandler 中止，response._error 为原因
+        virtual bool send(const HttpRequest &request, HttpResponse &response,
+                          const BodyHandler &bodyHandler, const CancelTokenPtr &cancelToken) = 0;
+
+        // 异步发送：onComplete 之前 response 由传输层写入，bodyHandler / onComplete 可能在 I/O 线程上执行
+        // 默认实现在当前线程同步调用 send，reactor 传输会立即返回
+        virtual void sendAsync(const HttpRequest &request, const HttpResponsePtr &response, const BodyHandler &bodyHandler,
+                               const CompletionHandler &onComplete, const CancelTokenPtr &cancelToken)
+        {
+            bool ok = send(request, *response, bodyHandler, cancelToken);
+            if (onComplete)
+                onComplete(ok);
+        }
+
+        // 传输实现的名称，例如 "httplib" / "http2" / "reactor"
+        virtual std::string name() const = 0;
+    };
+
+    using HttpTransportPtr = std::shared_ptr<HttpTransport>;
+
+    // 根据名称创建传输实现："httplib" (默认)、"http2" 或 "reactor"
+    // 不支持的名称会记录错误并回退到 httplib
+    HttpTransportPtr createTransport(const std::string &kind, const std::string &endpoint, const TransportOptions &options = TransportOptions());
+
+} // end ai_chat_sdk
@@ -0,0 +1,23 @@
+#pragma once
+#include "HttpTransport.h"
+
+namespace ai_chat_sdk
+{
+    // 基于 cpp-httplib 的 HTTP/1.1 传输 (默认实现)
+    // 每个请求独立建立连接，并发流数量等于连接数
+    class HttplibTransport : public HttpTransport
+    {
+    public:
+        HttplibTransport(const std::string &endpoint, const TransportOptions &options = TransportOptions());
+
+        virtual bool send(const HttpRequest &request, HttpResponse &response,
+                          const BodyHandler &bodyHandler, const CancelTokenPtr &cancelToken) override;
+
+        virtual std::string name() const override { return "httplib"; }
+
+    private:
+        std::string _endpoint;
+        TransportOptions _options;
+    };
+
+} // end ai_chat_sdk
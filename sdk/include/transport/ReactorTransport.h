@@ -0,0 +1,35 @@
+#pragma once
+#include "HttpTransport.h"
+#include "EventLoop.h"
+
+namespace ai_chat_sdk
+{
+    // 基于 epoll 事件循环的 HTTP/1.1 传输
+    // 所有 socket 都是非阻塞的，由进程内共享的少量事件循环线程驱动 (TransportOptions::_ioThreads)：
+    // - 连接、代理 CONNECT、TLS 握手、请求写出、响应解析 (Content-Length / chunked) 全部在循环线程完成
+    // - 连接超时与读空闲超时由时间轮统一管理，不再依赖每个 socket 的阻塞超时
+    // - BodyHandler / CompletionHandler 在循环线程中执行，不能在其中阻塞
+    // sendAsync 不占用调用线程；send 在调用线程等待完成，网络 I/O 和 SSE 解析仍由循环线程处理
+    class ReactorTransport : public HttpTransport
+    {
+    public:
+        ReactorTransport(const std::string &endpoint, const TransportOptions &options = TransportOptions());
+        ~ReactorTransport();
+
+        virtual bool send(const HttpRequest &request, HttpResponse &response,
+                          const BodyHandler &bodyHandler, const CancelTokenPtr &cancelToken) override;
+
+        virtual void sendAsync(const HttpRequest &request, const HttpResponsePtr &response, const BodyHandler &bodyHandler,
+                               const CompletionHandler &onComplete, const CancelTokenPtr &cancelToken) override;
+
+        virtual std::string name() const override { return "reactor"; }
+
+        // 进行中的请求数
+        size_t inflight() const;
+
+    private:
+        struct Impl;
+        std::shared_ptr<Impl> _impl;
+    };
+
+} // end ai_chat_sdk
@@ -0,0 +1,87 @@
+#pragma once
+#include <sys/types.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../ContentSource.h"
+#include "HttpTransport.h"
+
+namespace ai_chat_sdk
+{
+    // 请求体中的一段外部内容：在 JSON 文本的 _offset 处插入 _source 的内容 (作为带引号的 JSON 字符串)
+    struct BodySplice
+    {
+        size_t _offset = 0;
+        ContentSourcePtr _source;
+        bool _normalizeNewlines = false; // \r\n 统一为 \n (RequestLayout::CacheAware)
+        bool _raw = false;               // 原样插入，不加引号也不转义 (multipart 等非 JSON 请求体)
+    };
+
+    /**
+     * @brief 流式请求体：JSON 骨架 + 若干外部内容
+     *
+     * 骨架由 JsonWriter 写出，外部内容的位置由 JsonWriter::externalValue() 记录。
+     * 发送时 Reader 按顺序输出骨架与外部内容，外部内容边读边转义，
+     * 每个请求额外占用的内存只有一块读缓冲区，与文档大小无关。
+     * 发布后不再修改，可被多个 Reader (重试) 同时读取。
+     */
+    class StreamingBody
+    {
+    public:
+        StreamingBody(std::string json, std::vector<BodySplice> splices);
+
+        const std::string &json() const { return _json; }
+        const std::vector<BodySplice> &splices() const { return _splices; }
+
+        // 完整展开为字符串，读取失败返回 false (测试与调试用，大文档会占用等量内存)
+        bool toString(std::string &out) const;
+
+        // 顺序读取器：每次发送 (含重试) 新建一个，不可跨线程并发使用
+        class Reader
+        {
+        public:
+            // onProgress 非空时，每次读出数据 (交给传输层发送) 后调用一次
+            explicit Reader(std::shared_ptr<const StreamingBody> body, std::function<void()> onProgress = nullptr);
+
+            // 最多写入 len 字节，返回实际字节数，0 表示结束，-1 表示数据源读取失败
+            ssize_t read(char *buf, size_t len);
+
+        private:
+            // 把当前数据块中的内容转义后写入 out，返回写入的字节数
+            size_t escape(char *out, size_t len);
+            // 暂存放不下的转义序列
+            void stash(const char *text, size_t len);
+
+        private:
+            std::shared_ptr<const StreamingBody> _body;
+            std::function<void()> _onProgress;
+            size_t _index = 0;         // 下一个外部内容
+            size_t _jsonPos = 0;       // 骨架的读取位置
+            bool _inContent = false;   // 正在输出外部内容
+            bool _sourceEof = false;
+            bool _pendingCR = false;   // 数据块末尾的 \r，等待下一块判断是否为 \r\n
+            uint64_t _sourceOffset = 0;
+            const char *_chunk = nullptr; // 当前数据块 (读缓冲区或映射内存)
+            size_t _chunkPos = 0;
+            size_t _chunkLen = 0;
+            bool _chunkMapped = false;   // 当前数据块直接指向映射内存
+            std::unique_ptr<char[]> _buffer; // 读缓冲区，按需分配
+            char _pending[8];          // 未写出的转义序列 (最长 6 字节)
+            size_t _pendingPos = 0;
+            size_t _pendingLen = 0;
+        };
+
+    private:
+        std::string _json;
+        std::vector<BodySplice> _splices; // 按 _offset 升序
+    };
+
+    using StreamingBodyPtr = std::shared_ptr<const StreamingBody>;
+
+    // 设置请求体：没有外部内容时直接写入 request._body，否则构造 StreamingBody
+    void assignRequestBody(HttpRequest &request, std::string_view json, std::vector<BodySplice> splices);
+
+} // end ai_chat_sdk
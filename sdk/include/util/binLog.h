@@ -0,0 +1,167 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <fmt/args.h>
+#include <fmt/format.h>
+#include <spdlog/common.h>
+#include <spdlog/formatter.h>
+#include <spdlog/sinks/sink.h>
+
+// 二进制日志后端
+// 调用线程只把 (时间戳, 日志点, 原始参数) 以二进制形式写入本线程的无锁环形缓冲区，
+// 格式化、文件轮转、JSON 输出全部由后台线程完成；缓冲区满时丢弃并计数，不阻塞调用方。
+namespace mylog
+{
+    namespace binlog
+    {
+        using ArgStore = fmt::dynamic_format_arg_store<fmt::format_context>;
+        // 解码函数：从 cursor 读出参数并压入 store，cursor 前移
+        using DecodeFn = void (*)(const char *&cursor, ArgStore &store);
+
+        // 日志点：每个 INFO/ERR... 宏调用处一个静态实例，只在第一次执行时构造
+        struct LogSite
+        {
+            spdlog::level::level_enum _level;
+            const char *_file;
+            int _line;
+            std::string _format; // 含 "[{:>10s}:{:<4d}]" 前缀的完整格式串
+
+            LogSite(spdlog::level::level_enum level, const char *file, int line, std::string format)
+                : _level(level), _file(file), _line(line), _format(std::move(format))
+            {
+            }
+        };
+
+        // 参数规整：数值原样保存，字符串按 长度+字节 保存，其它类型在调用线程先格式化为字符串
+        template <typename T>
+        auto normalize(const T &value)
+        {
+            if constexpr (std::is_arithmetic<T>::value)
+                return value;
+            else if constexpr (std::is_enum<T>::value)
+                return static_cast<std::underlying_type_t<T>>(value);
+            else if constexpr (std::is_convertible<const T &, std::string_view>::value)
+                return std::string_view(value);
+            else
+                return fmt::format("{}", value);
+        }
+
+        template <typename T>
+        struct ArgCodec
+        {
+            static size_t size(const T &) { return sizeof(T); }
+            static void encode(char *&cursor, const T &value)
+            {
+                std::memcpy(cursor, &value, sizeof(T));
+                cursor += sizeof(T);
+            }
+            static void decode(const char *&cursor, ArgStore &store)
+            {
+                T value;
+                std::memcpy(&value, cursor, sizeof(T));
+                cursor += sizeof(T);
+                store.push_back(value);
+            }
+        };
+
+        template <>
+        struct ArgCodec<std::string_view>
+        {
+            static size_t size(std::string_view value) { return sizeof(uint32_t) + value.size(); }
+            static void encode(char *&cursor, std::string_view value)
+            {
+                uint32_t len = static_cast<uint32_t>(value.size());
+                std::memcpy(cursor, &len, sizeof(len));
+                std::memcpy(cursor + sizeof(len), value.data(), len);
+                cursor += sizeof(len) + len;
+            }
+            static void decode(const char *&cursor, ArgStore &store)
+            {
+                uint32_t len;
+                std::memcpy(&len, cursor, sizeof(len));
+                // store 会复制字符串，记录所在的缓冲区随后可以被回收
+                store.push_back(std::string(cursor + sizeof(len), len));
+                cursor += sizeof(len) + len;
+            }
+        };
+
+        template <>
+        struct ArgCodec<std::string> : ArgCodec<std::string_view>
+        {
+        };
+
+        template <typename... Args>
+        void decodeArgs(const char *&cursor, ArgStore &store)
+        {
+            (ArgCodec<Args>::decode(cursor, store), ...);
+        }
+
+        // 当前线程的环形缓冲区中预留 size 字节，空间不足或后端未运行时返回 nullptr (并计入丢弃数)
+        char *reserve(size_t size);
+        // 提交最近一次 reserve 的记录
+        void commit();
+
+        // 记录头：时间戳 + 日志点 + 解码函数，其后紧跟参数字节
+        struct RecordHeader
+        {
+            int64_t _timestampNs; // system_clock 纳秒
+            const LogSite *_site;
+            DecodeFn _decode;
+        };
+
+        template <typename... Args>
+        void writeNormalized(const LogSite &site, const Args &...args)
+        {
+            size_t size = sizeof(RecordHeader) + (size_t(0) + ... + ArgCodec<Args>::size(args));
+            char *cursor = reserve(size);
+            if (nullptr == cursor)
+            {
+                return;
+            }
+
+            RecordHeader header;
+            header._timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::system_clock::now().time_since_epoch())
+                                      .count();
+            header._site = &site;
+            header._decode = &decodeArgs<Args...>;
+            std::memcpy(cursor, &header, sizeof(header));
+            cursor += sizeof(header);
+            (ArgCodec<Args>::encode(cursor, args), ...);
+            commit();
+        }
+
+        template <typename... Args>
+        void write(const LogSite &site, const Args &...args)
+        {
+            writeNormalized(site, normalize(args)...);
+        }
+
+        // 启动后台线程：ringBytes 为每个线程缓冲区大小
+        // 输出格式由 sinks 各自的 formatter 决定，后台线程在 log_msg 中填入日志点的文件、行号与线程序号
+        void start(const std::string &loggerName, const std::vector<spdlog::sink_ptr> &sinks, size_t ringBytes);
+        // 取走所有缓冲区中的剩余记录并停止后台线程
+        void stop();
+
+        // 后端统计
+        struct Stats
+        {
+            uint64_t _written = 0; // 已输出的记录数
+            uint64_t _dropped = 0; // 缓冲区满或后端未运行而被丢弃的记录数
+            uint64_t _threads = 0; // 当前注册的线程缓冲区数
+        };
+        Stats stats();
+
+        // 每条日志一行 JSON：ts (纳秒)、logger、level、thread、file / line (有来源位置时)、msg
+        // 设置到 logger 上 (logger 会复制给所有 sink)，二进制后端与直接调用 getLogger() 的输出格式一致
+        std::unique_ptr<spdlog::formatter> jsonFormatter();
+
+    } // end binlog
+} // end mylog
@@ -0,0 +1,172 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+namespace ai_chat_sdk
+{
+    // 紧凑 JSON 写入器：直接追加到 std::pmr::string，不构造 Json::Value 树
+    // 只负责逗号与转义，调用方保证 begin/end 配对以及对象中 key 与 value 交替出现
+    class JsonWriter
+    {
+    public:
+        explicit JsonWriter(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+            : _out(resource)
+        {
+        }
+
+        JsonWriter &beginObject()
+        {
+            separator();
+            _out += '{';
+            _first = true;
+            return *this;
+        }
+        JsonWriter &endObject()
+        {
+            _out += '}';
+            _first = false;
+            return *this;
+        }
+        JsonWriter &beginArray()
+        {
+            separator();
+            _out += '[';
+            _first = true;
+            return *this;
+        }
+        JsonWriter &endArray()
+        {
+            _out += ']';
+            _first = false;
+            return *this;
+        }
+
+        JsonWriter &key(std::string_view name)
+        {
+            separator();
+            appendString(name);
+            _out += ':';
+            _afterKey = true;
+            return *this;
+        }
+
+        JsonWriter &value(std::string_view text)
+        {
+            separator();
+            appendString(text);
+            return *this;
+        }
+        JsonWriter &value(const char *text) { return value(std::string_view(text)); }
+        JsonWriter &value(const std::string &text) { return value(std::string_view(text)); }
+        JsonWriter &value(bool flag)
+        {
+            separator();
+            _out += flag ? "true" : "false";
+            return *this;
+        }
+        JsonWriter &value(int number) { return value(static_cast<long long>(number)); }
+        JsonWriter &value(long long number)
+        {
+            separator();
+            char buf[32];
+            std::to_chars_result result = std::to_chars(buf, buf + sizeof(buf), number);
+            _out.append(buf, static_cast<size_t>(result.ptr - buf));
+            return *this;
+        }
+        JsonWriter &value(double number)
+        {
+            separator();
+            if (!std::isfinite(number))
+            {
+                _out += "null";
+                return *this;
+            }
+            // 能精确还原的最短表示 (0.7 而不是 0.69999999999999996)；
+            // to_chars 不受全局 locale 影响，小数点始终是 '.'
+            char buf[32];
+            std::to_chars_result result = std::to_chars(buf, buf + sizeof(buf), number);
+            _out.append(buf, static_cast<size_t>(result.ptr - buf));
+            return *this;
+        }
+
+        // 外部字符串值：写出分隔符后返回当前偏移，值本身 (含引号) 由调用方在该偏移处插入，见 StreamingBody
+        size_t externalValue()
+        {
+            separator();
+            return _out.size();
+        }
+
+        const std::pmr::string &str() const { return _out; }
+        std::string_view view() const { return _out; }
+
+    private:
+        void separator()
+        {
+            if (_afterKey)
+            {
+                _afterKey = false;
+                return;
+            }
+            if (!_first)
+                _out += ',';
+            _first = false;
+        }
+
+        void appendString(std::string_view text)
+        {
+            static const char hex[] = "0123456789abcdef";
+            _out += '"';
+            size_t plainStart = 0;
+            for (size_t i = 0; i < text.size(); ++i)
+            {
+                unsigned char c = static_cast<unsigned char>(text[i]);
+                if (c >= 0x20 && c != '"' && c != '\\')
+                    continue;
+
+                // 连续的普通字符整段追加
+                _out.append(text.data() + plainStart, i - plainStart);
+                plainStart = i + 1;
+                switch (c)
+                {
+                case '"':
+                    _out += "\\\"";
+                    break;
+                case '\\':
+                    _out += "\\\\";
+                    break;
+                case '\n':
+                    _out += "\\n";
+                    break;
+                case '\r':
+                    _out += "\\r";
+                    break;
+                case '\t':
+                    _out += "\\t";
+                    break;
+                case '\b':
+                    _out += "\\b";
+                    break;
+                case '\f':
+                    _out += "\\f";
+                    break;
+                default:
+                    _out += "\\u00";
+                    _out += hex[c >> 4];
+                    _out += hex[c & 0xF];
+                    break;
+                }
+            }
+            _out.append(text.data() + plainStart, text.size() - plainStart);
+            _out += '"';
+        }
+
+    private:
+        std::pmr::string _out;
+        bool _first = true;     // 当前容器中尚未写入元素
+        bool _afterKey = false; // 刚写完 key，下一个值不需要逗号
+    };
+
+} // end ai_chat_sdk
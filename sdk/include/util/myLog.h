@@ -1,15 +1,37 @@
 #pragma once
+#include <atomic>
 #include <mutex>
 #include <spdlog/logger.h>
 #include <spdlog/spdlog.h>
+#include "binLog.h"
 
 namespace mylog
 {
+    // 日志后端
+    enum class LogBackend
+    {
+        Spdlog, // spdlog 异步日志器：调用线程格式化，共享队列 + 单个后台线程
+        Binary  // 二进制日志：调用线程写入每线程无锁环形缓冲区，后台线程延迟格式化
+    };
+
+    // 日志器选项
+    struct LoggerOptions
+    {
+        LogBackend _backend = LogBackend::Spdlog;
+        size_t _ringBytes = 1 << 20;            // Binary：每个线程的缓冲区大小，写满后丢弃并计数
+        size_t _maxFileSize = 64 * 1024 * 1024; // Binary：单个日志文件大小上限，超过后轮转
+        size_t _maxFiles = 5;                   // Binary：保留的轮转文件个数
+        bool _jsonOutput = false;               // Binary：每条日志输出一行 JSON
+    };
+
     class Logger
     {
     public:
-        static void initLogger(const std::string &loggerName, const std::string &loggerFile, spdlog::level::level_enum logLevel = spdlog::level::info);
+        static void initLogger(const std::string &loggerName, const std::string &loggerFile, spdlog::level::level_enum logLevel = spdlog::level::info,
+                               const LoggerOptions &options = LoggerOptions());
         static std::shared_ptr<spdlog::logger> getLogger();
+        // 是否使用二进制后端 (由日志宏在运行时判断)
+        static bool binaryEnabled() { return _binary.load(std::memory_order_relaxed); }
 
     private:
         Logger();
@@ -19,6 +41,7 @@ namespace mylog
     private:
         static std::shared_ptr<spdlog::logger> _logger;
         static std::mutex _mutex;
+        static std::atomic<bool> _binary;
     };
 
     // fmt
@@ -27,11 +50,30 @@ namespace mylog
     // 09:04:03 [aiChatServer][info   ][/home/bit/will/AIModelAcess/ai-model-acess/sdk/src/DataManager.cpp:15  ] Database opened successfully: chat.db
     // DBG("Database opened successfully: {}:{}", dbName, dbType);
 
-#define TRACE(format, ...) mylog::Logger::getLogger()->trace(std::string("[{:>10s}:{:<4d}]") + format, __FILE__, __LINE__, ##__VA_ARGS__)
-#define DBG(format, ...) mylog::Logger::getLogger()->debug(std::string("[{:>10s}:{:<4d}]") + format, __FILE__, __LINE__, ##__VA_ARGS__)
-#define INFO(format, ...) mylog::Logger::getLogger()->info(std::string("[{:>10s}:{:<4d}]") + format, __FILE__, __LINE__, ##__VA_ARGS__)
-#define WARN(format, ...) mylog::Logger::getLogger()->warn(std::string("[{:>10s}:{:<4d}]") + format, __FILE__, __LINE__, ##__VA_ARGS__)
-#define ERR(format, ...) mylog::Logger::getLogger()->error(std::string("[{:>10s}:{:<4d}]") + format, __FILE__, __LINE__, ##__VA_ARGS__)
-#define CRIT(format, ...) mylog::Logger::getLogger()->critical(std::string("[{:>10s}:{:<4d}]") + format, __FILE__, __LINE__, ##__VA_ARGS__)
+// 二进制后端：日志点在首次执行时构造且从不析构 (进程退出时后台线程可能仍在引用)，
+// 之后每次只写入二进制参数；级别过滤在调用线程完成
+#define MYLOG_LOG(lvl, method, format, ...)                                                                                                     \
+    do                                                                                                                                          \
+    {                                                                                                                                           \
+        if (mylog::Logger::binaryEnabled())                                                                                                     \
+        {                                                                                                                                       \
+            if (mylog::Logger::getLogger()->should_log(lvl))                                                                                    \
+            {                                                                                                                                   \
+                static const auto &_mylogSite = *new mylog::binlog::LogSite(lvl, __FILE__, __LINE__, std::string("[{:>10s}:{:<4d}]") + format); \
+                mylog::binlog::write(_mylogSite, ##__VA_ARGS__);                                                                                \
+            }                                                                                                                                   \
+        }                                                                                                                                       \
+        else                                                                                                                                    \
+        {                                                                                                                                       \
+            mylog::Logger::getLogger()->method(std::string("[{:>10s}:{:<4d}]") + format, __FILE__, __LINE__, ##__VA_ARGS__);                    \
+        }                                                                                                                                       \
+    } while (0)
+
+#define TRACE(format, ...) MYLOG_LOG(spdlog::level::trace, trace, format, ##__VA_ARGS__)
+#define DBG(format, ...) MYLOG_LOG(spdlog::level::debug, debug, format, ##__VA_ARGS__)
+#define INFO(format, ...) MYLOG_LOG(spdlog::level::info, info, format, ##__VA_ARGS__)
+#define WARN(format, ...) MYLOG_LOG(spdlog::level::warn, warn, format, ##__VA_ARGS__)
+#define ERR(format, ...) MYLOG_LOG(spdlog::level::err, error, format, ##__VA_ARGS__)
+#define CRIT(format, ...) MYLOG_LOG(spdlog::level::critical, critical, format, ##__VA_ARGS__)
 
 } // end mylog
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+
+// 向量运算内核 (语义缓存的余弦相似度)
+// x86-64 上运行时检测 CPU：支持 AVX2 + FMA 时使用 256 位内核，否则使用 SSE2；
+// aarch64 使用 NEON；其他平台使用标量实现。不需要额外的编译选项。
+namespace ai_chat_sdk
+{
+    namespace vecmath
+    {
+        // 点积；两个向量都已归一化时即为余弦相似度
+        float dot(const float *a, const float *b, size_t n);
+
+        // 原地归一化为单位向量，零向量保持不变；返回原始长度
+        float normalize(float *v, size_t n);
+
+        // 标量参考实现 (测试中用来校验 SIMD 内核)
+        float dotScalar(const float *a, const float *b, size_t n);
+
+        // 当前使用的内核名称："avx2" / "sse2" / "neon" / "scalar"
+        const char *kernelName();
+    }
+
+} // end ai_chat_sdk
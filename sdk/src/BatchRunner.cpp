@@ -0,0 +1,1097 @@
+#include "../include/BatchRunner.h"
+#include "../include/Deadline.h"
+#include "../include/transport/HttpTransport.h"
+#include "../include/util/myLog.h"
+#include "../include/util/jsonWriter.h"
+#include "../include/transport/StreamingBody.h"
+#include <jsoncpp/json/json.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        using Clock = std::chrono::steady_clock;
+
+        // 一行输入
+        struct BatchJob
+        {
+            uint64_t _index = 0;
+            std::string _id;
+            std::vector<Message> _messages;
+            std::map<std::string, std::string> _params;
+            std::string _error; // 非空表示输入无法解析
+        };
+
+        // 一行输出
+        struct BatchResult
+        {
+            uint64_t _index = 0;
+            std::string _id;
+            bool _write = true; // false：被取消，不写出，下次续跑重新执行
+            bool _ok = false;
+            std::string _content;
+            std::string _error;
+            TokenUsage _usage;
+        };
+
+        // 有界阻塞队列：队列满时 push 阻塞，用于在流水线各阶段之间施加背压
+        template <typename T>
+        class BoundedQueue
+        {
+        public:
+            explicit BoundedQueue(size_t capacity) : _capacity(capacity ? capacity : 1) {}
+
+            // 队列已关闭时返回 false
+            bool push(T item)
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _notFull.wait(lock, [this]()
+                              { return _items.size() < _capacity || _closed; });
+                if (_closed)
+                    return false;
+                _items.push_back(std::move(item));
+                _notEmpty.notify_one();
+                return true;
+            }
+
+            // 队列已关闭且为空时返回 false
+            bool pop(T &item)
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _notEmpty.wait(lock, [this]()
+                               { return !_items.empty() || _closed; });
+                if (_items.empty())
+                    return false;
+                item = std::move(_items.front());
+                _items.pop_front();
+                _notFull.notify_one();
+                return true;
+            }
+
+            void close()
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _closed = true;
+                _notEmpty.notify_all();
+                _notFull.notify_all();
+            }
+
+        private:
+            std::mutex _mutex;
+            std::condition_variable _notEmpty;
+            std::condition_variable _notFull;
+            std::deque<T> _items;
+            size_t _capacity;
+            bool _closed = false;
+        };
+
+        bool isBlank(const std::string &line)
+        {
+            return line.find_first_not_of(" \t\r") == std::string::npos;
+        }
+
+        bool parseJson(const char *begin, const char *end, Json::Value &root)
+        {
+            Json::CharReaderBuilder builder;
+            std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+            std::string errs;
+            return reader->parse(begin, end, &root, &errs);
+        }
+
+        bool parseJson(const std::string &text, Json::Value &root)
+        {
+            return parseJson(text.data(), text.data() + text.size(), root);
+        }
+
+        // 消息内容：字符串，或只含文本片段的数组 [{"type": "text", "text": "..."}] (按顺序拼接)
+        bool parseContent(const Json::Value &value, std::string &content)
+        {
+            if (value.isString())
+            {
+                content = value.asString();
+                return true;
+            }
+            if (!value.isArray())
+                return false;
+            for (const auto &part : value)
+            {
+                if (!part.isObject() || part["type"].asString() != "text" || !part["text"].isString())
+                    return false; // 图片等非文本片段无法放进 Message
+                content += part["text"].asString();
+            }
+            return true;
+        }
+
+        // 解析一行输入
+        void parseJob(const std::string &line, uint64_t index, BatchJob &job)
+        {
+            job = BatchJob();
+            job._index = index;
+            job._id = std::to_string(index);
+
+            Json::Value parsed;
+            if (!parseJson(line, parsed) || !parsed.isObject())
+            {
+                job._error = "invalid JSON";
+                return;
+            }
+            const Json::Value &root = parsed;
+            if (root["id"].isString())
+                job._id = root["id"].asString();
+
+            const Json::Value &messages = root["messages"];
+            if (messages.isArray())
+            {
+                // 逐项检查类型：jsoncpp 对类型不符的值调用 operator[] / asString 会抛出异常
+                for (const auto &msg : messages)
+                {
+                    std::string content;
+                    if (!msg.isObject() || !msg["role"].isString() || !parseContent(msg["content"], content))
+                    {
+                        job._error = "invalid message";
+                        return;
+                    }
+                    job._messages.emplace_back(msg["role"].asString(), std::move(content));
+                }
+            }
+            else if (root["prompt"].isString())
+            {
+                if (root["system"].isString())
+                    job._messages.emplace_back("system", root["system"].asString());
+                job._messages.emplace_back("user", root["prompt"].asString());
+            }
+            if (job._messages.empty())
+            {
+                job._error = "missing messages or prompt";
+                return;
+            }
+
+            // 请求参数统一转成字符串，与 sendMessage 的 requestParam 一致
+            const Json::Value &params = root["params"];
+            if (params.isObject())
+            {
+                for (const auto &name : params.getMemberNames())
+                {
+                    const Json::Value &value = params[name];
+                    if (value.isString() || value.isNumeric() || value.isBool())
+                        job._params[name] = value.asString();
+                }
+            }
+        }
+
+        // 请求参数写回 JSON 时恢复类型："true" / "false" 写为布尔，能完整解析为数字的写为数字
+        void writeParam(JsonWriter &writer, const std::string &name, const std::string &value)
+        {
+            writer.key(name);
+            if (value == "true" || value == "false")
+            {
+                writer.value(value == "true");
+                return;
+            }
+            if (!value.empty())
+            {
+                char *end = nullptr;
+                if (value.find_first_of(".eE") == std::string::npos)
+                {
+                    long long number = std::strtoll(value.c_str(), &end, 10);
+                    if (*end == '\0')
+                    {
+                        writer.value(number);
+                        return;
+                    }
+                }
+                else
+                {
+                    double number = std::strtod(value.c_str(), &end);
+                    if (*end == '\0')
+                    {
+                        writer.value(number);
+                        return;
+                    }
+                }
+            }
+            writer.value(value);
+        }
+
+        // 输出文件：每行写完立即 fflush，每 syncEvery 行 fsync 一次作为断点
+        class ResultWriter
+        {
+        public:
+            ResultWriter(size_t syncEvery) : _syncEvery(syncEvery ? syncEvery : 1) {}
+            ~ResultWriter() { close(); }
+
+            bool open(const std::string &file, bool truncate)
+            {
+                _file = std::fopen(file.c_str(), truncate ? "wb" : "ab");
+                return _file != nullptr;
+            }
+
+            void write(const BatchResult &result, BatchReport &report)
+            {
+                JsonWriter writer;
+                writer.beginObject();
+                writer.key("index").value(static_cast<long long>(result._index));
+                writer.key("id").value(result._id);
+                writer.key("ok").value(result._ok);
+                if (result._ok)
+                {
+                    writer.key("content").value(result._content);
+                    if (result._usage._valid)
+                    {
+                        writer.key("usage").beginObject();
+                        writer.key("prompt_tokens").value(static_cast<long long>(result._usage._promptTokens));
+                        writer.key("cached_tokens").value(static_cast<long long>(result._usage._cachedPromptTokens));
+                        writer.key("completion_tokens").value(static_cast<long long>(result._usage._completionTokens));
+                        writer.endObject();
+                    }
+                    ++report._succeeded;
+                    report._promptTokens += result._usage._promptTokens;
+                    report._completionTokens += result._usage._completionTokens;
+                }
+                else
+                {
+                    writer.key("error").value(result._error);
+                    ++report._failed;
+                }
+                writer.endObject();
+
+                std::string_view line = writer.view();
+                std::fwrite(line.data(), 1, line.size(), _file);
+                std::fputc('\n', _file);
+                std::fflush(_file);
+                if (++_unsynced >= _syncEvery)
+                    sync();
+            }
+
+            void sync()
+            {
+                if (_file && _unsynced > 0)
+                {
+                    ::fsync(fileno(_file));
+                    _unsynced = 0;
+                }
+            }
+
+            void close()
+            {
+                if (_file)
+                {
+                    sync();
+                    std::fclose(_file);
+                    _file = nullptr;
+                }
+            }
+
+        private:
+            FILE *_file = nullptr;
+            size_t _syncEvery;
+            size_t _unsynced = 0;
+        };
+
+        // 读取断点：输出文件中已完成的行号
+        // 同时把输出文件压缩为只含已完成行 (去掉崩溃时写了一半的行，以及需要重试的失败行)
+        bool loadCheckpoint(const std::string &outputFile, bool retryFailed, std::unordered_set<uint64_t> &completed)
+        {
+            std::ifstream in(outputFile, std::ios::binary);
+            if (!in.is_open())
+                return true; // 首次运行
+
+            const std::string tmpFile = outputFile + ".tmp";
+            std::ofstream out(tmpFile, std::ios::binary | std::ios::trunc);
+            if (!out.is_open())
+            {
+                ERR("BatchRunner: cannot write {}", tmpFile);
+                return false;
+            }
+
+            std::string line;
+            uint64_t dropped = 0;
+            while (std::getline(in, line))
+            {
+                Json::Value parsed;
+                if (isBlank(line) || !parseJson(line, parsed) || !parsed.isObject() || !parsed["index"].isUInt64())
+                {
+                    ++dropped;
+                    continue;
+                }
+                const Json::Value &root = parsed;
+                if (!root["ok"].asBool() && retryFailed)
+                {
+                    ++dropped;
+                    continue;
+                }
+                if (!completed.insert(root["index"].asUInt64()).second)
+                    continue; // 重复行
+                out << line << '\n';
+            }
+            in.close();
+            out.close();
+
+            std::error_code ec;
+            std::filesystem::rename(tmpFile, outputFile, ec);
+            if (ec)
+            {
+                ERR("BatchRunner: rename {} failed: {}", tmpFile, ec.message());
+                return false;
+            }
+            INFO("BatchRunner: resume from {}, {} lines completed, {} lines will be retried", outputFile, completed.size(), dropped);
+            return true;
+        }
+
+        // 读取输出行的行号：ResultWriter 总是把 index 写在最前，其它格式回退到完整解析
+        bool lineIndex(const std::string &line, uint64_t &index)
+        {
+            const std::string_view prefix = "{\"index\":";
+            if (line.compare(0, prefix.size(), prefix) == 0)
+            {
+                char *end = nullptr;
+                index = std::strtoull(line.c_str() + prefix.size(), &end, 10);
+                if (end != line.c_str() + prefix.size() && (*end == ',' || *end == '}'))
+                    return true;
+            }
+            Json::Value parsed;
+            if (!parseJson(line, parsed) || !parsed.isObject() || !parsed["index"].isUInt64())
+                return false;
+            index = parsed["index"].asUInt64();
+            return true;
+        }
+
+        // 把输出文件按行号重排 (外部排序)：每累积 kSortRunBytes 字节排好序写成一个临时文件，再多路归并
+        // 内存占用与输出文件大小无关；已经有序时不改写文件
+        bool sortOutputByIndex(const std::string &outputFile)
+        {
+            const size_t kSortRunBytes = 64 << 20;
+
+            // 1. 检查是否已经有序
+            {
+                std::ifstream in(outputFile, std::ios::binary);
+                std::string line;
+                uint64_t index = 0;
+                uint64_t prev = 0;
+                bool first = true;
+                bool sorted = true;
+                while (sorted && std::getline(in, line))
+                {
+                    if (!lineIndex(line, index))
+                        continue;
+                    sorted = first || index > prev;
+                    prev = index;
+                    first = false;
+                }
+                if (sorted)
+                    return true;
+            }
+
+            // 2. 分段排序，写出临时文件
+            std::vector<std::string> runs;
+            std::vector<std::pair<uint64_t, std::string>> chunk;
+            size_t chunkBytes = 0;
+            auto flushRun = [&]()
+            {
+                std::sort(chunk.begin(), chunk.end(), [](const auto &a, const auto &b)
+                          { return a.first < b.first; });
+                runs.push_back(outputFile + ".run" + std::to_string(runs.size()));
+                std::ofstream run(runs.back(), std::ios::binary | std::ios::trunc);
+                for (const auto &item : chunk)
+                    run << item.second << '\n';
+                chunk.clear();
+                chunkBytes = 0;
+                return run.good();
+            };
+            bool ok = true;
+            {
+                std::ifstream in(outputFile, std::ios::binary);
+                std::string line;
+                uint64_t index = 0;
+                while (ok && std::getline(in, line))
+                {
+                    if (!lineIndex(line, index))
+                        continue;
+                    chunkBytes += line.size();
+                    chunk.emplace_back(index, std::move(line));
+                    if (chunkBytes >= kSortRunBytes)
+                        ok = flushRun();
+                }
+                if (ok && !chunk.empty())
+                    ok = flushRun();
+            }
+
+            // 3. 多路归并到临时文件，再替换输出文件
+            const std::string tmpFile = outputFile + ".tmp";
+            if (ok)
+            {
+                std::vector<std::unique_ptr<std::ifstream>> inputs;
+                using Head = std::pair<uint64_t, size_t>; // (行号, 第几个临时文件)
+                std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+                std::vector<std::string> lines(runs.size());
+                auto advance = [&](size_t i)
+                {
+                    uint64_t index = 0;
+                    while (std::getline(*inputs[i], lines[i]))
+                    {
+                        if (lineIndex(lines[i], index))
+                        {
+                            heads.emplace(index, i);
+                            return;
+                        }
+                    }
+                };
+                for (size_t i = 0; i < runs.size(); ++i)
+                {
+                    inputs.emplace_back(new std::ifstream(runs[i], std::ios::binary));
+                    advance(i);
+                }
+                std::ofstream out(tmpFile, std::ios::binary | std::ios::trunc);
+                while (!heads.empty())
+                {
+                    size_t i = heads.top().second;
+                    heads.pop();
+                    out << lines[i] << '\n';
+                    advance(i);
+                }
+                out.close();
+                ok = out.good();
+            }
+            for (const auto &run : runs)
+                std::filesystem::remove(run);
+
+            std::error_code ec;
+            if (ok)
+                std::filesystem::rename(tmpFile, outputFile, ec);
+            if (!ok || ec)
+            {
+                ERR("BatchRunner: sort {} by index failed", outputFile);
+                std::filesystem::remove(tmpFile, ec);
+                return false;
+            }
+            return true;
+        }
+
+        // 定期输出进度
+        class ProgressLogger
+        {
+        public:
+            ProgressLogger(double intervalSec) : _interval(intervalSec), _start(Clock::now()), _last(_start) {}
+
+            void tick(const BatchReport &report)
+            {
+                auto now = Clock::now();
+                if (_interval <= 0 || std::chrono::duration<double>(now - _last).count() < _interval)
+                    return;
+                _last = now;
+                BatchReport snapshot = report;
+                snapshot._elapsedSec = elapsed();
+                INFO("BatchRunner progress: {} ok, {} failed, {:.1f} req/s, {:.1f} tokens/s", snapshot._succeeded, snapshot._failed,
+                     snapshot.requestsPerSec(), snapshot.tokensPerSec());
+            }
+
+            double elapsed() const { return std::chrono::duration<double>(Clock::now() - _start).count(); }
+
+        private:
+            double _interval;
+            Clock::time_point _start;
+            Clock::time_point _last;
+        };
+
+        // 带取消检查的等待，被取消时返回 false
+        bool sleepUnlessCancelled(int ms, const CancelTokenPtr &cancelToken)
+        {
+            auto deadline = Clock::now() + std::chrono::milliseconds(ms);
+            while (Clock::now() < deadline)
+            {
+                if (cancelToken && cancelToken->isCancelled())
+                    return false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+            return !(cancelToken && cancelToken->isCancelled());
+        }
+
+        // 调用 Batch API 的 JSON 接口；streamingBody 非空时代替 body 边读边发
+        bool callBatchApi(const HttpTransportPtr &transport, const std::string &apiKey, const std::string &method,
+                          const std::string &path, const std::string &contentType, std::string body,
+                          Json::Value &out, const CancelTokenPtr &cancelToken, StreamingBodyPtr streamingBody = nullptr)
+        {
+            HttpRequest request;
+            request._method = method;
+            request._path = path;
+            request._headers = {{"Authorization", "Bearer " + apiKey}};
+            if (!contentType.empty())
+                request._headers["Content-Type"] = contentType;
+            request._body = std::move(body);
+            request._streamingBody = std::move(streamingBody);
+            request._readTimeoutSec = 300;
+
+            HttpResponse response;
+            if (!transport->send(request, response, nullptr, cancelToken))
+            {
+                ERR("BatchRunner: {} {} failed (Network Error): {}", method, path, response._error);
+                return false;
+            }
+            if (response._status != 200)
+            {
+                ERR("BatchRunner: {} {} failed. Status: {}, Body: {}", method, path, response._status, response._body);
+                return false;
+            }
+            if (!parseJson(response._body, out) || !out.isObject())
+            {
+                ERR("BatchRunner: {} {} returned invalid JSON", method, path);
+                return false;
+            }
+            return true;
+        }
+
+        // 解析 Batch API 输出 / 错误文件中的一行
+        // {"custom_id": "行号:id", "response": {"status_code": 200, "body": {...}}, "error": null}
+        bool parseBatchOutputLine(const std::string &line, BatchResult &result)
+        {
+            Json::Value parsed;
+            if (!parseJson(line, parsed) || !parsed.isObject())
+                return false;
+            const Json::Value &root = parsed;
+
+            std::string customId = root["custom_id"].asString();
+            size_t colon = customId.find(':');
+            char *end = nullptr;
+            result = BatchResult();
+            result._index = std::strtoull(customId.c_str(), &end, 10);
+            if (end == customId.c_str())
+                return false;
+            result._id = colon == std::string::npos ? std::to_string(result._index) : customId.substr(colon + 1);
+
+            const Json::Value &error = root["error"];
+            const Json::Value &response = root["response"];
+            const Json::Value &body = response["body"];
+            if (error.isObject())
+            {
+                result._error = error["message"].asString();
+                return true;
+            }
+            if (response["status_code"].asInt() != 200)
+            {
+                result._error = body["error"]["message"].isString() ? body["error"]["message"].asString()
+                                                                     : "HTTP Status: " + std::to_string(response["status_code"].asInt());
+                return true;
+            }
+            const Json::Value &choices = body["choices"];
+            if (!choices.isArray() || choices.empty() || !choices[0]["message"]["content"].isString())
+            {
+                result._error = "content field not found";
+                return true;
+            }
+            result._ok = true;
+            result._content = choices[0]["message"]["content"].asString();
+            parseUsage(body["usage"], result._usage);
+            return true;
+        }
+    }
+
+    BatchRunner::BatchRunner(std::shared_ptr<LLMProvider> provider, const BatchOptions &options)
+        : _provider(std::move(provider)), _options(options)
+    {
+        if (_options._concurrency == 0)
+            _options._concurrency = 1;
+        if (_options._reorderWindow == 0)
+            _options._reorderWindow = _options._concurrency * 64;
+        if (_options._maxAttempts < 1)
+            _options._maxAttempts = 1;
+    }
+
+    bool BatchRunner::run(const std::string &inputFile, const std::string &outputFile, BatchReport &report,
+                          CancelTokenPtr cancelToken)
+    {
+        report = BatchReport();
+        bool ok = _options._useBatchApi ? runBatchApi(inputFile, outputFile, report, cancelToken)
+                                        : runOnline(inputFile, outputFile, report, cancelToken);
+        INFO("BatchRunner finished: total {}, skipped {}, ok {}, failed {}, cancelled {}, {:.1f}s, {:.1f} req/s, {:.1f} tokens/s",
+             report._total, report._skipped, report._succeeded, report._failed, report._cancelled, report._elapsedSec,
+             report.requestsPerSec(), report.tokensPerSec());
+        return ok;
+    }
+
+    bool BatchRunner::runOnline(const std::string &inputFile, const std::string &outputFile, BatchReport &report,
+                                const CancelTokenPtr &cancelToken)
+    {
+        if (!_provider || !_provider->isAvailable())
+        {
+            ERR("BatchRunner: provider is not available.");
+            return false;
+        }
+
+        // 1. 读取断点
+        std::unordered_set<uint64_t> completed;
+        if (_options._resume && !loadCheckpoint(outputFile, _options._retryFailed, completed))
+            return false;
+
+        std::ifstream in(inputFile, std::ios::binary);
+        if (!in.is_open())
+        {
+            ERR("BatchRunner: cannot open input {}", inputFile);
+            return false;
+        }
+        ResultWriter writer(_options._syncEvery);
+        if (!writer.open(outputFile, !_options._resume))
+        {
+            ERR("BatchRunner: cannot open output {}", outputFile);
+            return false;
+        }
+
+        ProgressLogger progress(_options._progressIntervalSec);
+        BoundedQueue<BatchJob> jobs(_options._concurrency * 2);
+        BoundedQueue<BatchResult> results(_options._concurrency * 2);
+
+        // 有序写出时读取位置不能领先已写出位置太多，避免暂存的乱序结果无限增长
+        std::mutex windowMutex;
+        std::condition_variable windowCond;
+        uint64_t nextToWrite = 0;
+        CancelHookGuard hookGuard(cancelToken, [&]()
+                                  {
+                                      std::lock_guard<std::mutex> lock(windowMutex);
+                                      windowCond.notify_all();
+                                  });
+        auto cancelled = [&]()
+        { return cancelToken && cancelToken->isCancelled(); };
+
+        // 读取线程与每个工作线程都会写 results，最后一个退出的负责关闭
+        std::atomic<size_t> producers{_options._concurrency + 1};
+        auto producerDone = [&]()
+        {
+            if (producers.fetch_sub(1) == 1)
+                results.close();
+        };
+
+        // 2. 读取：逐行解析，已完成的行直接跳过
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> skipped{0};
+        std::thread reader([&]()
+                           {
+                               std::string line;
+                               uint64_t index = 0;
+                               while (!cancelled() && std::getline(in, line))
+                               {
+                                   if (isBlank(line))
+                                       continue;
+                                   uint64_t current = index++;
+                                   total.fetch_add(1, std::memory_order_relaxed);
+                                   if (completed.count(current))
+                                   {
+                                       skipped.fetch_add(1, std::memory_order_relaxed);
+                                       continue;
+                                   }
+
+                                   if (_options._ordered)
+                                   {
+                                       std::unique_lock<std::mutex> lock(windowMutex);
+                                       // 断点中已完成的行不会再写出，视为已写出，否则连续的已完成行超过窗口时读取永远等不到
+                                       while (completed.count(nextToWrite))
+                                           ++nextToWrite;
+                                       windowCond.wait(lock, [&]()
+                                                       { return current < nextToWrite + _options._reorderWindow || cancelled(); });
+                                   }
+                                   if (cancelled())
+                                       break;
+
+                                   BatchJob job;
+                                   parseJob(line, current, job);
+                                   if (!job._error.empty())
+                                   {
+                                       BatchResult result;
+                                       result._index = job._index;
+                                       result._id = job._id;
+                                       result._error = job._error;
+                                       results.push(std::move(result));
+                                   }
+                                   else
+                                   {
+                                       jobs.push(std::move(job));
+                                   }
+                               }
+                               jobs.close();
+                               producerDone();
+                           });
+
+        // 3. 请求：固定数量的工作线程，失败按退避重试
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < _options._concurrency; ++i)
+        {
+            workers.emplace_back([&]()
+                                 {
+                                     BatchJob job;
+                                     while (jobs.pop(job))
+                                     {
+                                         BatchResult result;
+                                         result._index = job._index;
+                                         result._id = job._id;
+                                         // 单行的总预算覆盖所有重试与退避，每次尝试只拿到剩余的部分
+                                         int64_t lineDeadlineMs = _options._requestTimeoutMs > 0 ? steadyNowMs() + _options._requestTimeoutMs : 0;
+                                         bool outOfBudget = false;
+                                         int attempts = 0;
+                                         for (int attempt = 1; attempt <= _options._maxAttempts && !cancelled(); ++attempt)
+                                         {
+                                             int backoffMs = attempt > 1 ? _options._retryBackoffMs * (attempt - 1) : 0;
+                                             if (lineDeadlineMs > 0 && steadyNowMs() + backoffMs >= lineDeadlineMs)
+                                             {
+                                                 outOfBudget = true;
+                                                 break;
+                                             }
+                                             if (backoffMs > 0 && !sleepUnlessCancelled(backoffMs, cancelToken))
+                                                 break;
+                                             ++attempts;
+                                             if (lineDeadlineMs > 0)
+                                             {
+                                                 std::map<std::string, std::string> params = job._params;
+                                                 int64_t remainingMs = lineDeadlineMs - steadyNowMs();
+                                                 TimeoutPolicy requested;
+                                                 applyTimeoutParams(params, requested);
+                                                 if (requested._totalMs > 0)
+                                                     remainingMs = std::min(remainingMs, requested._totalMs);
+                                                 params["timeout_ms"] = std::to_string(std::max<int64_t>(remainingMs, 1));
+                                                 result._content = _provider->sendMessage(job._messages, params, cancelToken, &result._usage);
+                                             }
+                                             else
+                                             {
+                                                 result._content = _provider->sendMessage(job._messages, job._params, cancelToken, &result._usage);
+                                             }
+                                             if (!result._content.empty())
+                                             {
+                                                 result._ok = true;
+                                                 break;
+                                             }
+                                         }
+                                         if (cancelled())
+                                             result._write = false;
+                                         else if (!result._ok && (outOfBudget || (lineDeadlineMs > 0 && steadyNowMs() >= lineDeadlineMs)))
+                                             result._error = "deadline exceeded after " + std::to_string(attempts) + " attempts";
+                                         else if (!result._ok)
+                                             result._error = "request failed after " + std::to_string(_options._maxAttempts) + " attempts";
+                                         results.push(std::move(result));
+                                     }
+                                     producerDone();
+                                 });
+        }
+
+        // 4. 写出 (当前线程)
+        std::map<uint64_t, BatchResult> pending; // 有序模式下暂存的乱序结果
+        auto emit = [&](const BatchResult &result)
+        {
+            if (result._write)
+                writer.write(result, report);
+            else
+                ++report._cancelled;
+            progress.tick(report);
+        };
+        BatchResult result;
+        while (results.pop(result))
+        {
+            if (!_options._ordered)
+            {
+                emit(result);
+                continue;
+            }
+
+            pending.emplace(result._index, std::move(result));
+            uint64_t next;
+            {
+                std::lock_guard<std::mutex> lock(windowMutex);
+                next = nextToWrite;
+            }
+            while (true)
+            {
+                while (completed.count(next))
+                    ++next;
+                auto it = pending.find(next);
+                if (it == pending.end())
+                    break;
+                emit(it->second);
+                pending.erase(it);
+                ++next;
+            }
+            if (next != nextToWrite)
+            {
+                std::lock_guard<std::mutex> lock(windowMutex);
+                nextToWrite = std::max(nextToWrite, next);
+                windowCond.notify_all();
+            }
+        }
+        // 被取消时可能留下不连续的结果，按行号顺序写完
+        for (auto &item : pending)
+            emit(item.second);
+
+        reader.join();
+        for (auto &worker : workers)
+            worker.join();
+        writer.close();
+
+        // 续跑的结果追加在已完成行之后，全部完成后把整个文件重排为输入顺序
+        // 被取消时保持现状 (每次运行写出的部分各自有序)，下次续跑完成后再重排
+        if (_options._ordered && !completed.empty() && !cancelled() && !sortOutputByIndex(outputFile))
+            return false;
+
+        report._total = total;
+        report._skipped = skipped;
+        report._elapsedSec = progress.elapsed();
+        return true;
+    }
+
+    bool BatchRunner::runBatchApi(const std::string &inputFile, const std::string &outputFile, BatchReport &report,
+                                  const CancelTokenPtr &cancelToken)
+    {
+        ProgressLogger progress(_options._progressIntervalSec);
+        const std::string stateFile = outputFile + ".batch";           // 已提交的批任务 ID
+        const std::string requestFile = outputFile + ".requests.jsonl"; // 上传给服务端的请求文件
+        std::string model = _options._model;
+        if (model.empty() && _provider)
+            model = _provider->getModelName();
+
+        // 1. 读取断点
+        std::unordered_set<uint64_t> completed;
+        if (_options._resume && !loadCheckpoint(outputFile, _options._retryFailed, completed))
+            return false;
+        ResultWriter writer(_options._syncEvery);
+        if (!writer.open(outputFile, !_options._resume))
+        {
+            ERR("BatchRunner: cannot open output {}", outputFile);
+            return false;
+        }
+
+        HttpTransportPtr transport = createTransport(_options._transport, _options._batchEndpoint);
+
+        // 结果按到达顺序写出，有序模式下全部写完后再对输出文件做外部排序，内存中不暂存结果
+        auto deliver = [&](BatchResult &result)
+        {
+            writer.write(result, report);
+            progress.tick(report);
+        };
+        auto finish = [&]()
+        {
+            writer.close();
+            return !_options._ordered || sortOutputByIndex(outputFile);
+        };
+
+        // 2. 已经提交过的批任务直接继续轮询，否则生成请求文件并提交
+        std::string batchId;
+        if (_options._resume)
+        {
+            std::ifstream state(stateFile);
+            std::getline(state, batchId);
+        }
+        if (batchId.empty())
+        {
+            std::ifstream in(inputFile, std::ios::binary);
+            std::ofstream requests(requestFile, std::ios::binary | std::ios::trunc);
+            if (!in.is_open() || !requests.is_open())
+            {
+                ERR("BatchRunner: cannot open input {} or request file {}", inputFile, requestFile);
+                return false;
+            }
+
+            // 2.1 逐行转换为 Batch API 请求：custom_id 为 "行号:id"
+            std::string line;
+            uint64_t index = 0;
+            uint64_t submitted = 0;
+            BatchJob job;
+            while (std::getline(in, line))
+            {
+                if (isBlank(line))
+                    continue;
+                uint64_t current = index++;
+                ++report._total;
+                if (completed.count(current))
+                {
+                    ++report._skipped;
+                    continue;
+                }
+                parseJob(line, current, job);
+                if (!job._error.empty())
+                {
+                    BatchResult result;
+                    result._index = job._index;
+                    result._id = job._id;
+                    result._error = job._error;
+                    deliver(result);
+                    continue;
+                }
+
+                JsonWriter request;
+                request.beginObject();
+                request.key("custom_id").value(std::to_string(job._index) + ":" + job._id);
+                request.key("method").value("POST");
+                request.key("url").value("/v1/chat/completions");
+                request.key("body").beginObject();
+                request.key("model").value(model);
+                request.key("messages").beginArray();
+                for (const auto &msg : job._messages)
+                {
+                    request.beginObject().key("role").value(msg._role).key("content").value(msg._content).endObject();
+                }
+                request.endArray();
+                for (const auto &param : job._params)
+                {
+                    // 超时参数只对同步请求有意义，不写入批任务
+                    if (!isTimeoutParam(param.first))
+                        writeParam(request, param.first, param.second);
+                }
+                request.endObject();
+                request.endObject();
+                requests << request.view() << '\n';
+                ++submitted;
+            }
+            requests.close();
+            if (submitted == 0)
+            {
+                std::filesystem::remove(requestFile);
+                report._elapsedSec = progress.elapsed();
+                return finish();
+            }
+
+            // 2.2 上传请求文件 (multipart/form-data, purpose=batch)
+            // 请求文件映射后原样插入 multipart 骨架，边读边发，不在内存中拼出完整请求体
+            ContentSourcePtr content = MappedFileSource::open(requestFile);
+            if (!content)
+                return false;
+            const std::string boundary = "----ai-chat-sdk-batch-boundary";
+            std::string skeleton;
+            skeleton += "--" + boundary + "\r\n";
+            skeleton += "Content-Disposition: form-data; name=\"purpose\"\r\n\r\nbatch\r\n";
+            skeleton += "--" + boundary + "\r\n";
+            skeleton += "Content-Disposition: form-data; name=\"file\"; filename=\"requests.jsonl\"\r\n";
+            skeleton += "Content-Type: application/jsonl\r\n\r\n";
+            BodySplice splice;
+            splice._offset = skeleton.size();
+            splice._source = std::move(content);
+            splice._raw = true;
+            skeleton += "\r\n--" + boundary + "--\r\n";
+            std::vector<BodySplice> splices;
+            splices.push_back(std::move(splice));
+            auto body = std::make_shared<StreamingBody>(std::move(skeleton), std::move(splices));
+
+            Json::Value file;
+            if (!callBatchApi(transport, _options._apiKey, "POST", "/v1/files", "multipart/form-data; boundary=" + boundary,
+                              "", file, cancelToken, std::move(body)))
+                return false;
+
+            // 2.3 创建批任务，并记录 ID，崩溃后续跑时直接轮询
+            JsonWriter create;
+            create.beginObject();
+            create.key("input_file_id").value(file["id"].asString());
+            create.key("endpoint").value("/v1/chat/completions");
+            create.key("completion_window").value("24h");
+            create.endObject();
+            Json::Value batch;
+            if (!callBatchApi(transport, _options._apiKey, "POST", "/v1/batches", "application/json", std::string(create.view()),
+                              batch, cancelToken))
+                return false;
+            batchId = batch["id"].asString();
+            std::ofstream state(stateFile, std::ios::trunc);
+            state << batchId << '\n';
+            INFO("BatchRunner: submitted batch {} with {} requests", batchId, submitted);
+        }
+
+        // 3. 轮询批任务状态
+        Json::Value batch;
+        std::string status;
+        while (true)
+        {
+            if (!callBatchApi(transport, _options._apiKey, "GET", "/v1/batches/" + batchId, "", "", batch, cancelToken))
+                return false;
+            const Json::Value &root = batch;
+            if (root["status"].asString() != status)
+            {
+                status = root["status"].asString();
+                INFO("BatchRunner: batch {} status {}, completed {}/{}", batchId, status,
+                     root["request_counts"]["completed"].asUInt64(), root["request_counts"]["total"].asUInt64());
+            }
+            if (status == "completed" || status == "failed" || status == "expired" || status == "cancelled")
+                break;
+            if (!sleepUnlessCancelled(_options._pollIntervalSec * 1000, cancelToken))
+            {
+                // 批任务在服务端继续执行，续跑时从状态文件恢复轮询
+                WARN("BatchRunner: cancelled while waiting for batch {}", batchId);
+                report._elapsedSec = progress.elapsed();
+                return finish();
+            }
+        }
+
+        // 4. 下载结果与错误文件，逐行解析
+        auto download = [&](const std::string &fileId)
+        {
+            HttpRequest request;
+            request._method = "GET";
+            request._path = "/v1/files/" + fileId + "/content";
+            request._headers = {{"Authorization", "Bearer " + _options._apiKey}};
+            request._readTimeoutSec = 300;
+
+            HttpResponse response;
+            std::string buffer;
+            BatchResult result;
+            auto consume = [&](const std::string &line)
+            {
+                if (isBlank(line))
+                    return;
+                if (!parseBatchOutputLine(line, result))
+                {
+                    WARN("BatchRunner: invalid batch output line: {}", line);
+                    return;
+                }
+                if (!completed.count(result._index))
+                    deliver(result);
+            };
+            auto onBody = [&](const char *data, size_t len)
+            {
+                buffer.append(data, len);
+                if (response._status != 200)
+                    return true; // 错误响应整体保留，用于日志
+                size_t start = 0;
+                size_t pos = 0;
+                while ((pos = buffer.find('\n', start)) != std::string::npos)
+                {
+                    consume(buffer.substr(start, pos - start));
+                    start = pos + 1;
+                }
+                buffer.erase(0, start);
+                return true;
+            };
+            if (!transport->send(request, response, onBody, cancelToken) || response._status != 200)
+            {
+                ERR("BatchRunner: download {} failed. Status: {}, Error: {}, Body: {}", fileId, response._status, response._error, buffer);
+                return false;
+            }
+            consume(buffer);
+            return true;
+        };
+
+        const Json::Value &root = batch;
+        bool ok = true;
+        if (root["output_file_id"].isString())
+            ok = download(root["output_file_id"].asString()) && ok;
+        if (root["error_file_id"].isString())
+            ok = download(root["error_file_id"].asString()) && ok;
+        if (!finish() || !ok)
+            return false;
+        if (status != "completed")
+            WARN("BatchRunner: batch {} ended with status {}, missing lines will be retried on resume", batchId, status);
+
+        // 5. 结果已落盘，清理状态文件
+        std::filesystem::remove(stateFile);
+        std::filesystem::remove(requestFile);
+        report._elapsedSec = progress.elapsed();
+        return true;
+    }
+
+} // end ai_chat_sdk
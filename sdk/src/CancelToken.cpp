@@ -0,0 +1,58 @@
+#include "../include/CancelToken.h"
+
+namespace ai_chat_sdk
+{
+    std::atomic<uint64_t> CancelToken::_cancelledRequests{0};
+
+    void CancelToken::cancel()
+    {
+        // 持锁设置标记并执行回调：与 addHook 互斥，每个回调最多执行一次；
+        // removeHook 会等待正在执行的回调结束，保证守卫析构后回调引用的对象 (如 httplib::Client) 不会再被访问
+        std::lock_guard<std::mutex> lock(_mutex);
+        // 只有第一次调用会触发回调
+        if (_cancelled.exchange(true, std::memory_order_acq_rel))
+        {
+            return;
+        }
+        for (auto &hook : _hooks)
+        {
+            hook.second();
+        }
+    }
+
+    bool CancelToken::isCancelled() const
+    {
+        return _cancelled.load(std::memory_order_acquire);
+    }
+
+    uint64_t CancelToken::addHook(std::function<void()> hook)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        uint64_t hookId = _nextHookId++;
+        // 注册时已经被取消：立即执行一次，不再登记，cancel() 不会重复执行
+        if (_cancelled.load(std::memory_order_acquire))
+        {
+            hook();
+            return hookId;
+        }
+        _hooks[hookId] = std::move(hook);
+        return hookId;
+    }
+
+    void CancelToken::removeHook(uint64_t hookId)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _hooks.erase(hookId);
+    }
+
+    uint64_t CancelToken::cancelledRequests()
+    {
+        return _cancelledRequests.load(std::memory_order_relaxed);
+    }
+
+    void CancelToken::recordCancelledRequest()
+    {
+        _cancelledRequests.fetch_add(1, std::memory_order_relaxed);
+    }
+
+} // end ai_chat_sdk
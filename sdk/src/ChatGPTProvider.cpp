@@ -1,14 +1,20 @@
 #include "../include/ChatGPTProvider.h"
+#include "../include/RequestArena.h"
 #include "../include/util/myLog.h"
+#include "../include/util/jsonWriter.h"
+#include "../include/PromptCache.h"
+#include "../include/transport/StreamingBody.h"
 #include <jsoncpp/json/json.h>
-#include <sstream>
-#include <httplib.h>
+#include <memory>
 
 namespace ai_chat_sdk
 {
 
     bool ChatGPTProvider::initModel(const std::map<std::string, std::string> &modelConfig)
     {
+        // 配置先写入新快照，全部读取成功后一次性发布；失败时保留原有配置
+        auto config = std::make_shared<ProviderConfig>();
+
         // 1. 提取 API Key
         auto it = modelConfig.find("api_key");
         if (it == modelConfig.end())
@@ -16,21 +22,39 @@ namespace ai_chat_sdk
             ERR("ChatGPTProvider initModel: 'api_key' not found in config.");
             return false;
         }
-        _apiKey = it->second;
+        config->_apiKey = it->second;
 
         // 2. 提取 Endpoint (默认使用 OpenAI 官方地址)
         it = modelConfig.find("endpoint");
         if (it == modelConfig.end())
         {
-            _endpoint = "https://api.openai.com";
+            config->_endpoint = "https://api.openai.com";
         }
         else
         {
-            _endpoint = it->second;
+            config->_endpoint = it->second;
         }
 
+        // 3. 初始化传输层：transport 可选 httplib (默认) / http2 / reactor
+        TransportOptions options;
+        // 【关键】设置代理 (科学上网必须)
+        // 请根据你的实际代理端口修改，例如 127.0.0.1:7890
+        options._proxyHost = "127.0.0.1";
+        options._proxyPort = 7890;
+        it = modelConfig.find("transport");
+        config->_transport = createTransport(it == modelConfig.end() ? "httplib" : it->second, config->_endpoint, options);
+
+        // 4. 请求体布局：request_layout 可选 default (默认) / cache_aware
+        it = modelConfig.find("request_layout");
+        config->_requestLayout = parseRequestLayout(it == modelConfig.end() ? "default" : it->second);
+
+        // 初始化默认超时：timeout_ms / connect_timeout_ms / first_token_timeout_ms / idle_timeout_ms
+        config->loadTimeouts(modelConfig);
+
+        publishConfig(config);
         _isAvailable = true;
-        INFO("ChatGPTProvider init success. Endpoint: {}", _endpoint);
+        INFO("ChatGPTProvider init success. Endpoint: {}, transport: {}, request_layout: {}", config->_endpoint, config->_transport->name(),
+             config->_requestLayout == RequestLayout::CacheAware ? "cache_aware" : "default");
         return true;
     }
 
@@ -52,14 +76,34 @@ namespace ai_chat_sdk
 
     // 发送消息 - 全量返回
     std::string ChatGPTProvider::sendMessage(const std::vector<Message> &messages,
-                                             const std::map<std::string, std::string> &requestParam)
+                                             const std::map<std::string, std::string> &requestParam,
+                                             CancelTokenPtr cancelToken,
+                                             TokenUsage *usage)
     {
+        if (usage)
+            *usage = TokenUsage();
+
         // 1. 检测模型是否可用
         if (!isAvailable())
         {
             ERR("ChatGPTProvider sendMessage: Model is not available.");
             return "";
         }
+        // 本次请求全程使用同一份配置快照
+        ProviderConfigPtr snapshot = config();
+
+        // 请求发出前已被取消，直接返回
+        if (cancelToken && cancelToken->isCancelled())
+        {
+            WARN("ChatGPTProvider sendMessage: Request cancelled before sending.");
+            CancelToken::recordCancelledRequest();
+            return "";
+        }
+
+        // 超时策略：initModel 中的默认值，requestParam 中的同名参数可覆盖；总预算从此刻开始计算
+        TimeoutPolicy timeoutPolicy = snapshot->_timeoutPolicy;
+        applyTimeoutParams(requestParam, timeoutPolicy);
+        RequestDeadline deadline(timeoutPolicy, cancelToken);
 
         // 2. 构造请求参数
         double temperature = 0.7;
@@ -89,81 +133,106 @@ namespace ai_chat_sdk
             }
         }
 
-        // 3. 构建消息列表 (Input)
+        // 本次请求的临时内存都从内存池分配，函数返回时一次性释放
+        ArenaScope arena;
+
+        // 3. 构造请求体 (Body)，直接写出 JSON 文本
         // 根据 Responses API 风格或 Chat Completions API 风格调整
         // 这里我们演示适配 Chat Completions API 的标准格式
-        Json::Value messagesArray(Json::arrayValue);
-        for (const auto &msg : messages)
+        JsonWriter requestBody(arena.resource());
+        std::vector<BodySplice> splices; // 带 _contentSource 的消息在请求体中的插入点
+        requestBody.beginObject();
+        requestBody.key("model").value(getModelName()); // gpt-4o-mini
+        requestBody.key("input");                        // 注意：Chat Responses API 使用 "input"
+        if (!writeMessages(requestBody, messages, snapshot->_requestLayout, &splices))
         {
-            Json::Value messageJson(Json::objectValue);
-            messageJson["role"] = msg._role;
-            messageJson["content"] = msg._content;
-            messagesArray.append(messageJson);
+            ERR("ChatGPTProvider sendMessage: Failed to build request body.");
+            return "";
         }
+        // prompt_cache_key：同一会话 / 同一系统提示的请求使用相同 key，提高路由到同一缓存的概率
+        auto cacheKey = requestParam.find("prompt_cache_key");
+        if (cacheKey != requestParam.end() && !cacheKey->second.empty())
+            requestBody.key("prompt_cache_key").value(cacheKey->second);
+        requestBody.key("temperature").value(temperature);
+        requestBody.key("max_output_tokens").value(maxOutputTokens); // Chat Responses API 使用 "max_output_tokens"
+        requestBody.endObject();
 
-        // 4. 构造请求体 (Body)
-        Json::Value requestBody;
-        requestBody["model"] = getModelName(); // gpt-4o-mini
-        requestBody["input"] = messagesArray;  // 注意：Chat Responses API 使用 "input"
-        requestBody["temperature"] = temperature;
-        requestBody["max_output_tokens"] = maxOutputTokens; // Chat Responses API 使用 "max_output_tokens"
-
-        // 5. 序列化
-        Json::StreamWriterBuilder writerBuilder;
-        writerBuilder["indentation"] = "";
-        std::string requestBodyStr = Json::writeString(writerBuilder, requestBody);
-
-        INFO("ChatGPT Request Body: {}", requestBodyStr);
-
-        // 6. 创建 HTTP 客户端
-        httplib::Client client(_endpoint.c_str());
-        client.set_connection_timeout(30, 0);
-        client.set_read_timeout(60, 0);
+        INFO("ChatGPT Request Body: {}", requestBody.view());
 
-        // 【关键】设置代理 (科学上网必须)
-        // 请根据你的实际代理端口修改，例如 127.0.0.1:7890
-        client.set_proxy("127.0.0.1", 7890);
-
-        // 设置请求头
-        httplib::Headers headers = {
-            {"Authorization", "Bearer " + _apiKey}};
-
-        // 7. 发送 POST 请求
+        // 6. 构造传输层请求
         // 路径: /v1/responses
-        auto response = client.Post("/v1/responses", headers, requestBodyStr, "application/json");
+        HttpRequest request;
+        request._path = "/v1/responses";
+        request._headers = {
+            {"Authorization", "Bearer " + snapshot->_apiKey},
+            {"Content-Type", "application/json"}};
+        assignRequestBody(request, requestBody.view(), std::move(splices)); // 有外部内容时流式发送
+        deadline.apply(request);
+
+        // 7. 发送 POST 请求 (调用方取消或超时时由传输层中止读取)
+        HttpResponse response;
+        // 非流式响应同样逐块接收，每块刷新空闲计时：空闲超时只限制两次收到数据的间隔，不限制总时长
+        bool sendOk = snapshot->_transport->send(request, response, [&](const char *data, size_t len)
+                                                 {
+                                                     response._body.append(data, len);
+                                                     deadline.onData();
+                                                     return true; }, deadline.token());
 
         // 8. 检查响应
-        if (!response)
+        if (const char *reason = deadline.expired(sendOk))
+        {
+            WARN("ChatGPTProvider sendMessage: Request abandoned: {}.", reason);
+            return "";
+        }
+        if (cancelToken && cancelToken->isCancelled())
         {
-            ERR("ChatGPT Network Error: {}", to_string(response.error()));
+            WARN("ChatGPTProvider sendMessage: Request cancelled.");
+            CancelToken::recordCancelledRequest();
             return "";
         }
-        if (response->status != 200)
+        if (!sendOk)
         {
-            ERR("ChatGPT API Error. Status: {}, Body: {}", response->status, response->body);
+            ERR("ChatGPT Network Error: {}", response._error);
+            return "";
+        }
+        if (response._status != 200)
+        {
+            ERR("ChatGPT API Error. Status: {}, Body: {}", response._status, response._body);
             return "";
         }
 
-        // 9. 解析响应体
+        // 9. 解析响应体，直接解析内存中的字符串
         Json::Value responseJson;
-        Json::CharReaderBuilder reader;
+        Json::CharReaderBuilder readerBuilder;
+        std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
         std::string errorJson;
-        std::istringstream responseStream(response->body);
-
-        if (!Json::parseFromStream(reader, responseStream, &responseJson, &errorJson))
+        const char *begin = response._body.data();
+        if (!reader->parse(begin, begin + response._body.size(), &responseJson, &errorJson))
         {
             ERR("ChatGPT JSON Parse Failed: {}", errorJson);
             return "";
         }
 
-        // 10. 提取回复内容
-        if (responseJson.isMember("output") && responseJson["output"].isArray() && !responseJson["output"].empty())
+        // 10. 提取回复内容 (const 引用访问，避免复制子树)
+        const Json::Value &root = responseJson;
+
+        // 记录 token 用量与前缀缓存命中数
+        TokenUsage tokenUsage;
+        if (parseUsage(root["usage"], tokenUsage))
+        {
+            INFO("ChatGPTProvider usage: input {} (cached {}), output {}", tokenUsage._promptTokens,
+                 tokenUsage._cachedPromptTokens, tokenUsage._completionTokens);
+        }
+        recordUsage(tokenUsage, usage);
+
+        const Json::Value &outputs = root["output"];
+        if (outputs.isArray() && !outputs.empty())
         {
             // 模型的回复刚好是output数组的第0个元素
-            auto output = responseJson["output"][0];
-            if (output.isMember("content") && output["content"].isArray() && !output["content"].empty() && output["content"][0].isMember("text"))
+            const Json::Value &content = outputs[0]["content"];
+            if (content.isArray() && !content.empty() && content[0].isMember("text"))
             {
-                std::string replyString = output["content"][0]["text"].asString();
+                std::string replyString = content[0]["text"].asString();
                 INFO("ChatGPTProvider sendMessage replyString: {}", replyString);
                 return replyString;
             }
@@ -175,8 +244,12 @@ namespace ai_chat_sdk
 
     std::string ChatGPTProvider::sendMessageStream(const std::vector<Message> &messages,
                                                    const std::map<std::string, std::string> &requestParam,
-                                                   std::function<void(const std::string &, bool)> callback)
+                                                   std::function<void(const std::string &, bool)> callback,
+                                                   CancelTokenPtr cancelToken,
+                                                   TokenUsage *usage)
     {
+        if (usage)
+            *usage = TokenUsage();
         // TODO: 实现 OpenAI 流式请求
         return "";
     }
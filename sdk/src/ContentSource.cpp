@@ -0,0 +1,146 @@
+#include "../include/ContentSource.h"
+#include "../include/util/myLog.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ai_chat_sdk
+{
+    std::shared_ptr<MappedFileSource> MappedFileSource::open(const std::string &path)
+    {
+        // 1. 打开文件并检查类型
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            ERR("MappedFileSource: open {} failed: {}", path, std::strerror(errno));
+            return nullptr;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            ERR("MappedFileSource: {} is not a regular file", path);
+            ::close(fd);
+            return nullptr;
+        }
+
+        std::shared_ptr<MappedFileSource> source(new MappedFileSource());
+        source->_path = path;
+        source->_size = static_cast<size_t>(st.st_size);
+        source->_mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+
+        // 2. 映射整个文件；描述符保持打开，读取前用它检查文件是否被截断；空文件不能映射
+        if (source->_size > 0)
+        {
+            void *addr = ::mmap(nullptr, source->_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED)
+            {
+                ERR("MappedFileSource: mmap {} failed: {}", path, std::strerror(errno));
+                ::close(fd);
+                return nullptr;
+            }
+            // 请求体按顺序读取一遍，提示内核预读并尽早回收已读页面
+            ::madvise(addr, source->_size, MADV_SEQUENTIAL);
+            source->_data = static_cast<const char *>(addr);
+            source->_fd = fd;
+        }
+        else
+        {
+            ::close(fd);
+        }
+        DBG("MappedFileSource: mapped {} ({} bytes)", path, source->_size);
+        return source;
+    }
+
+    MappedFileSource::~MappedFileSource()
+    {
+        if (_data)
+            ::munmap(const_cast<char *>(_data), _size);
+        if (_fd >= 0)
+            ::close(_fd);
+    }
+
+    bool MappedFileSource::dataValid(uint64_t end) const
+    {
+        if (end == 0 || _fd < 0)
+            return true;
+        // 截断后映射中超出文件末尾的页面不可访问，访问会触发 SIGBUS
+        struct stat st;
+        if (::fstat(_fd, &st) != 0)
+        {
+            ERR("MappedFileSource: fstat {} failed: {}", _path, std::strerror(errno));
+            return false;
+        }
+        if (static_cast<uint64_t>(st.st_size) < end)
+        {
+            ERR("MappedFileSource: {} was truncated while in use ({} bytes, expected at least {})", _path,
+                static_cast<int64_t>(st.st_size), end);
+            return false;
+        }
+        return true;
+    }
+
+    ssize_t MappedFileSource::read(uint64_t offset, char *buf, size_t len) const
+    {
+        if (offset >= _size)
+            return 0;
+        size_t n = std::min<uint64_t>(len, _size - offset);
+        if (!dataValid(offset + n))
+            return -1;
+        std::memcpy(buf, _data + offset, n);
+        return static_cast<ssize_t>(n);
+    }
+
+    std::string MappedFileSource::identity() const
+    {
+        return "file:" + _path + ":" + std::to_string(_size) + ":" + std::to_string(_mtimeNs);
+    }
+
+    CallbackSource::CallbackSource(Reader reader, int64_t size, std::string identity)
+        : _reader(std::move(reader)), _size(size), _identity(std::move(identity))
+    {
+    }
+
+    ssize_t CallbackSource::read(uint64_t offset, char *buf, size_t len) const
+    {
+        if (!_reader)
+            return -1;
+        return _reader(offset, buf, len);
+    }
+
+    std::string CallbackSource::identity() const
+    {
+        if (!_identity.empty())
+            return "callback:" + _identity;
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "callback@%p", static_cast<const void *>(this));
+        return buf;
+    }
+
+    bool readAll(const ContentSource &source, std::string &out)
+    {
+        out.clear();
+        if (source.size() > 0)
+            out.reserve(static_cast<size_t>(source.size()));
+        char buf[16384];
+        uint64_t offset = 0;
+        while (true)
+        {
+            ssize_t n = source.read(offset, buf, sizeof(buf));
+            if (n < 0)
+            {
+                ERR("readAll: read {} failed at offset {}", source.identity(), offset);
+                return false;
+            }
+            if (n == 0)
+                return true;
+            out.append(buf, static_cast<size_t>(n));
+            offset += static_cast<uint64_t>(n);
+        }
+    }
+
+} // end ai_chat_sdk
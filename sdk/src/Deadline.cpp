@@ -0,0 +1,293 @@
+#include "../include/Deadline.h"
+#include "../include/util/myLog.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        const int64_t kNoDeadline = std::numeric_limits<int64_t>::max();
+        const int kUnlimitedSec = 24 * 3600; // 不限制时传给传输层的超时
+
+        enum ExpireReason
+        {
+            NotExpired = 0,
+            TotalDeadline,
+            FirstToken,
+            Idle
+        };
+
+        const char *reasonText(int reason)
+        {
+            switch (reason)
+            {
+            case TotalDeadline:
+                return "deadline exceeded";
+            case FirstToken:
+                return "first token timeout";
+            case Idle:
+                return "idle timeout";
+            default:
+                return nullptr;
+            }
+        }
+
+        std::atomic<uint64_t> g_timedOutRequests{0};
+    }
+
+    struct RequestDeadline::State
+    {
+        CancelTokenPtr _token = std::make_shared<CancelToken>();
+        int64_t _startMs = 0;
+        int64_t _totalDeadlineMs = kNoDeadline;      // 绝对时间
+        int64_t _firstTokenDeadlineMs = kNoDeadline; // 绝对时间
+        int64_t _connectMs = 0;
+        int64_t _idleMs = 0;
+        std::atomic<int64_t> _lastDataMs{0};
+        std::atomic<bool> _gotFirstToken{false};
+        std::atomic<int> _reason{NotExpired};
+        std::atomic<bool> _counted{false}; // 已计入 g_timedOutRequests
+
+        // 下一次需要检查的时间
+        int64_t nextCheckMs() const
+        {
+            int64_t next = _totalDeadlineMs;
+            if (!_gotFirstToken.load(std::memory_order_relaxed))
+                next = std::min(next, _firstTokenDeadlineMs);
+            if (_idleMs > 0)
+                next = std::min(next, _lastDataMs.load(std::memory_order_relaxed) + _idleMs);
+            return next;
+        }
+
+        // 检查是否超时，返回原因
+        int check(int64_t nowMs) const
+        {
+            if (nowMs >= _totalDeadlineMs)
+                return TotalDeadline;
+            if (!_gotFirstToken.load(std::memory_order_relaxed) && nowMs >= _firstTokenDeadlineMs)
+                return FirstToken;
+            if (_idleMs > 0 && nowMs >= _lastDataMs.load(std::memory_order_relaxed) + _idleMs)
+                return Idle;
+            return NotExpired;
+        }
+    };
+
+    namespace
+    {
+        // 进程内共享的超时监视线程：按最早的检查时间休眠，数据到达只推迟检查时间，无需唤醒
+        class DeadlineWatchdog
+        {
+        public:
+            static DeadlineWatchdog &instance()
+            {
+                // 不析构：请求可能在静态对象析构期间结束
+                static DeadlineWatchdog *watchdog = new DeadlineWatchdog();
+                return *watchdog;
+            }
+
+            void add(const std::shared_ptr<RequestDeadline::State> &state)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _states.insert(state);
+                if (!_started)
+                {
+                    _started = true;
+                    std::thread([this]()
+                                { run(); })
+                        .detach();
+                }
+                _cond.notify_one();
+            }
+
+            void remove(const std::shared_ptr<RequestDeadline::State> &state)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _states.erase(state);
+            }
+
+        private:
+            void run()
+            {
+                std::vector<std::shared_ptr<RequestDeadline::State>> expired;
+                std::unique_lock<std::mutex> lock(_mutex);
+                while (true)
+                {
+                    // 1. 找出已超时的请求，同时计算下一次唤醒时间
+                    int64_t now = steadyNowMs();
+                    int64_t next = kNoDeadline;
+                    for (auto it = _states.begin(); it != _states.end();)
+                    {
+                        int reason = (*it)->check(now);
+                        if (reason != NotExpired)
+                        {
+                            (*it)->_reason.store(reason, std::memory_order_release);
+                            expired.push_back(*it);
+                            it = _states.erase(it);
+                            continue;
+                        }
+                        next = std::min(next, (*it)->nextCheckMs());
+                        ++it;
+                    }
+
+                    // 2. 锁外取消，取消回调可能会等待传输层
+                    if (!expired.empty())
+                    {
+                        lock.unlock();
+                        for (auto &state : expired)
+                            state->_token->cancel();
+                        expired.clear();
+                        lock.lock();
+                        continue;
+                    }
+
+                    if (next == kNoDeadline)
+                        _cond.wait(lock);
+                    else
+                        _cond.wait_for(lock, std::chrono::milliseconds(next - now));
+                }
+            }
+
+        private:
+            std::mutex _mutex;
+            std::condition_variable _cond;
+            std::unordered_set<std::shared_ptr<RequestDeadline::State>> _states;
+            bool _started = false;
+        };
+
+        // 毫秒转秒，向上取整，不小于 1 秒
+        int toTimeoutSec(int64_t ms)
+        {
+            return static_cast<int>(std::max<int64_t>(1, std::min<int64_t>((ms + 999) / 1000, kUnlimitedSec)));
+        }
+    }
+
+    void applyTimeoutParams(const std::map<std::string, std::string> &params, TimeoutPolicy &policy)
+    {
+        const std::pair<const char *, int64_t *> fields[] = {
+            {"timeout_ms", &policy._totalMs},
+            {"connect_timeout_ms", &policy._connectMs},
+            {"first_token_timeout_ms", &policy._firstTokenMs},
+            {"idle_timeout_ms", &policy._idleMs}};
+        for (const auto &field : fields)
+        {
+            auto it = params.find(field.first);
+            if (it == params.end())
+                continue;
+            try
+            {
+                *field.second = std::max<int64_t>(0, std::stoll(it->second));
+            }
+            catch (...)
+            {
+                WARN("Invalid {} param: {}", field.first, it->second);
+            }
+        }
+    }
+
+    bool isTimeoutParam(const std::string &name)
+    {
+        return name == "timeout_ms" || name == "connect_timeout_ms" || name == "first_token_timeout_ms" ||
+               name == "idle_timeout_ms";
+    }
+
+    RequestDeadline::RequestDeadline(const TimeoutPolicy &policy, const CancelTokenPtr &cancelToken)
+        : _state(std::make_shared<State>())
+    {
+        // 1. 换算为绝对时间
+        _state->_startMs = steadyNowMs();
+        if (policy._totalMs > 0)
+            _state->_totalDeadlineMs = _state->_startMs + policy._totalMs;
+        if (policy._firstTokenMs > 0)
+            _state->_firstTokenDeadlineMs = _state->_startMs + policy._firstTokenMs;
+        _state->_connectMs = policy._connectMs;
+        _state->_idleMs = policy._idleMs;
+        _state->_lastDataMs.store(_state->_startMs, std::memory_order_relaxed);
+
+        // 2. 调用方取消时一并取消 (不同的令牌，不会在同一把锁内重入)
+        if (cancelToken)
+        {
+            CancelTokenPtr token = _state->_token;
+            _parentGuard.reset(new CancelHookGuard(cancelToken, [token]()
+                                                   { token->cancel(); }));
+        }
+
+        // 3. 有任何一项限制时才交给监视线程
+        if (_state->nextCheckMs() != kNoDeadline)
+            DeadlineWatchdog::instance().add(_state);
+    }
+
+    RequestDeadline::~RequestDeadline()
+    {
+        _parentGuard.reset();
+        DeadlineWatchdog::instance().remove(_state);
+    }
+
+    const CancelTokenPtr &RequestDeadline::token() const
+    {
+        return _state->_token;
+    }
+
+    void RequestDeadline::apply(HttpRequest &request) const
+    {
+        // 连接与读空闲超时交给传输层 (秒级)，首 token 与毫秒级的空闲超时由监视线程检查
+        request._connectTimeoutSec = _state->_connectMs > 0 ? toTimeoutSec(_state->_connectMs) : kUnlimitedSec;
+        request._readTimeoutSec = _state->_idleMs > 0 ? toTimeoutSec(_state->_idleMs) : kUnlimitedSec;
+        if (_state->_totalDeadlineMs != kNoDeadline)
+        {
+            request._deadlineMs = _state->_totalDeadlineMs;
+            request._connectTimeoutSec = clampTimeoutSec(request._connectTimeoutSec, request._deadlineMs);
+            request._readTimeoutSec = clampTimeoutSec(request._readTimeoutSec, request._deadlineMs);
+        }
+        // 上传请求体期间同样算作有数据往来，大文件上传不会被空闲超时打断
+        std::shared_ptr<State> state = _state;
+        request._onUploadProgress = [state]()
+        {
+            state->_lastDataMs.store(steadyNowMs(), std::memory_order_relaxed);
+        };
+    }
+
+    void RequestDeadline::onData()
+    {
+        _state->_lastDataMs.store(steadyNowMs(), std::memory_order_relaxed);
+    }
+
+    void RequestDeadline::onFirstToken()
+    {
+        _state->_gotFirstToken.store(true, std::memory_order_relaxed);
+    }
+
+    const char *RequestDeadline::expired(bool transferOk) const
+    {
+        // 传输已完整结束：即使监视线程随后才触发，响应也是有效的
+        if (transferOk)
+            return nullptr;
+        int reason = _state->_reason.load(std::memory_order_acquire);
+        // 传输层可能先于监视线程发现总预算耗尽 (HttpRequest::_deadlineMs)
+        if (reason == NotExpired && steadyNowMs() >= _state->_totalDeadlineMs)
+            reason = TotalDeadline;
+        if (reason != NotExpired && !_state->_counted.exchange(true, std::memory_order_relaxed))
+            g_timedOutRequests.fetch_add(1, std::memory_order_relaxed);
+        return reasonText(reason);
+    }
+
+    int64_t RequestDeadline::remainingMs() const
+    {
+        if (_state->_totalDeadlineMs == kNoDeadline)
+            return kNoDeadline;
+        return std::max<int64_t>(0, _state->_totalDeadlineMs - steadyNowMs());
+    }
+
+    uint64_t RequestDeadline::timedOutRequests()
+    {
+        return g_timedOutRequests.load(std::memory_order_relaxed);
+    }
+
+} // end ai_chat_sdk
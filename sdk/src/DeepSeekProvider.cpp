@@ -1,14 +1,21 @@
 #include "../include/DeepSeekProvider.h"
+#include "../include/RequestArena.h"
 #include "../include/util/myLog.h"
+#include "../include/util/jsonWriter.h"
+#include "../include/PromptCache.h"
+#include "../include/transport/StreamingBody.h"
 #include <jsoncpp/json/json.h>
-#include <sstream>
-#include <httplib.h>
+#include <memory>
+#include <string_view>
 
 namespace ai_chat_sdk
 {
     // DeepSeekProvider 类
     bool DeepSeekProvider::initModel(const std::map<std::string, std::string> &modelConfig)
     {
+        // 配置先写入新快照，全部读取成功后一次性发布；失败时保留原有配置，进行中的请求不受影响
+        auto config = std::make_shared<ProviderConfig>();
+
         // 初始化API Key
         auto it = modelConfig.find("api_key");
         if (it == modelConfig.end())
@@ -18,22 +25,40 @@ namespace ai_chat_sdk
         }
         else
         {
-            _apiKey = it->second;
+            config->_apiKey = it->second;
         }
 
         // 初始化Base URL
         it = modelConfig.find("endpoint");
         if (it == modelConfig.end())
         {
-            _endpoint = "https://api.deepseek.com";
+            config->_endpoint = "https://api.deepseek.com";
         }
         else
         {
-            _endpoint = it->second;
+            config->_endpoint = it->second;
         }
 
+        // 初始化传输层：transport 可选 httplib (默认) / http2 / reactor
+        it = modelConfig.find("transport");
+        config->_transport = createTransport(it == modelConfig.end() ? "httplib" : it->second, config->_endpoint);
+
+        // 初始化请求体布局：request_layout 可选 default (默认) / cache_aware
+        it = modelConfig.find("request_layout");
+        config->_requestLayout = parseRequestLayout(it == modelConfig.end() ? "default" : it->second);
+
+        // 流式响应是否附带 usage：stream_usage 可选 false (默认) / true
+        // 开启后最后一个事件携带用量，需要服务端支持 stream_options，部分兼容网关会拒绝该字段
+        it = modelConfig.find("stream_usage");
+        config->_streamUsage = it != modelConfig.end() && it->second == "true";
+
+        // 初始化默认超时：timeout_ms / connect_timeout_ms / first_token_timeout_ms / idle_timeout_ms
+        config->loadTimeouts(modelConfig);
+
+        publishConfig(config);
         _isAvailable = true;
-        INFO("DeepSeekProvider initModel success, endpoint: {}", _endpoint);
+        INFO("DeepSeekProvider initModel success, endpoint: {}, transport: {}, request_layout: {}", config->_endpoint, config->_transport->name(),
+             config->_requestLayout == RequestLayout::CacheAware ? "cache_aware" : "default");
         return true;
     }
 
@@ -56,14 +81,34 @@ namespace ai_chat_sdk
     }
 
     std::string DeepSeekProvider::sendMessage(const std::vector<Message> &messages,
-                                              const std::map<std::string, std::string> &requestParam)
+                                              const std::map<std::string, std::string> &requestParam,
+                                              CancelTokenPtr cancelToken,
+                                              TokenUsage *usage)
     {
+        if (usage)
+            *usage = TokenUsage();
+
         // 1. 检测模型是否可用 (API Key 是否已初始化)
         if (!isAvailable())
         {
             ERR("DeepSeekProvider sendMessage: Model is not available (not initialized).");
             return "";
         }
+        // 本次请求全程使用同一份配置快照，期间的 initModel / rotateApiKey 不影响它
+        ProviderConfigPtr snapshot = config();
+
+        // 请求发出前已被取消，直接返回
+        if (cancelToken && cancelToken->isCancelled())
+        {
+            WARN("DeepSeekProvider sendMessage: Request cancelled before sending.");
+            CancelToken::recordCancelledRequest();
+            return "";
+        }
+
+        // 超时策略：initModel 中的默认值，requestParam 中的同名参数可覆盖；总预算从此刻开始计算
+        TimeoutPolicy timeoutPolicy = snapshot->_timeoutPolicy;
+        applyTimeoutParams(requestParam, timeoutPolicy);
+        RequestDeadline deadline(timeoutPolicy, cancelToken);
 
         // 2. 准备请求参数 (设置默认值)
         double temperature = 0.7;
@@ -93,85 +138,104 @@ namespace ai_chat_sdk
             }
         }
 
-        // 3. 构造历史消息列表 (Context)
-        // DeepSeek 要求 messages 为 JSON 数组
-        Json::Value messageArray(Json::arrayValue);
-        for (const auto &msg : messages)
+        // 本次请求的临时内存都从内存池分配，函数返回时一次性释放
+        ArenaScope arena;
+
+        // 3. 构造请求体 (Request Body)，直接写出 JSON 文本
+        // DeepSeek 要求 messages 为 JSON 数组 (role: user, assistant, system)
+        // model、messages 在前，易变参数在后，相同历史的请求前缀逐字节一致，便于命中服务端前缀缓存
+        JsonWriter requestBody(arena.resource());
+        std::vector<BodySplice> splices; // 带 _contentSource 的消息在请求体中的插入点
+        requestBody.beginObject();
+        requestBody.key("model").value(getModelName()); // deepseek-chat
+        requestBody.key("messages");
+        if (!writeMessages(requestBody, messages, snapshot->_requestLayout, &splices))
         {
-            Json::Value messageObject;
-            messageObject["role"] = msg._role; // user, assistant, system
-            messageObject["content"] = msg._content;
-            messageArray.append(messageObject);
+            ERR("DeepSeekProvider sendMessage: Failed to build request body.");
+            return "";
         }
+        requestBody.key("temperature").value(temperature);
+        requestBody.key("max_tokens").value(maxTokens);
+        requestBody.key("stream").value(false); // 全量返回模式
+        requestBody.endObject();
 
-        // 4. 构造完整的请求体 (Request Body)
-        Json::Value requestBody;
-        requestBody["model"] = getModelName(); // deepseek-chat
-        requestBody["messages"] = messageArray;
-        requestBody["temperature"] = temperature;
-        requestBody["max_tokens"] = maxTokens;
-        requestBody["stream"] = false; // 全量返回模式
-
-        // 5. 序列化: 将 JSON 对象转为字符串 (JSON String)
-        Json::StreamWriterBuilder writerBuilder;
-        writerBuilder["indentation"] = ""; // 紧凑格式，无缩进
-        std::string requestBodyStr = Json::writeString(writerBuilder, requestBody);
-
-        INFO("DeepSeekProvider sendMessage Request Body: {}", requestBodyStr);
-
-        // 6. 创建 HTTP 客户端
-        // _endpoint 例如: https://api.deepseek.com
-        httplib::Client client(_endpoint.c_str());
+        INFO("DeepSeekProvider sendMessage Request Body: {}", requestBody.view());
 
-        // 设置超时时间
-        client.set_connection_timeout(30, 0); // 连接超时 30秒
-        client.set_read_timeout(60, 0);       // 读取超时 60秒 (大模型生成较慢)
-
-        // 设置请求头
-        httplib::Headers headers = {
-            {"Authorization", "Bearer " + _apiKey},
-            {"Content-Type", "application/json"}};
-
-        // 7. 发送 POST 请求
+        // 6. 构造传输层请求
         // 路径为 /chat/completions (DeepSeek 官方兼容 OpenAI 接口)
         // 注意：有些官方文档可能建议使用 /v1/chat/completions，请根据实际情况调整
-        auto response = client.Post("/v1/chat/completions", headers, requestBodyStr, "application/json");
+        HttpRequest request;
+        request._path = "/v1/chat/completions";
+        request._headers = {
+            {"Authorization", "Bearer " + snapshot->_apiKey},
+            {"Content-Type", "application/json"}};
+        assignRequestBody(request, requestBody.view(), std::move(splices)); // 有外部内容时流式发送
+        deadline.apply(request); // 连接超时、读超时 (默认 30 秒 / 60 秒) 与截止时间
+
+        // 7. 发送 POST 请求 (调用方取消或超时时由传输层中止读取)
+        HttpResponse response;
+        // 非流式响应同样逐块接收，每块刷新空闲计时：空闲超时只限制两次收到数据的间隔，不限制总时长
+        bool sendOk = snapshot->_transport->send(request, response, [&](const char *data, size_t len)
+                                                 {
+                                                     response._body.append(data, len);
+                                                     deadline.onData();
+                                                     return true; }, deadline.token());
 
         // 8. 检查响应状态
-        if (!response)
+        if (const char *reason = deadline.expired(sendOk))
         {
-            ERR("DeepSeekProvider sendMessage POST request failed (Network Error).");
+            WARN("DeepSeekProvider sendMessage: Request abandoned: {}.", reason);
+            return "";
+        }
+        if (cancelToken && cancelToken->isCancelled())
+        {
+            WARN("DeepSeekProvider sendMessage: Request cancelled.");
+            CancelToken::recordCancelledRequest();
+            return "";
+        }
+
+        if (!sendOk)
+        {
+            ERR("DeepSeekProvider sendMessage POST request failed (Network Error): {}", response._error);
             return "";
         }
 
-        if (response->status != 200)
+        if (response._status != 200)
         {
-            ERR("DeepSeekProvider sendMessage Failed. Status: {}, Body: {}", response->status, response->body);
+            ERR("DeepSeekProvider sendMessage Failed. Status: {}, Body: {}", response._status, response._body);
             return "";
         }
 
-        INFO("DeepSeekProvider Request Success. Status: {}", response->status);
+        INFO("DeepSeekProvider Request Success. Status: {}", response._status);
 
-        // 9. 解析响应体 (反序列化)
+        // 9. 解析响应体 (反序列化)，直接解析内存中的字符串，不再经过 istringstream
         Json::Value responseBody;
         Json::CharReaderBuilder readerBuilder;
+        std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
         std::string parseError;
-        std::istringstream responseStream(response->body);
-
-        // 使用 parseFromStream 解析 JSON 字符串
-        if (Json::parseFromStream(readerBuilder, responseStream, &responseBody, &parseError))
+        const char *begin = response._body.data();
+        if (reader->parse(begin, begin + response._body.size(), &responseBody, &parseError))
         {
             // 提取 content 字段
-            // 结构路径: choices[0] -> message -> content
-            if (responseBody.isMember("choices") &&
-                responseBody["choices"].isArray() &&
-                !responseBody["choices"].empty())
+            // 结构路径: choices[0] -> message -> content (用引用访问，避免复制子树)
+            const Json::Value &root = responseBody; // const 访问不会为缺失字段创建节点
+
+            // 记录 token 用量与前缀缓存命中数
+            TokenUsage tokenUsage;
+            if (parseUsage(root["usage"], tokenUsage))
             {
+                INFO("DeepSeekProvider usage: prompt {} (cache hit {}), completion {}", tokenUsage._promptTokens,
+                     tokenUsage._cachedPromptTokens, tokenUsage._completionTokens);
+            }
+            recordUsage(tokenUsage, usage);
 
-                auto choice = responseBody["choices"][0];
-                if (choice.isMember("message") && choice["message"].isMember("content"))
+            const Json::Value &choices = root["choices"];
+            if (choices.isArray() && !choices.empty())
+            {
+                const Json::Value &message = choices[0]["message"];
+                if (message.isMember("content"))
                 {
-                    std::string replyContent = choice["message"]["content"].asString();
+                    std::string replyContent = message["content"].asString();
                     INFO("DeepSeekProvider Response Text: {}", replyContent);
                     return replyContent;
                 }
@@ -187,190 +251,358 @@ namespace ai_chat_sdk
         return "Error: Failed to parse DeepSeek response.";
     }
 
-    // 发送消息 - 增量返回 - 流式响应
-    std::string DeepSeekProvider::sendMessageStream(
-        const std::vector<Message> &messages,
-        const std::map<std::string, std::string> &requestParam,
-        std::function<void(const std::string &, bool)> callback)
+    namespace
     {
-
-        // 1. 检测模型是否可用
-        if (!isAvailable())
+        // 一次流式请求的状态：SSE 解析、累积回复与截止时间
+        // 同步调用时由调用线程持有；异步调用时由传输层回调共同持有，直到完成回调结束
+        struct StreamSession
         {
-            ERR("DeepSeekProvider sendMessageStream: Model not available.");
-            return "";
-        }
-
-        // 2. 准备请求参数
-        double temperature = 0.7;
-        int maxTokens = 2048;
-        // ... (参数解析逻辑同 sendMessage，略)
+            StreamSession(const TimeoutPolicy &policy, const CancelTokenPtr &cancelToken,
+                          std::function<void(const std::string &, bool)> callback, std::pmr::memory_resource *resource)
+                : _deadline(policy, cancelToken), _cancelToken(cancelToken), _callback(std::move(callback)),
+                  _response(std::make_shared<HttpResponse>()), _buffer(resource)
+            {
+                Json::CharReaderBuilder readerBuilder;
+                _reader.reset(readerBuilder.newCharReader()); // 整个流复用同一个 JSON 解析器
+            }
 
-        // 3. 构造请求体 (Request Body)
-        // 注意：这里必须显式开启 stream = true
-        Json::Value requestBody;
-        requestBody["model"] = getModelName();
-        requestBody["stream"] = true; // 关键！
-        requestBody["temperature"] = temperature;
-        requestBody["max_tokens"] = maxTokens;
-
-        // 构造 messages 数组
-        Json::Value messageArray(Json::arrayValue);
-        for (const auto &msg : messages)
-        {
-            Json::Value item;
-            item["role"] = msg._role;
-            item["content"] = msg._content;
-            messageArray.append(item);
-        }
-        requestBody["messages"] = messageArray;
+            // 最终回调 callback("", true) 只允许触发一次
+            void deliverFinal()
+            {
+                if (_finalDelivered)
+                    return;
+                _finalDelivered = true;
+                if (_callback)
+                    _callback("", true);
+            }
 
-        // 序列化
-        Json::StreamWriterBuilder writerBuilder;
-        writerBuilder["indentation"] = "";
-        std::string requestBodyStr = Json::writeString(writerBuilder, requestBody);
+            // 响应体处理器：每收到一块数据调用一次
+            bool onBody(const char *data, size_t len)
+            {
+                if (_gotError)
+                    return false;
 
-        INFO("DeepSeek Stream Request: {}", requestBodyStr);
+                // 非 200 响应不按 SSE 解析，返回 false 终止连接
+                if (_response->_status != 200)
+                {
+                    _gotError = true;
+                    ERR("Stream Handshake Failed: HTTP Status: {}, Body: {}", _response->_status, std::string_view(data, len));
+                    return false;
+                }
 
-        // 4. 创建 HTTP 客户端
-        httplib::Client client(_endpoint.c_str());
-        client.set_connection_timeout(30, 0);
-        // 流式响应持续时间可能很长，设置读取超时为 300秒
-        client.set_read_timeout(300, 0);
+                // 调用方已取消或已超时：返回 false 让传输层立即中止读取
+                if (_deadline.token()->isCancelled())
+                    return false;
+                _deadline.onData();
 
-        // 设置请求头
-        httplib::Headers headers = {
-            {"Authorization", "Bearer " + _apiKey},
-            {"Content-Type", "application/json"},
-            {"Accept", "text/event-stream"} // 告诉服务器我们要接收事件流
-        };
+                // 将新接收的数据追加到缓冲区
+                _buffer.append(data, len);
 
-        // 5. 定义流式处理所需的上下文变量
-        std::string buffer;        // 数据缓冲区 (处理粘包/半包)
-        bool gotError = false;     // 错误标记
-        std::string errorMsg;      // 错误信息
-        bool streamFinish = false; // 是否收到 [DONE]
-        std::string fullResponse;  // 累积完整回复
-
-        // 6. 构造 Request 对象
-        httplib::Request req;
-        req.method = "POST";
-        req.path = "/chat/completions";
-        req.headers = headers;
-        req.body = requestBodyStr;
-
-        // 7. 设置响应头处理器 (Response Handler)
-        // 在接收到 HTTP 响应头时触发
-        req.response_handler = [&](const httplib::Response &res)
-        {
-            if (res.status != 200)
-            {
-                gotError = true;
-                errorMsg = "HTTP Status: " + std::to_string(res.status);
-                ERR("Stream Handshake Failed: {}", errorMsg);
-                return false; // 返回 false 终止连接
-            }
-            return true; // 继续接收 Body
-        };
-
-        // 8. 设置内容接收器 (Content Receiver)
-        // 每收到一块数据就会触发此回调
-        req.content_receiver = [&](const char *data, size_t len, uint64_t /*offset*/, uint64_t /*total*/)
-        {
-            if (gotError)
-                return false;
+                // 循环处理缓冲区中的完整 SSE 消息
+                // SSE 规范：每条消息以两个换行符 \n\n 结尾
+                // 只移动偏移量，处理完后统一移除已消费的部分，避免每条消息都拷贝
+                size_t start = 0;
+                size_t pos = 0;
+                while ((pos = _buffer.find("\n\n", start)) != std::string::npos)
+                {
+                    // 提取一条完整的消息 (+2 是跳过 \n\n)
+                    std::string_view chunk(_buffer.data() + start, pos - start);
+                    start = pos + 2;
 
-            // 将新接收的数据追加到缓冲区
-            buffer.append(data, len);
+                    // 忽略空行和注释 (以冒号开头的行)
+                    if (chunk.empty() || chunk[0] == ':')
+                        continue;
 
-            // 循环处理缓冲区中的完整 SSE 消息
-            // SSE 规范：每条消息以两个换行符 \n\n 结尾
-            size_t pos = 0;
-            while ((pos = buffer.find("\n\n")) != std::string::npos)
-            {
-                // 提取一条完整的消息
-                std::string chunk = buffer.substr(0, pos);
-                // 从缓冲区移除已处理的部分 (+2 是跳过 \n\n)
-                buffer.erase(0, pos + 2);
-
-                // 忽略空行和注释 (以冒号开头的行)
-                if (chunk.empty() || chunk[0] == ':')
-                    continue;
-
-                // 解析 data: 开头的数据行
-                // 格式: "data: {...}"
-                const std::string prefix = "data: ";
-                if (chunk.compare(0, prefix.size(), prefix) == 0)
-                {
-                    std::string payload = chunk.substr(prefix.size());
+                    // 解析 data: 开头的数据行
+                    // 格式: "data: {...}"
+                    const std::string_view prefix = "data: ";
+                    if (chunk.compare(0, prefix.size(), prefix) != 0)
+                        continue;
+                    std::string_view payload = chunk.substr(prefix.size());
 
                     // 检查结束标记
                     if (payload == "[DONE]")
                     {
-                        streamFinish = true;
+                        _streamFinish = true;
                         // 通知上层：对话结束
-                        if (callback)
-                            callback("", true);
+                        deliverFinal();
                         return true;
                     }
 
                     // JSON 反序列化
-                    Json::Value jsonResp;
-                    Json::CharReaderBuilder reader;
-                    std::string errs;
-                    std::istringstream ss(payload);
+                    if (!_reader->parse(payload.data(), payload.data() + payload.size(), &_json, &_errs))
+                    {
+                        WARN("SSE JSON Parse Failed: {}", _errs);
+                        continue;
+                    }
 
-                    if (Json::parseFromStream(reader, ss, &jsonResp, &errs))
+                    // 提取 content
+                    // 路径: choices[0].delta.content (注意这里是 delta 不是 message)
+                    parseUsage(_json["usage"], _usage); // 只有最后一个事件的 usage 非 null
+                    const Json::Value &choices = _json["choices"];
+                    if (choices.isArray() && !choices.empty())
                     {
-                        // 提取 content
-                        // 路径: choices[0].delta.content (注意这里是 delta 不是 message)
-                        if (jsonResp.isMember("choices") &&
-                            !jsonResp["choices"].empty())
+                        const Json::Value &content = choices[0]["delta"]["content"];
+                        const char *begin = nullptr;
+                        const char *end = nullptr;
+                        if (content.isString() && content.getString(&begin, &end))
                         {
+                            _delta.assign(begin, end);
+                            if (!_delta.empty())
+                                _deadline.onFirstToken();
 
-                            auto choice = jsonResp["choices"][0];
-                            if (choice.isMember("delta") && choice["delta"].isMember("content"))
-                            {
-                                std::string content = choice["delta"]["content"].asString();
+                            // 累积完整回复
+                            _fullResponse += _delta;
 
-                                // 累积完整回复
-                                fullResponse += content;
-
-                                // 触发回调，通知上层有新字符生成
-                                if (callback)
-                                    callback(content, false);
-                            }
+                            // 触发回调，通知上层有新字符生成
+                            if (_callback)
+                                _callback(_delta, false);
                         }
                     }
-                    else
-                    {
-                        WARN("SSE JSON Parse Failed: {}", errs);
-                    }
                 }
+                _buffer.erase(0, start);
+                return true; // 继续接收下一块数据
+            }
+
+            // 传输结束后的收尾：返回完整回复 (失败时为空)，并保证上层收到结束通知
+            std::string finish(bool sendOk)
+            {
+                if (_usage._valid)
+                {
+                    INFO("DeepSeekProvider stream usage: prompt {} (cache hit {}), completion {}", _usage._promptTokens,
+                         _usage._cachedPromptTokens, _usage._completionTokens);
+                }
+
+                // 超时：已收到的内容照常返回 (首 token 超时时为空)
+                const char *reason = _deadline.expired(sendOk);
+                if (!_streamFinish && reason)
+                {
+                    WARN("DeepSeekProvider sendMessageStream: Stream abandoned: {}, received {} bytes.", reason, _fullResponse.size());
+                    deliverFinal();
+                    return _fullResponse;
+                }
+
+                // 被取消：已收到的内容照常返回
+                if (!_streamFinish && _cancelToken && _cancelToken->isCancelled())
+                {
+                    WARN("DeepSeekProvider sendMessageStream: Stream cancelled, received {} bytes.", _fullResponse.size());
+                    CancelToken::recordCancelledRequest();
+                    deliverFinal();
+                    return _fullResponse;
+                }
+
+                if (_gotError)
+                    return "";
+
+                if (!sendOk)
+                {
+                    ERR("Network Error: {}", _response->_error);
+                    return "";
+                }
+
+                if (_response->_status != 200)
+                {
+                    ERR("Stream Handshake Failed: HTTP Status: {}", _response->_status);
+                    return "";
+                }
+
+                // 兜底检查：连接意外断开且没有收到 [DONE]，需要通知上层结束
+                if (!_streamFinish)
+                {
+                    WARN("Stream ended unexpectedly without [DONE]");
+                    deliverFinal();
+                }
+                return _fullResponse;
             }
-            return true; // 继续接收下一块数据
+
+            RequestDeadline _deadline;
+            CancelTokenPtr _cancelToken;
+            std::function<void(const std::string &, bool)> _callback;
+            HttpResponsePtr _response;
+            std::pmr::string _buffer;      // 数据缓冲区 (处理粘包/半包)
+            bool _gotError = false;        // 非 200 响应
+            bool _streamFinish = false;    // 是否收到 [DONE]
+            bool _finalDelivered = false;
+            std::string _fullResponse;     // 累积完整回复
+            std::string _delta;            // 本次增量，跨事件复用容量
+            TokenUsage _usage;             // 开启 stream_usage 时最后一个事件携带 usage
+            std::unique_ptr<Json::CharReader> _reader;
+            Json::Value _json;
+            std::string _errs;
         };
+    }
 
-        // 9. 发送请求
-        auto res = client.send(req);
+    // 构造流式请求：请求体先在 resource 上序列化，再写入 HttpRequest，返回后 resource 即可归还
+    bool DeepSeekProvider::buildStreamRequest(const ProviderConfig &snapshot, const std::vector<Message> &messages,
+                                              const std::map<std::string, std::string> & /*requestParam*/,
+                                              std::pmr::memory_resource *resource, HttpRequest &request) const
+    {
+        // 1. 准备请求参数
+        double temperature = 0.7;
+        int maxTokens = 2048;
+        // ... (参数解析逻辑同 sendMessage，略)
 
-        // 10. 处理发送结果
-        if (!res)
+        // 2. 构造请求体 (Request Body)
+        // 注意：这里必须显式开启 stream = true
+        JsonWriter requestBody(resource);
+        std::vector<BodySplice> splices; // 带 _contentSource 的消息在请求体中的插入点
+        requestBody.beginObject();
+        requestBody.key("model").value(getModelName());
+        if (snapshot._requestLayout == RequestLayout::CacheAware)
+        {
+            // 稳定前缀 (model、messages) 在前，易变参数在后
+            requestBody.key("messages");
+            if (!writeMessages(requestBody, messages, snapshot._requestLayout, &splices))
+                return false;
+            requestBody.key("stream").value(true); // 关键！
+            if (snapshot._streamUsage)
+                requestBody.key("stream_options").beginObject().key("include_usage").value(true).endObject();
+            requestBody.key("temperature").value(temperature);
+            requestBody.key("max_tokens").value(maxTokens);
+        }
+        else
         {
-            ERR("Network Error: {}", to_string(res.error()));
+            requestBody.key("stream").value(true); // 关键！
+            if (snapshot._streamUsage)
+                requestBody.key("stream_options").beginObject().key("include_usage").value(true).endObject();
+            requestBody.key("temperature").value(temperature);
+            requestBody.key("max_tokens").value(maxTokens);
+
+            // 构造 messages 数组
+            requestBody.key("messages");
+            if (!writeMessages(requestBody, messages, snapshot._requestLayout, &splices))
+                return false;
+        }
+        requestBody.endObject();
+
+        INFO("DeepSeek Stream Request: {}", requestBody.view());
+
+        // 3. 构造传输层请求
+        request._path = "/chat/completions";
+        request._headers = {
+            {"Authorization", "Bearer " + snapshot._apiKey},
+            {"Content-Type", "application/json"},
+            {"Accept", "text/event-stream"} // 告诉服务器我们要接收事件流
+        };
+        assignRequestBody(request, requestBody.view(), std::move(splices)); // 有外部内容时流式发送
+        return true;
+    }
+
+    // 发送消息 - 增量返回 - 流式响应
+    std::string DeepSeekProvider::sendMessageStream(
+        const std::vector<Message> &messages,
+        const std::map<std::string, std::string> &requestParam,
+        std::function<void(const std::string &, bool)> callback,
+        CancelTokenPtr cancelToken,
+        TokenUsage *usage)
+    {
+        if (usage)
+            *usage = TokenUsage();
+
+        // 1. 检测模型是否可用
+        if (!isAvailable())
+        {
+            ERR("DeepSeekProvider sendMessageStream: Model not available.");
             return "";
         }
+        ProviderConfigPtr snapshot = config();
 
-        // 11. 兜底检查
-        // 如果连接意外断开且没有收到 [DONE]，需要通知上层结束
-        if (!streamFinish && !gotError)
+        // 请求发出前已被取消
+        if (cancelToken && cancelToken->isCancelled())
         {
-            WARN("Stream ended unexpectedly without [DONE]");
+            WARN("DeepSeekProvider sendMessageStream: Request cancelled before sending.");
+            CancelToken::recordCancelledRequest();
             if (callback)
                 callback("", true);
+            return "";
         }
 
+        // 超时策略：initModel 中的默认值，requestParam 中的同名参数可覆盖；总预算从此刻开始计算
+        TimeoutPolicy timeoutPolicy = snapshot->_streamTimeoutPolicy;
+        applyTimeoutParams(requestParam, timeoutPolicy);
+
+        // 本次请求的临时内存 (请求体、SSE 缓冲区) 都从内存池分配
+        ArenaScope arena;
+        StreamSession session(timeoutPolicy, cancelToken, std::move(callback), arena.resource());
+
+        // 2. 构造请求；流式响应持续时间可能很长，默认读空闲超时为 300 秒，首 token 超时由 deadline 单独检查
+        HttpRequest request;
+        if (!buildStreamRequest(*snapshot, messages, requestParam, arena.resource(), request))
+        {
+            ERR("DeepSeekProvider sendMessageStream: Failed to build request body.");
+            session.deliverFinal();
+            return "";
+        }
+        session._deadline.apply(request);
+
+        // 3. 发送请求并在调用线程等待 (由传输层负责取消时中止读取)
+        bool sendOk = snapshot->_transport->send(request, *session._response, [&session](const char *data, size_t len)
+                                                 { return session.onBody(data, len); }, session._deadline.token());
+        std::string fullResponse = session.finish(sendOk);
+        recordUsage(session._usage, usage);
         return fullResponse;
     }
 
+    // 发送消息 - 增量返回 - 异步
+    void DeepSeekProvider::sendMessageStreamAsync(const std::vector<Message> &messages,
+                                                  const std::map<std::string, std::string> &requestParam,
+                                                  std::function<void(const std::string &, bool)> callback,
+                                                  StreamCompletion onComplete, CancelTokenPtr cancelToken)
+    {
+        if (!isAvailable())
+        {
+            ERR("DeepSeekProvider sendMessageStreamAsync: Model not available.");
+            if (onComplete)
+                onComplete("", TokenUsage());
+            return;
+        }
+        ProviderConfigPtr snapshot = config();
+
+        if (cancelToken && cancelToken->isCancelled())
+        {
+            WARN("DeepSeekProvider sendMessageStreamAsync: Request cancelled before sending.");
+            CancelToken::recordCancelledRequest();
+            if (callback)
+                callback("", true);
+            if (onComplete)
+                onComplete("", TokenUsage());
+            return;
+        }
+
+        TimeoutPolicy timeoutPolicy = snapshot->_streamTimeoutPolicy;
+        applyTimeoutParams(requestParam, timeoutPolicy);
+
+        // 回调在传输层的线程上执行，调用线程的内存池不能跨线程使用，SSE 缓冲区改用默认分配器；
+        // 请求体仍在调用线程上构造，可以使用内存池
+        auto session = std::make_shared<StreamSession>(timeoutPolicy, cancelToken, std::move(callback), std::pmr::get_default_resource());
+        HttpRequest request;
+        bool built;
+        {
+            ArenaScope arena;
+            built = buildStreamRequest(*snapshot, messages, requestParam, arena.resource(), request);
+        }
+        if (!built)
+        {
+            ERR("DeepSeekProvider sendMessageStreamAsync: Failed to build request body.");
+            session->deliverFinal();
+            if (onComplete)
+                onComplete("", TokenUsage());
+            return;
+        }
+        session->_deadline.apply(request);
+
+        // reactor 传输立即返回，SSE 解析与回调都在事件循环线程执行；其它传输在当前线程完成
+        snapshot->_transport->sendAsync(
+            request, session->_response, [session](const char *data, size_t len)
+            { return session->onBody(data, len); },
+            [this, session, onComplete](bool ok)
+            {
+                std::string fullResponse = session->finish(ok);
+                recordUsage(session->_usage, nullptr);
+                if (onComplete)
+                    onComplete(fullResponse, session->_usage);
+            },
+            session->_deadline.token());
+    }
+
 } // end ai_chat_sdk
@@ -0,0 +1,174 @@
+#include "../include/EmbeddingProvider.h"
+#include "../include/util/myLog.h"
+#include "../include/util/jsonWriter.h"
+#include "../include/util/vectorMath.h"
+#include <jsoncpp/json/json.h>
+#include <cctype>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        // 解码 UTF-8 为码点，非法字节按单字节处理
+        std::vector<uint32_t> decodeUtf8(const std::string &text)
+        {
+            std::vector<uint32_t> codepoints;
+            codepoints.reserve(text.size());
+            size_t i = 0;
+            while (i < text.size())
+            {
+                unsigned char c = static_cast<unsigned char>(text[i]);
+                uint32_t cp = c;
+                size_t len = 1;
+                if (c >= 0xF0)
+                {
+                    cp = c & 0x07;
+                    len = 4;
+                }
+                else if (c >= 0xE0)
+                {
+                    cp = c & 0x0F;
+                    len = 3;
+                }
+                else if (c >= 0xC0)
+                {
+                    cp = c & 0x1F;
+                    len = 2;
+                }
+                if (len > 1 && i + len <= text.size())
+                {
+                    for (size_t k = 1; k < len; ++k)
+                        cp = (cp << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+                }
+                else
+                {
+                    cp = c;
+                    len = 1;
+                }
+                codepoints.push_back(cp);
+                i += len;
+            }
+            return codepoints;
+        }
+
+        // 空白与标点不参与特征 (ASCII 标点、CJK 标点、全角符号)
+        bool isIgnored(uint32_t cp)
+        {
+            if (cp < 0x80)
+                return std::isspace(static_cast<int>(cp)) || std::ispunct(static_cast<int>(cp));
+            return (cp >= 0x3000 && cp <= 0x303F) || (cp >= 0xFF00 && cp <= 0xFF0F) || (cp >= 0xFF1A && cp <= 0xFF20) ||
+                   (cp >= 0x2000 && cp <= 0x206F);
+        }
+
+        uint64_t hashGram(const uint32_t *begin, size_t n)
+        {
+            uint64_t hash = 1469598103934665603ULL; // FNV-1a
+            for (size_t i = 0; i < n; ++i)
+            {
+                hash ^= begin[i];
+                hash *= 1099511628211ULL;
+            }
+            hash ^= n; // 不同长度的 n-gram 落在不同位置
+            hash *= 1099511628211ULL;
+            return hash;
+        }
+    }
+
+    OpenAIEmbeddingProvider::OpenAIEmbeddingProvider(const std::string &endpoint, const std::string &apiKey,
+                                                     const std::string &model, size_t dimension,
+                                                     const std::string &transport)
+        : _apiKey(apiKey), _model(model), _dimension(dimension ? dimension : 1536), _transport(createTransport(transport, endpoint))
+    {
+    }
+
+    bool OpenAIEmbeddingProvider::embed(const std::string &text, std::vector<float> &vector, CancelTokenPtr cancelToken)
+    {
+        // 1. 构造请求体
+        JsonWriter requestBody;
+        requestBody.beginObject();
+        requestBody.key("model").value(_model);
+        requestBody.key("input").value(text);
+        requestBody.key("dimensions").value(static_cast<long long>(_dimension));
+        requestBody.endObject();
+
+        HttpRequest request;
+        request._path = "/v1/embeddings";
+        request._headers = {
+            {"Authorization", "Bearer " + _apiKey},
+            {"Content-Type", "application/json"}};
+        request._body.assign(requestBody.view());
+        request._connectTimeoutSec = 10;
+        request._readTimeoutSec = 30;
+
+        // 2. 发送请求
+        HttpResponse response;
+        if (!_transport->send(request, response, nullptr, cancelToken))
+        {
+            ERR("OpenAIEmbeddingProvider: request failed (Network Error): {}", response._error);
+            return false;
+        }
+        if (response._status != 200)
+        {
+            ERR("OpenAIEmbeddingProvider: Status: {}, Body: {}", response._status, response._body);
+            return false;
+        }
+
+        // 3. 解析 data[0].embedding
+        Json::Value parsed;
+        Json::CharReaderBuilder readerBuilder;
+        std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
+        std::string parseError;
+        const char *begin = response._body.data();
+        if (!reader->parse(begin, begin + response._body.size(), &parsed, &parseError))
+        {
+            ERR("OpenAIEmbeddingProvider: JSON parse failed: {}", parseError);
+            return false;
+        }
+        const Json::Value &root = parsed;
+        const Json::Value &embedding = root["data"][0]["embedding"];
+        if (!embedding.isArray() || embedding.size() != _dimension)
+        {
+            ERR("OpenAIEmbeddingProvider: unexpected embedding size {}", embedding.isArray() ? embedding.size() : 0);
+            return false;
+        }
+        vector.resize(_dimension);
+        for (Json::ArrayIndex i = 0; i < embedding.size(); ++i)
+            vector[i] = embedding[i].asFloat();
+        return true;
+    }
+
+    HashEmbeddingProvider::HashEmbeddingProvider(size_t dimension)
+        : _dimension(dimension ? dimension : 256)
+    {
+    }
+
+    bool HashEmbeddingProvider::embed(const std::string &text, std::vector<float> &vector, CancelTokenPtr /*cancelToken*/)
+    {
+        // 1. 规范化：去掉空白与标点，ASCII 转小写
+        std::vector<uint32_t> chars;
+        for (uint32_t cp : decodeUtf8(text))
+        {
+            if (isIgnored(cp))
+                continue;
+            chars.push_back(cp < 0x80 ? static_cast<uint32_t>(std::tolower(static_cast<int>(cp))) : cp);
+        }
+
+        // 2. 1~3 字符 n-gram 哈希到向量的某一维，哈希的最高位决定符号
+        vector.assign(_dimension, 0.0f);
+        static const float kWeights[] = {0.5f, 1.0f, 1.0f};
+        for (size_t n = 1; n <= 3; ++n)
+        {
+            for (size_t i = 0; i + n <= chars.size(); ++i)
+            {
+                uint64_t hash = hashGram(&chars[i], n);
+                float sign = (hash >> 63) ? -1.0f : 1.0f;
+                vector[(hash >> 1) % _dimension] += sign * kWeights[n - 1];
+            }
+        }
+
+        // 3. 归一化后点积即余弦相似度
+        vecmath::normalize(vector.data(), vector.size());
+        return !chars.empty();
+    }
+
+} // end ai_chat_sdk
@@ -0,0 +1,302 @@
+#include "../include/HnswIndex.h"
+#include "../include/util/vectorMath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        // 每个线程复用的访问标记：tag == epoch 表示本次搜索已访问
+        struct VisitedSet
+        {
+            std::vector<uint32_t> _tags;
+            uint32_t _epoch = 0;
+
+            void reset(size_t size)
+            {
+                if (_tags.size() < size)
+                    _tags.resize(size, 0);
+                if (++_epoch == 0)
+                {
+                    std::fill(_tags.begin(), _tags.end(), 0);
+                    _epoch = 1;
+                }
+            }
+            // 首次访问返回 true
+            bool visit(uint32_t slot)
+            {
+                if (_tags[slot] == _epoch)
+                    return false;
+                _tags[slot] = _epoch;
+                return true;
+            }
+        };
+
+        thread_local VisitedSet t_visited;
+    }
+
+    HnswIndex::HnswIndex(size_t dimension, size_t capacity, size_t m, size_t efConstruction, unsigned seed)
+        : _dimension(dimension),
+          _capacity(capacity),
+          _m(std::max<size_t>(m, 2)),
+          _maxM0(std::max<size_t>(m, 2) * 2),
+          _efConstruction(std::max(efConstruction, m)),
+          _levelMult(1.0 / std::log(static_cast<double>(std::max<size_t>(m, 2)))),
+          _rng(seed)
+    {
+    }
+
+    float HnswIndex::distance(const float *query, uint32_t slot) const
+    {
+        return 1.0f - vecmath::dot(query, vector(slot), _dimension);
+    }
+
+    int HnswIndex::randomLevel()
+    {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        double r = uniform(_rng);
+        if (r <= 0.0)
+            r = 1e-12;
+        return static_cast<int>(-std::log(r) * _levelMult);
+    }
+
+    std::vector<HnswIndex::Candidate> HnswIndex::searchLayer(const float *query, const std::vector<Candidate> &entries,
+                                                             size_t ef, int level) const
+    {
+        VisitedSet &visited = t_visited;
+        visited.reset(_nodes.size());
+
+        // candidates：待扩展的节点 (距离最小的先出)；results：当前最近的 ef 个 (距离最大的在堆顶)
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+        std::priority_queue<Candidate> results;
+        for (const auto &entry : entries)
+        {
+            if (!visited.visit(entry.second))
+                continue;
+            candidates.push(entry);
+            results.push(entry);
+        }
+        while (results.size() > ef)
+            results.pop();
+
+        while (!candidates.empty())
+        {
+            Candidate current = candidates.top();
+            if (results.size() >= ef && current.first > results.top().first)
+                break;
+            candidates.pop();
+
+            for (uint32_t neighbor : _nodes[current.second]._links[level])
+            {
+                // 槽位被复用后，旧的单向入边可能指向层数更低的新节点
+                if (_nodes[neighbor]._level < level || !visited.visit(neighbor))
+                    continue;
+                float dist = distance(query, neighbor);
+                if (results.size() < ef || dist < results.top().first)
+                {
+                    candidates.emplace(dist, neighbor);
+                    results.emplace(dist, neighbor);
+                    if (results.size() > ef)
+                        results.pop();
+                }
+            }
+        }
+
+        std::vector<Candidate> nearest(results.size());
+        for (size_t i = nearest.size(); i > 0; --i)
+        {
+            nearest[i - 1] = results.top();
+            results.pop();
+        }
+        return nearest;
+    }
+
+    std::vector<uint32_t> HnswIndex::selectNeighbors(std::vector<Candidate> candidates, size_t maxCount) const
+    {
+        std::sort(candidates.begin(), candidates.end());
+        std::vector<uint32_t> selected;
+        selected.reserve(maxCount);
+        for (const auto &candidate : candidates)
+        {
+            if (selected.size() >= maxCount)
+                break;
+            // 候选离某个已选邻居比离目标更近时，通过那个邻居就能到达它，不再单独连边
+            bool diverse = true;
+            for (uint32_t chosen : selected)
+            {
+                if (distance(vector(candidate.second), chosen) < candidate.first)
+                {
+                    diverse = false;
+                    break;
+                }
+            }
+            if (diverse)
+                selected.push_back(candidate.second);
+        }
+        return selected;
+    }
+
+    void HnswIndex::unlink(uint32_t slot)
+    {
+        Node &node = _nodes[slot];
+        for (int level = 0; level <= node._level; ++level)
+        {
+            for (uint32_t neighbor : node._links[level])
+            {
+                Node &other = _nodes[neighbor];
+                if (other._level < level)
+                    continue;
+                auto &links = other._links[level];
+                links.erase(std::remove(links.begin(), links.end(), slot), links.end());
+            }
+        }
+        node._links.clear();
+    }
+
+    void HnswIndex::resetEntryPoint(uint32_t excluded)
+    {
+        _entryPoint = -1;
+        _maxLevel = -1;
+        for (uint32_t slot = 0; slot < _nodes.size(); ++slot)
+        {
+            if (slot != excluded && _nodes[slot]._level > _maxLevel)
+            {
+                _entryPoint = slot;
+                _maxLevel = _nodes[slot]._level;
+            }
+        }
+    }
+
+    void HnswIndex::add(uint32_t slot, const float *vec)
+    {
+        if (slot >= _capacity)
+            return;
+        if (_nodes.size() <= slot)
+        {
+            _nodes.resize(slot + 1);
+            _vectors.resize((static_cast<size_t>(slot) + 1) * _dimension);
+        }
+
+        // 1. 槽位已被使用：断开旧连接后按新节点插入
+        Node &node = _nodes[slot];
+        if (node._level >= 0)
+        {
+            if (!node._deleted)
+                --_size;
+            unlink(slot);
+            node._level = -1;
+            if (_entryPoint == slot)
+                resetEntryPoint(slot);
+        }
+
+        std::memcpy(&_vectors[static_cast<size_t>(slot) * _dimension], vec, _dimension * sizeof(float));
+        int level = randomLevel();
+        node._level = level;
+        node._deleted = false;
+        node._links.assign(level + 1, std::vector<uint32_t>());
+        ++_size;
+
+        if (_entryPoint < 0)
+        {
+            _entryPoint = slot;
+            _maxLevel = level;
+            return;
+        }
+
+        // 2. 在高于 level 的层贪心下降
+        const float *query = vector(slot);
+        uint32_t entry = static_cast<uint32_t>(_entryPoint);
+        std::vector<Candidate> entries = {{distance(query, entry), entry}};
+        for (int lc = _maxLevel; lc > level; --lc)
+        {
+            entries = searchLayer(query, entries, 1, lc);
+        }
+
+        // 3. 逐层选邻居并建立双向连接，超出上限的邻居重新裁剪
+        for (int lc = std::min(level, _maxLevel); lc >= 0; --lc)
+        {
+            std::vector<Candidate> found = searchLayer(query, entries, _efConstruction, lc);
+            std::vector<Candidate> usable;
+            usable.reserve(found.size());
+            for (const auto &candidate : found)
+            {
+                if (candidate.second != slot && !_nodes[candidate.second]._deleted)
+                    usable.push_back(candidate);
+            }
+
+            node._links[lc] = selectNeighbors(usable, _m);
+            size_t maxConn = lc == 0 ? _maxM0 : _m;
+            for (uint32_t neighbor : node._links[lc])
+            {
+                auto &links = _nodes[neighbor]._links[lc];
+                links.push_back(slot);
+                if (links.size() > maxConn)
+                {
+                    std::vector<Candidate> candidates;
+                    candidates.reserve(links.size());
+                    for (uint32_t other : links)
+                        candidates.emplace_back(distance(vector(neighbor), other), other);
+                    links = selectNeighbors(std::move(candidates), maxConn);
+                }
+            }
+            if (!found.empty())
+                entries = std::move(found);
+        }
+
+        if (level > _maxLevel)
+        {
+            _maxLevel = level;
+            _entryPoint = slot;
+        }
+    }
+
+    void HnswIndex::remove(uint32_t slot)
+    {
+        if (!contains(slot))
+            return;
+        _nodes[slot]._deleted = true;
+        --_size;
+    }
+
+    std::vector<std::pair<float, uint32_t>> HnswIndex::search(const float *query, size_t k, size_t ef) const
+    {
+        std::vector<Candidate> nearest;
+        if (_entryPoint < 0 || k == 0)
+            return nearest;
+
+        uint32_t entry = static_cast<uint32_t>(_entryPoint);
+        std::vector<Candidate> entries = {{distance(query, entry), entry}};
+        for (int lc = _maxLevel; lc > 0; --lc)
+        {
+            entries = searchLayer(query, entries, 1, lc);
+        }
+
+        // 已删除的节点仍用于导航，只在最终结果中过滤
+        std::vector<Candidate> found = searchLayer(query, entries, std::max(ef, k), 0);
+        for (const auto &candidate : found)
+        {
+            if (_nodes[candidate.second]._deleted)
+                continue;
+            nearest.push_back(candidate);
+            if (nearest.size() == k)
+                break;
+        }
+        return nearest;
+    }
+
+    size_t HnswIndex::memoryBytes() const
+    {
+        size_t bytes = _vectors.capacity() * sizeof(float) + _nodes.capacity() * sizeof(Node);
+        for (const auto &node : _nodes)
+        {
+            for (const auto &links : node._links)
+                bytes += links.capacity() * sizeof(uint32_t);
+        }
+        return bytes;
+    }
+
+} // end ai_chat_sdk
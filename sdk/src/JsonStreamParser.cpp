@@ -0,0 +1,558 @@
+#include "../include/JsonStreamParser.h"
+#include "../include/util/myLog.h"
+#include <cstdlib>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        bool isSpace(char c)
+        {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        }
+
+        bool isNumberChar(char c)
+        {
+            return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+        }
+
+        int hexValue(char c)
+        {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+            return -1;
+        }
+
+        // 按 JSON 语法检查数字：-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+        bool validNumber(const std::string &text)
+        {
+            size_t i = 0, n = text.size();
+            auto digits = [&]()
+            {
+                size_t start = i;
+                while (i < n && text[i] >= '0' && text[i] <= '9')
+                    ++i;
+                return i > start;
+            };
+            if (i < n && text[i] == '-')
+                ++i;
+            if (i < n && text[i] == '0')
+                ++i;
+            else if (!digits())
+                return false;
+            if (i < n && text[i] == '.')
+            {
+                ++i;
+                if (!digits())
+                    return false;
+            }
+            if (i < n && (text[i] == 'e' || text[i] == 'E'))
+            {
+                ++i;
+                if (i < n && (text[i] == '+' || text[i] == '-'))
+                    ++i;
+                if (!digits())
+                    return false;
+            }
+            return i == n;
+        }
+
+        // 字段名按 RFC 6901 转义：~ -> ~0，/ -> ~1
+        void appendPointerToken(std::string &path, const std::string &key)
+        {
+            for (char c : key)
+            {
+                if (c == '~')
+                    path += "~0";
+                else if (c == '/')
+                    path += "~1";
+                else
+                    path += c;
+            }
+        }
+    }
+
+    double JsonEvent::asDouble() const
+    {
+        return std::strtod(std::string(_text).c_str(), nullptr);
+    }
+
+    int64_t JsonEvent::asInt() const
+    {
+        return std::strtoll(std::string(_text).c_str(), nullptr, 10);
+    }
+
+    JsonStreamParser::JsonStreamParser(Handler handler)
+        : _handler(std::move(handler))
+    {
+    }
+
+    void JsonStreamParser::reset()
+    {
+        _state = State::Preamble;
+        _expect = Expect::Value;
+        _depth = 0;
+        _path.clear();
+        _text.clear();
+        _target = nullptr;
+        _inKey = false;
+        _partStart = 0;
+        _unicode = 0;
+        _hexDigits = 0;
+        _highSurrogate = 0;
+        _literal = nullptr;
+        _literalPos = 0;
+        _consumed = 0;
+        _error.clear();
+    }
+
+    bool JsonStreamParser::feed(std::string_view chunk)
+    {
+        size_t i = 0;
+        while (i < chunk.size() && _state != State::Error)
+        {
+            switch (_state)
+            {
+            case State::Preamble:
+            {
+                // 跳过根容器之前的内容
+                size_t pos = chunk.find_first_of("{[", i);
+                if (pos == std::string_view::npos)
+                {
+                    i = chunk.size();
+                    break;
+                }
+                i = pos;
+                _state = State::Structural;
+                break;
+            }
+            case State::Structural:
+                i = structural(chunk, i);
+                break;
+            case State::String:
+                i = scanString(chunk, i);
+                break;
+            case State::Escape:
+            {
+                char c = chunk[i];
+                _state = State::String;
+                switch (c)
+                {
+                case '"':
+                case '\\':
+                case '/':
+                    flushSurrogate();
+                    *_target += c;
+                    break;
+                case 'b':
+                    flushSurrogate();
+                    *_target += '\b';
+                    break;
+                case 'f':
+                    flushSurrogate();
+                    *_target += '\f';
+                    break;
+                case 'n':
+                    flushSurrogate();
+                    *_target += '\n';
+                    break;
+                case 'r':
+                    flushSurrogate();
+                    *_target += '\r';
+                    break;
+                case 't':
+                    flushSurrogate();
+                    *_target += '\t';
+                    break;
+                case 'u':
+                    _unicode = 0;
+                    _hexDigits = 0;
+                    _state = State::Unicode;
+                    break;
+                default:
+                    fail("invalid escape character", i);
+                    break;
+                }
+                ++i;
+                break;
+            }
+            case State::Unicode:
+            {
+                int value = hexValue(chunk[i]);
+                if (value < 0)
+                {
+                    fail("invalid \\u escape", i);
+                    break;
+                }
+                _unicode = (_unicode << 4) | static_cast<uint32_t>(value);
+                if (++_hexDigits == 4)
+                {
+                    appendCodepoint(_unicode);
+                    _state = State::String;
+                }
+                ++i;
+                break;
+            }
+            case State::Number:
+                if (isNumberChar(chunk[i]))
+                {
+                    _text += chunk[i++];
+                    break;
+                }
+                // 数字在遇到第一个非数字字符时结束，该字符按记号重新处理
+                if (!validNumber(_text))
+                {
+                    fail("invalid number", i);
+                    break;
+                }
+                finishNumber();
+                break;
+            case State::Literal:
+                if (chunk[i] != _literal[_literalPos])
+                {
+                    fail("invalid literal", i);
+                    break;
+                }
+                ++i;
+                if (_literal[++_literalPos] == '\0')
+                {
+                    if (_literal[0] == 'n')
+                        emit(JsonEventType::Value, JsonValueType::Null, _literal);
+                    else
+                        emit(JsonEventType::Value, JsonValueType::Bool, _literal, _literal[0] == 't');
+                    _literal = nullptr;
+                    finishValue();
+                }
+                break;
+            case State::Done:
+                i = chunk.size(); // 根容器之后的内容 (如代码块结束标记) 忽略
+                break;
+            case State::Error:
+                break;
+            }
+        }
+        if (_state != State::Error)
+        {
+            _consumed += chunk.size();
+            flushStringPart();
+        }
+        return _state != State::Error;
+    }
+
+    bool JsonStreamParser::finish()
+    {
+        if (_state == State::Done)
+            return true;
+        if (_state == State::Error)
+            return false;
+        fail(_state == State::Preamble ? "no JSON object or array found" : "unexpected end of input", 0);
+        return false;
+    }
+
+    size_t JsonStreamParser::structural(std::string_view chunk, size_t i)
+    {
+        char c = chunk[i];
+        if (isSpace(c))
+            return i + 1;
+
+        switch (_expect)
+        {
+        case Expect::ValueOrEnd:
+            if (c == ']')
+            {
+                closeContainer(c);
+                return i + 1;
+            }
+            [[fallthrough]];
+        case Expect::Value:
+            beginValue();
+            if (c == '{' || c == '[')
+            {
+                openContainer(c == '{');
+            }
+            else if (c == '"')
+            {
+                _text.clear();
+                _partStart = 0;
+                _target = &_text;
+                _inKey = false;
+                _state = State::String;
+            }
+            else if (c == '-' || (c >= '0' && c <= '9'))
+            {
+                _text.assign(1, c);
+                _state = State::Number;
+            }
+            else if (c == 't' || c == 'f' || c == 'n')
+            {
+                _literal = c == 't' ? "true" : (c == 'f' ? "false" : "null");
+                _literalPos = 1;
+                _state = State::Literal;
+            }
+            else
+            {
+                fail("unexpected character, expecting a value", i);
+            }
+            return i + 1;
+        case Expect::KeyOrEnd:
+            if (c == '}')
+            {
+                closeContainer(c);
+                return i + 1;
+            }
+            [[fallthrough]];
+        case Expect::Key:
+            if (c != '"')
+            {
+                fail("unexpected character, expecting a field name", i);
+                return i + 1;
+            }
+            _target = &_frames[_depth - 1]._key;
+            _target->clear();
+            _inKey = true;
+            _state = State::String;
+            return i + 1;
+        case Expect::Colon:
+            if (c != ':')
+                fail("unexpected character, expecting ':'", i);
+            _expect = Expect::Value;
+            return i + 1;
+        case Expect::CommaOrEnd:
+        {
+            Frame &frame = _frames[_depth - 1];
+            if (c == ',')
+            {
+                if (frame._object)
+                {
+                    _expect = Expect::Key;
+                }
+                else
+                {
+                    ++frame._index;
+                    _expect = Expect::Value;
+                }
+            }
+            else if ((c == '}' && frame._object) || (c == ']' && !frame._object))
+            {
+                closeContainer(c);
+            }
+            else
+            {
+                fail("unexpected character, expecting ',' or end of container", i);
+            }
+            return i + 1;
+        }
+        }
+        return i + 1;
+    }
+
+    size_t JsonStreamParser::scanString(std::string_view chunk, size_t i)
+    {
+        // 连续的普通字符整段追加
+        size_t start = i;
+        while (i < chunk.size() && chunk[i] != '"' && chunk[i] != '\\')
+            ++i;
+        if (i > start)
+        {
+            flushSurrogate();
+            _target->append(chunk.data() + start, i - start);
+        }
+        if (i == chunk.size())
+            return i;
+        if (chunk[i] == '\\')
+        {
+            _state = State::Escape;
+            return i + 1;
+        }
+        finishString();
+        return i + 1;
+    }
+
+    void JsonStreamParser::beginValue()
+    {
+        if (_depth == 0)
+        {
+            _path.clear();
+            return;
+        }
+        const Frame &frame = _frames[_depth - 1];
+        _path.resize(frame._pathLen);
+        _path += '/';
+        if (frame._object)
+            appendPointerToken(_path, frame._key);
+        else
+            _path += std::to_string(frame._index);
+    }
+
+    void JsonStreamParser::openContainer(bool object)
+    {
+        emit(object ? JsonEventType::BeginObject : JsonEventType::BeginArray,
+             object ? JsonValueType::Object : JsonValueType::Array);
+        if (_frames.size() <= _depth)
+            _frames.emplace_back();
+        Frame &frame = _frames[_depth++];
+        frame._object = object;
+        frame._index = 0;
+        frame._pathLen = _path.size();
+        frame._key.clear();
+        _expect = object ? Expect::KeyOrEnd : Expect::ValueOrEnd;
+    }
+
+    void JsonStreamParser::closeContainer(char c)
+    {
+        // 出栈后 _path 恢复为容器自身的路径，父节点信息用于填写 _key / _index
+        _path.resize(_frames[--_depth]._pathLen);
+        if (c == '}')
+            emit(JsonEventType::EndObject, JsonValueType::Object);
+        else
+            emit(JsonEventType::EndArray, JsonValueType::Array);
+        finishValue();
+    }
+
+    void JsonStreamParser::finishString()
+    {
+        flushSurrogate();
+        if (_inKey)
+        {
+            _inKey = false;
+            _expect = Expect::Colon;
+            _state = State::Structural;
+            return;
+        }
+        flushStringPart();
+        emit(JsonEventType::Value, JsonValueType::String, _text);
+        finishValue();
+    }
+
+    void JsonStreamParser::finishNumber()
+    {
+        emit(JsonEventType::Value, JsonValueType::Number, _text);
+        finishValue();
+    }
+
+    void JsonStreamParser::finishValue()
+    {
+        _state = _depth == 0 ? State::Done : State::Structural;
+        _expect = Expect::CommaOrEnd;
+    }
+
+    void JsonStreamParser::appendCodepoint(uint32_t cp)
+    {
+        // UTF-16 代理对：高位代理先暂存，与紧随其后的低位代理合并；落单的代理写为 U+FFFD
+        if (cp >= 0xD800 && cp <= 0xDBFF)
+        {
+            flushSurrogate();
+            _highSurrogate = cp;
+            return;
+        }
+        if (cp >= 0xDC00 && cp <= 0xDFFF)
+        {
+            if (_highSurrogate)
+            {
+                cp = 0x10000 + ((_highSurrogate - 0xD800) << 10) + (cp - 0xDC00);
+                _highSurrogate = 0;
+            }
+            else
+            {
+                cp = 0xFFFD;
+            }
+        }
+        else
+        {
+            flushSurrogate();
+        }
+
+        std::string &out = *_target;
+        if (cp < 0x80)
+        {
+            out += static_cast<char>(cp);
+        }
+        else if (cp < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    void JsonStreamParser::flushSurrogate()
+    {
+        if (!_highSurrogate)
+            return;
+        _highSurrogate = 0;
+        *_target += "\xEF\xBF\xBD"; // U+FFFD
+    }
+
+    void JsonStreamParser::flushStringPart()
+    {
+        // 字段名不发出片段；值字符串中尚未发出的部分作为一个 StringPart
+        bool inString = _state == State::String || _state == State::Escape || _state == State::Unicode;
+        if (!inString || _inKey || _text.size() <= _partStart)
+            return;
+        emit(JsonEventType::StringPart, JsonValueType::String, std::string_view(_text).substr(_partStart));
+        _partStart = _text.size();
+    }
+
+    void JsonStreamParser::emit(JsonEventType type, JsonValueType valueType, std::string_view text, bool flag)
+    {
+        if (!_handler)
+            return;
+        JsonEvent event;
+        event._type = type;
+        event._valueType = valueType;
+        event._path = _path;
+        event._depth = _depth;
+        event._text = text;
+        event._bool = flag;
+        if (_depth > 0)
+        {
+            const Frame &parent = _frames[_depth - 1];
+            if (parent._object)
+                event._key = parent._key;
+            else
+                event._index = parent._index;
+        }
+        _handler(event);
+    }
+
+    void JsonStreamParser::fail(const std::string &message, size_t pos)
+    {
+        _state = State::Error;
+        _error = message + " at offset " + std::to_string(_consumed + pos);
+    }
+
+    std::function<void(const std::string &, bool)> streamJsonCallback(std::shared_ptr<JsonStreamParser> parser,
+                                                                     std::function<void(const std::string &, bool)> next)
+    {
+        return [parser, next](const std::string &delta, bool last)
+        {
+            if (!parser->failed() && !parser->done())
+            {
+                if (!delta.empty() && !parser->feed(delta))
+                    WARN("JsonStreamParser: {}", parser->error());
+                // 取消或超时时响应不完整，只记调试日志
+                if (last && !parser->failed() && !parser->finish())
+                    DBG("JsonStreamParser: {}", parser->error());
+            }
+            if (next)
+                next(delta, last);
+        };
+    }
+
+} // end ai_chat_sdk
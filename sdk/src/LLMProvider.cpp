@@ -0,0 +1,73 @@
+#include "../include/LLMProvider.h"
+#include "../include/util/myLog.h"
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        std::atomic<uint64_t> g_nextProviderId{1};
+
+        // 线程本地的快照缓存，按 providerId 直接映射
+        // 命中时只需一次版本号读取与一次引用计数递增，不访问 _config 本身
+        // 只保存弱引用：Provider 析构或快照被替换后，缓存不会让旧快照 (及其传输层) 继续存活
+        struct ConfigCacheEntry
+        {
+            uint64_t _providerId = 0;
+            uint64_t _version = 0;
+            std::weak_ptr<const ProviderConfig> _config;
+        };
+        const size_t kConfigCacheSize = 16;
+        thread_local ConfigCacheEntry t_configCache[kConfigCacheSize];
+    }
+
+    LLMProvider::LLMProvider()
+        : _providerId(g_nextProviderId.fetch_add(1, std::memory_order_relaxed))
+    {
+    }
+
+    ProviderConfigPtr LLMProvider::config() const
+    {
+        // 先读版本号：发布时先替换快照再递增版本号，版本号相同说明缓存的快照仍是最新的
+        uint64_t version = _configVersion.load(std::memory_order_acquire);
+        ConfigCacheEntry &entry = t_configCache[_providerId % kConfigCacheSize];
+        if (entry._providerId == _providerId && entry._version == version)
+        {
+            // 版本号未变时 _config 仍持有该快照，lock() 只在并发发布的窗口内失败
+            if (ProviderConfigPtr cached = entry._config.lock())
+                return cached;
+        }
+
+        // 读到的快照可能比 version 更新，下次调用时版本号不一致会重新读取
+        ProviderConfigPtr current = std::atomic_load(&_config);
+        entry._providerId = _providerId;
+        entry._version = version;
+        entry._config = current;
+        return current;
+    }
+
+    void LLMProvider::publishConfig(const std::shared_ptr<ProviderConfig> &config)
+    {
+        std::lock_guard<std::mutex> lock(_publishMutex);
+        std::atomic_store(&_config, ProviderConfigPtr(config));
+        _configVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    bool LLMProvider::rotateApiKey(const std::string &apiKey)
+    {
+        std::lock_guard<std::mutex> lock(_publishMutex);
+        ProviderConfigPtr current = std::atomic_load(&_config);
+        if (!current)
+        {
+            ERR("rotateApiKey: provider {} is not initialized", getModelName());
+            return false;
+        }
+
+        auto next = std::make_shared<ProviderConfig>(*current);
+        next->_apiKey = apiKey;
+        std::atomic_store(&_config, ProviderConfigPtr(std::move(next)));
+        _configVersion.fetch_add(1, std::memory_order_release);
+        INFO("rotateApiKey: {} switched to a new API key, config version {}", getModelName(), configVersion());
+        return true;
+    }
+
+} // end ai_chat_sdk
@@ -0,0 +1,121 @@
+#include "../include/PromptCache.h"
+#include "../include/transport/StreamingBody.h"
+#include "../include/util/myLog.h"
+#include <jsoncpp/json/json.h>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        void writeContent(JsonWriter &writer, const std::string &content, RequestLayout layout)
+        {
+            if (layout == RequestLayout::CacheAware && content.find('\r') != std::string::npos)
+            {
+                // 统一换行符，避免同一段历史因客户端不同而序列化出不同字节
+                std::string normalized;
+                normalized.reserve(content.size());
+                for (size_t i = 0; i < content.size(); ++i)
+                {
+                    if (content[i] == '\r' && i + 1 < content.size() && content[i + 1] == '\n')
+                        continue;
+                    normalized += content[i];
+                }
+                writer.value(normalized);
+            }
+            else
+            {
+                writer.value(content);
+            }
+        }
+
+        bool writeMessage(JsonWriter &writer, const Message &msg, RequestLayout layout, std::vector<BodySplice> *splices)
+        {
+            writer.beginObject();
+            writer.key("role").value(msg._role);
+            writer.key("content");
+            if (msg._contentSource && splices)
+            {
+                // 外部内容只记录插入点，发送时边读边转义
+                BodySplice splice;
+                splice._offset = writer.externalValue();
+                splice._source = msg._contentSource;
+                splice._normalizeNewlines = layout == RequestLayout::CacheAware;
+                splices->push_back(std::move(splice));
+            }
+            else if (msg._contentSource)
+            {
+                std::string content;
+                if (!readAll(*msg._contentSource, content))
+                {
+                    // 内容不完整时不能发送截断的文档
+                    ERR("writeMessages: content source {} is incomplete", msg._contentSource->identity());
+                    return false;
+                }
+                writeContent(writer, content, layout);
+            }
+            else
+            {
+                writeContent(writer, msg._content, layout);
+            }
+            writer.endObject();
+            return true;
+        }
+
+        int64_t memberInt(const Json::Value &object, const char *name)
+        {
+            const Json::Value &value = object[name];
+            return value.isIntegral() ? value.asInt64() : 0;
+        }
+    }
+
+    RequestLayout parseRequestLayout(const std::string &value)
+    {
+        if (value == "cache_aware")
+            return RequestLayout::CacheAware;
+        if (!value.empty() && value != "default")
+            WARN("Unknown request_layout '{}', using default", value);
+        return RequestLayout::Default;
+    }
+
+    bool writeMessages(JsonWriter &writer, const std::vector<Message> &messages, RequestLayout layout,
+                       std::vector<BodySplice> *splices)
+    {
+        writer.beginArray();
+        // 保持原顺序：消息顺序有语义 (如中途插入的 system 指令)，重排会改变模型看到的对话
+        for (const auto &msg : messages)
+        {
+            if (!writeMessage(writer, msg, layout, splices))
+                return false;
+        }
+        writer.endArray();
+        return true;
+    }
+
+    bool parseUsage(const Json::Value &usage, TokenUsage &out)
+    {
+        if (!usage.isObject())
+            return false;
+
+        out._valid = true;
+        if (usage.isMember("input_tokens"))
+        {
+            // OpenAI Responses API
+            out._promptTokens = memberInt(usage, "input_tokens");
+            out._completionTokens = memberInt(usage, "output_tokens");
+            out._cachedPromptTokens = memberInt(usage["input_tokens_details"], "cached_tokens");
+        }
+        else
+        {
+            out._promptTokens = memberInt(usage, "prompt_tokens");
+            out._completionTokens = memberInt(usage, "completion_tokens");
+            if (usage.isMember("prompt_cache_hit_tokens"))
+                out._cachedPromptTokens = memberInt(usage, "prompt_cache_hit_tokens"); // DeepSeek
+            else
+                out._cachedPromptTokens = memberInt(usage["prompt_tokens_details"], "cached_tokens"); // OpenAI Chat
+        }
+        out._totalTokens = usage.isMember("total_tokens") ? memberInt(usage, "total_tokens")
+                                                          : out._promptTokens + out._completionTokens;
+        return true;
+    }
+
+} // end ai_chat_sdk
@@ -0,0 +1,147 @@
+#include "../include/RequestArena.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        const size_t kMaxCachedArenas = 4; // 每个线程缓存的内存池个数 (覆盖嵌套调用)
+
+        // 线程退出时随 vector 一起释放
+        thread_local std::vector<std::unique_ptr<RequestArena>> t_arenas;
+
+        struct ThreadCounters;
+
+        // 所有线程的计数器：存活线程的登记在 _live 中，退出线程的计数并入 _retired
+        struct CounterRegistry
+        {
+            std::mutex _mutex;
+            std::vector<ThreadCounters *> _live;
+            RequestArena::Stats _retired;
+        };
+
+        // 不析构：线程可能在静态对象销毁之后才退出
+        CounterRegistry &counterRegistry()
+        {
+            static CounterRegistry *registry = new CounterRegistry();
+            return *registry;
+        }
+
+        // 本线程的计数器：只有本线程写入，其它线程只在 stats() 中读取，不需要原子的读改写
+        struct ThreadCounters
+        {
+            std::atomic<uint64_t> _scopes{0};
+            std::atomic<uint64_t> _arenaAllocations{0};
+            std::atomic<uint64_t> _arenaBytes{0};
+            std::atomic<uint64_t> _upstreamAllocations{0};
+            std::atomic<uint64_t> _upstreamBytes{0};
+
+            ThreadCounters()
+            {
+                CounterRegistry &registry = counterRegistry();
+                std::lock_guard<std::mutex> lock(registry._mutex);
+                registry._live.push_back(this);
+            }
+
+            ~ThreadCounters()
+            {
+                CounterRegistry &registry = counterRegistry();
+                std::lock_guard<std::mutex> lock(registry._mutex);
+                addTo(registry._retired);
+                registry._live.erase(std::find(registry._live.begin(), registry._live.end(), this));
+            }
+
+            void addTo(RequestArena::Stats &stats) const
+            {
+                stats._scopes += _scopes.load(std::memory_order_relaxed);
+                stats._arenaAllocations += _arenaAllocations.load(std::memory_order_relaxed);
+                stats._arenaBytes += _arenaBytes.load(std::memory_order_relaxed);
+                stats._upstreamAllocations += _upstreamAllocations.load(std::memory_order_relaxed);
+                stats._upstreamBytes += _upstreamBytes.load(std::memory_order_relaxed);
+            }
+        };
+
+        thread_local ThreadCounters t_counters;
+
+        void bump(std::atomic<uint64_t> &counter, uint64_t delta)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+    }
+
+    void *RequestArena::CountingResource::do_allocate(size_t bytes, size_t alignment)
+    {
+        if (_upstream)
+        {
+            bump(t_counters._upstreamAllocations, 1);
+            bump(t_counters._upstreamBytes, bytes);
+        }
+        else
+        {
+            bump(t_counters._arenaAllocations, 1);
+            bump(t_counters._arenaBytes, bytes);
+            *_bytesUsed += bytes;
+        }
+        return _next->allocate(bytes, alignment);
+    }
+
+    void RequestArena::CountingResource::do_deallocate(void *p, size_t bytes, size_t alignment)
+    {
+        _next->deallocate(p, bytes, alignment);
+    }
+
+    RequestArena::RequestArena(size_t initialBytes)
+        : _initial(new char[initialBytes]),
+          _initialBytes(initialBytes),
+          _upstream(std::pmr::new_delete_resource(), true, &_bytesUsed),
+          _monotonic(_initial.get(), initialBytes, &_upstream),
+          _counting(&_monotonic, false, &_bytesUsed)
+    {
+    }
+
+    void RequestArena::reset()
+    {
+        _monotonic.release();
+        _bytesUsed = 0;
+    }
+
+    RequestArena::Stats RequestArena::stats()
+    {
+        CounterRegistry &registry = counterRegistry();
+        std::lock_guard<std::mutex> lock(registry._mutex);
+        Stats stats = registry._retired;
+        for (const ThreadCounters *counters : registry._live)
+        {
+            counters->addTo(stats);
+        }
+        return stats;
+    }
+
+    ArenaScope::ArenaScope()
+    {
+        bump(t_counters._scopes, 1);
+        if (!t_arenas.empty())
+        {
+            _arena = std::move(t_arenas.back());
+            t_arenas.pop_back();
+        }
+        else
+        {
+            _arena.reset(new RequestArena());
+        }
+    }
+
+    ArenaScope::~ArenaScope()
+    {
+        // reset 把超出首块的内存全部还给堆，缓存的只有首块缓冲区
+        _arena->reset();
+        if (t_arenas.size() < kMaxCachedArenas)
+        {
+            t_arenas.push_back(std::move(_arena));
+        }
+    }
+
+} // end ai_chat_sdk
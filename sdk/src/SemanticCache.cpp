@@ -0,0 +1,615 @@
+#include "../include/SemanticCache.h"
+#include "../include/ContentSource.h"
+#include "../include/util/myLog.h"
+#include "../include/util/vectorMath.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        const char kSnapshotMagic[8] = {'A', 'I', 'S', 'C', 'A', 'C', 'H', '1'};
+        // 一次查询取的近邻数：最近的几个可能属于其他 scope，找不到同 scope 的条目时加倍重查
+        const size_t kSearchK = 8;
+        // 条目数不超过该值的 scope 直接精确扫描，不经过全局索引
+        const size_t kScopeScanLimit = 256;
+
+        uint64_t fnv1a(uint64_t hash, const std::string &field)
+        {
+            // 长度前缀，避免 ("ab","c") 与 ("a","bc") 得到相同的哈希
+            uint64_t size = field.size();
+            for (int i = 0; i < 8; ++i)
+            {
+                hash ^= (size >> (i * 8)) & 0xFF;
+                hash *= 1099511628211ULL;
+            }
+            for (unsigned char c : field)
+            {
+                hash ^= c;
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        template <typename T>
+        void writePod(std::ofstream &out, const T &value)
+        {
+            out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        bool readPod(std::ifstream &in, T &value)
+        {
+            return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+        }
+
+        void writeString(std::ofstream &out, const std::string &value)
+        {
+            writePod(out, static_cast<uint32_t>(value.size()));
+            out.write(value.data(), value.size());
+        }
+
+        bool readString(std::ifstream &in, std::string &value, uint32_t maxSize)
+        {
+            uint32_t size = 0;
+            if (!readPod(in, size) || size > maxSize)
+                return false;
+            value.resize(size);
+            return size == 0 || static_cast<bool>(in.read(&value[0], size));
+        }
+    }
+
+    // -------------------------------- SemanticCache --------------------------------
+
+    SemanticCache::SemanticCache(size_t dimension, const SemanticCacheOptions &options)
+        : _dimension(dimension),
+          _options(options),
+          _index(dimension, std::max<size_t>(options._capacity, 1), options._m, options._efConstruction)
+    {
+        _options._capacity = std::max<size_t>(_options._capacity, 1);
+        for (auto &bucket : _hitBuckets)
+            bucket.store(0);
+    }
+
+    bool SemanticCache::lookup(uint64_t scope, const std::vector<float> &vector, std::string &response, float *similarity)
+    {
+        _lookups.fetch_add(1, std::memory_order_relaxed);
+        if (vector.size() != _dimension)
+        {
+            _misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::vector<float> query(vector);
+        vecmath::normalize(query.data(), query.size());
+
+        // 1. 读锁下取同一 scope 中最相似的一条
+        float best = -1.0f;
+        float threshold = 0.0f;
+        {
+            std::shared_lock<std::shared_mutex> lock(_mutex);
+            threshold = _options._threshold;
+            float distance = 0.0f;
+            uint32_t slot = 0;
+            if (nearestLocked(scope, query.data(), distance, slot))
+            {
+                best = 1.0f - distance;
+                if (best >= threshold)
+                {
+                    const Entry &entry = _entries[slot];
+                    response = entry._response;
+                    std::lock_guard<std::mutex> lruLock(_lruMutex);
+                    _lru.splice(_lru.begin(), _lru, entry._lru);
+                }
+            }
+        }
+
+        // 2. 统计命中质量
+        if (best < threshold)
+        {
+            _misses.fetch_add(1, std::memory_order_relaxed);
+            if (best >= threshold - _options._nearMissMargin)
+                _nearMisses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        _hits.fetch_add(1, std::memory_order_relaxed);
+        size_t bucket = best < 0.95f ? 0 : best < 0.98f ? 1 : best < 0.995f ? 2 : 3;
+        _hitBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(_similarityMutex);
+            _hitSimilaritySum += best;
+        }
+        if (similarity)
+            *similarity = best;
+        return true;
+    }
+
+    bool SemanticCache::nearestLocked(uint64_t scope, const float *vector, float &distance, uint32_t &slot) const
+    {
+        auto it = _scopeSlots.find(scope);
+        if (it == _scopeSlots.end())
+            return false;
+        const std::vector<uint32_t> &slots = it->second;
+
+        // 1. 条目少的 scope (多数对话上下文) 精确扫描，结果不受其他 scope 的条目数影响
+        if (slots.size() <= kScopeScanLimit)
+        {
+            distance = 2.0f;
+            for (uint32_t candidate : slots)
+            {
+                float d = 1.0f - vecmath::dot(vector, _index.vector(candidate), _dimension);
+                if (d < distance)
+                {
+                    distance = d;
+                    slot = candidate;
+                }
+            }
+            return true;
+        }
+
+        // 2. 条目多的 scope 走全局索引：前 k 个近邻都属于其他 scope 时加倍 k 重查，直到覆盖全部条目
+        for (size_t k = kSearchK;; k *= 2)
+        {
+            auto nearest = _index.search(vector, k, std::max(_options._efSearch, k));
+            for (const auto &candidate : nearest)
+            {
+                if (_entries[candidate.second]._scope == scope)
+                {
+                    distance = candidate.first;
+                    slot = candidate.second;
+                    return true;
+                }
+            }
+            if (nearest.size() < k || k >= _index.size())
+                return false;
+        }
+    }
+
+    void SemanticCache::insert(uint64_t scope, const std::vector<float> &vector, const std::string &query, const std::string &response)
+    {
+        if (vector.size() != _dimension)
+            return;
+        std::vector<float> normalized(vector);
+        vecmath::normalize(normalized.data(), normalized.size());
+
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        insertLocked(scope, normalized.data(), query, response);
+    }
+
+    void SemanticCache::insertLocked(uint64_t scope, const float *vector, const std::string &query, const std::string &response)
+    {
+        size_t bytes = query.size() + response.size();
+        if (bytes > _options._maxBytes)
+        {
+            DBG("SemanticCache: entry of {} bytes exceeds limit, skipped", bytes);
+            return;
+        }
+
+        // 1. 同一 scope 中已有几乎相同的问题 (并发未命中后各自写入)：只更新回复
+        float distance = 0.0f;
+        uint32_t existing = 0;
+        if (nearestLocked(scope, vector, distance, existing) && distance <= 1e-4f)
+        {
+            Entry &entry = _entries[existing];
+            _bytes = _bytes - entry._query.size() - entry._response.size() + bytes;
+            entry._query = query;
+            entry._response = response;
+            std::lock_guard<std::mutex> lruLock(_lruMutex);
+            _lru.splice(_lru.begin(), _lru, entry._lru);
+            while (_bytes > _options._maxBytes && _lru.size() > 1)
+            {
+                evictLocked();
+            }
+            return;
+        }
+
+        // 2. 超出条数或字节上限时淘汰最久未使用的条目，释放出的槽位优先复用
+        std::lock_guard<std::mutex> lruLock(_lruMutex);
+        while (!_lru.empty() && (_index.size() >= _options._capacity || _bytes + bytes > _options._maxBytes))
+        {
+            evictLocked();
+        }
+
+        uint32_t slot;
+        if (!_freeSlots.empty())
+        {
+            slot = _freeSlots.back();
+            _freeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<uint32_t>(_entries.size());
+            _entries.emplace_back();
+        }
+
+        // 3. 写入索引与条目
+        _index.add(slot, vector);
+        Entry &entry = _entries[slot];
+        entry._scope = scope;
+        entry._query = query;
+        entry._response = response;
+        std::vector<uint32_t> &scopeSlots = _scopeSlots[scope];
+        entry._scopePos = scopeSlots.size();
+        scopeSlots.push_back(slot);
+        _lru.push_front(slot);
+        entry._lru = _lru.begin();
+        _bytes += bytes;
+        _inserts.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void SemanticCache::evictLocked()
+    {
+        uint32_t slot = _lru.back();
+        _lru.pop_back();
+        Entry &entry = _entries[slot];
+        _bytes -= entry._query.size() + entry._response.size();
+
+        // 从所属 scope 的槽位表中移除 (末尾元素填补空位)
+        auto it = _scopeSlots.find(entry._scope);
+        std::vector<uint32_t> &scopeSlots = it->second;
+        uint32_t moved = scopeSlots.back();
+        scopeSlots[entry._scopePos] = moved;
+        _entries[moved]._scopePos = entry._scopePos;
+        scopeSlots.pop_back();
+        if (scopeSlots.empty())
+            _scopeSlots.erase(it);
+
+        std::string().swap(entry._query);
+        std::string().swap(entry._response);
+        _index.remove(slot);
+        _freeSlots.push_back(slot);
+        _evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void SemanticCache::clear()
+    {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        std::lock_guard<std::mutex> lruLock(_lruMutex);
+        _index = HnswIndex(_dimension, _options._capacity, _options._m, _options._efConstruction);
+        _entries.clear();
+        _freeSlots.clear();
+        _scopeSlots.clear();
+        _lru.clear();
+        _bytes = 0;
+    }
+
+    bool SemanticCache::save(const std::string &file, const std::string &embeddingName) const
+    {
+        // 先写临时文件再 rename，中途失败不会破坏已有快照
+        std::string tmpFile = file + ".tmp";
+        std::ofstream out(tmpFile, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            ERR("SemanticCache: cannot open snapshot file {}", tmpFile);
+            return false;
+        }
+
+        size_t count = 0;
+        {
+            std::shared_lock<std::shared_mutex> lock(_mutex);
+            std::lock_guard<std::mutex> lruLock(_lruMutex);
+
+            // 1. 文件头：魔数、维度、向量模型名称、条目数
+            out.write(kSnapshotMagic, sizeof(kSnapshotMagic));
+            writePod(out, static_cast<uint32_t>(_dimension));
+            writeString(out, embeddingName);
+            writePod(out, static_cast<uint64_t>(_lru.size()));
+
+            // 2. 条目从最久未使用到最近使用，加载时按顺序插入即可恢复 LRU 顺序
+            for (auto it = _lru.rbegin(); it != _lru.rend(); ++it)
+            {
+                const Entry &entry = _entries[*it];
+                writePod(out, entry._scope);
+                writeString(out, entry._query);
+                writeString(out, entry._response);
+                out.write(reinterpret_cast<const char *>(_index.vector(*it)), _dimension * sizeof(float));
+            }
+            count = _lru.size();
+        }
+
+        out.close();
+        if (!out || std::rename(tmpFile.c_str(), file.c_str()) != 0)
+        {
+            ERR("SemanticCache: failed to write snapshot {}", file);
+            std::remove(tmpFile.c_str());
+            return false;
+        }
+        INFO("SemanticCache: saved {} entries to {}", count, file);
+        return true;
+    }
+
+    bool SemanticCache::load(const std::string &file, const std::string &embeddingName)
+    {
+        std::ifstream in(file, std::ios::binary);
+        if (!in)
+        {
+            WARN("SemanticCache: snapshot {} not found", file);
+            return false;
+        }
+
+        // 1. 校验文件头
+        char magic[sizeof(kSnapshotMagic)];
+        uint32_t dimension = 0;
+        std::string name;
+        uint64_t count = 0;
+        if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kSnapshotMagic, sizeof(magic)) != 0 ||
+            !readPod(in, dimension) || !readString(in, name, 4096) || !readPod(in, count))
+        {
+            ERR("SemanticCache: invalid snapshot {}", file);
+            return false;
+        }
+        if (dimension != _dimension || name != embeddingName)
+        {
+            ERR("SemanticCache: snapshot {} was built with {} (dim {}), expected {} (dim {})",
+                file, name, dimension, embeddingName, _dimension);
+            return false;
+        }
+
+        // 单个字符串不会超过缓存的字节上限，也不会超过文件本身，损坏的长度字段不会触发巨量分配
+        std::streampos dataStart = in.tellg();
+        in.seekg(0, std::ios::end);
+        uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+        in.seekg(dataStart);
+        uint32_t maxString = static_cast<uint32_t>(std::min<uint64_t>({_options._maxBytes, fileSize, UINT32_MAX}));
+
+        // 2. 逐条重建索引；超出容量时由 LRU 淘汰最旧的条目
+        clear();
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        std::vector<float> vector(_dimension);
+        uint64_t loaded = 0;
+        for (; loaded < count; ++loaded)
+        {
+            uint64_t scope = 0;
+            std::string query;
+            std::string response;
+            if (!readPod(in, scope) || !readString(in, query, maxString) || !readString(in, response, maxString) ||
+                !in.read(reinterpret_cast<char *>(vector.data()), _dimension * sizeof(float)))
+            {
+                ERR("SemanticCache: snapshot {} truncated after {} entries", file, loaded);
+                break;
+            }
+            insertLocked(scope, vector.data(), query, response);
+        }
+        INFO("SemanticCache: loaded {} entries from {}", loaded, file);
+        return loaded == count;
+    }
+
+    SemanticCacheStats SemanticCache::stats() const
+    {
+        SemanticCacheStats stats;
+        stats._lookups = _lookups.load(std::memory_order_relaxed);
+        stats._hits = _hits.load(std::memory_order_relaxed);
+        stats._misses = _misses.load(std::memory_order_relaxed);
+        stats._nearMisses = _nearMisses.load(std::memory_order_relaxed);
+        stats._inserts = _inserts.load(std::memory_order_relaxed);
+        stats._evictions = _evictions.load(std::memory_order_relaxed);
+        stats._embedFailures = _embedFailures.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < 4; ++i)
+            stats._hitBuckets[i] = _hitBuckets[i].load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(_similarityMutex);
+            stats._hitSimilaritySum = _hitSimilaritySum;
+        }
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        stats._entries = _index.size();
+        stats._bytes = _bytes;
+        stats._indexBytes = _index.memoryBytes();
+        return stats;
+    }
+
+    void SemanticCache::setThreshold(float threshold)
+    {
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        _options._threshold = threshold;
+    }
+
+    float SemanticCache::threshold() const
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        return _options._threshold;
+    }
+
+    size_t SemanticCache::size() const
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        return _index.size();
+    }
+
+    // ---------------------------- SemanticCacheProvider ----------------------------
+
+    SemanticCacheProvider::SemanticCacheProvider(std::shared_ptr<LLMProvider> inner, EmbeddingProviderPtr embedding,
+                                                 const SemanticCacheOptions &options)
+        : _inner(std::move(inner)),
+          _embedding(std::move(embedding)),
+          _options(options),
+          _cache(new SemanticCache(_embedding ? _embedding->dimension() : 1, options))
+    {
+    }
+
+    bool SemanticCacheProvider::initModel(const std::map<std::string, std::string> &modelConfig)
+    {
+        // 1. 缓存相关配置
+        auto it = modelConfig.find("semantic_cache_threshold");
+        if (it != modelConfig.end())
+        {
+            try
+            {
+                // 只调整阈值，不重建缓存：请求可能正在并发使用它，已有条目也继续有效
+                _options._threshold = std::stof(it->second);
+                _cache->setThreshold(_options._threshold);
+            }
+            catch (...)
+            {
+                WARN("SemanticCacheProvider: invalid semantic_cache_threshold {}", it->second);
+            }
+        }
+        it = modelConfig.find("semantic_cache_snapshot");
+        if (it != modelConfig.end() && !it->second.empty())
+        {
+            loadSnapshot(it->second);
+        }
+
+        // 2. 初始化被包装的模型
+        _isAvailable = _inner && _embedding && _inner->initModel(modelConfig);
+        return _isAvailable;
+    }
+
+    bool SemanticCacheProvider::isAvailable() const
+    {
+        return _inner && _embedding && _inner->isAvailable();
+    }
+
+    std::string SemanticCacheProvider::getModelName() const
+    {
+        return _inner ? _inner->getModelName() : "";
+    }
+
+    std::string SemanticCacheProvider::getModelDesc() const
+    {
+        return _inner ? _inner->getModelDesc() : "";
+    }
+
+    bool SemanticCacheProvider::rotateApiKey(const std::string &apiKey)
+    {
+        return _inner && _inner->rotateApiKey(apiKey);
+    }
+
+    bool SemanticCacheProvider::saveSnapshot(const std::string &file) const
+    {
+        return _embedding && _cache->save(file, _embedding->name());
+    }
+
+    bool SemanticCacheProvider::loadSnapshot(const std::string &file)
+    {
+        return _embedding && _cache->load(file, _embedding->name());
+    }
+
+    bool SemanticCacheProvider::prepare(const std::vector<Message> &messages,
+                                        const std::map<std::string, std::string> &requestParam,
+                                        const CancelTokenPtr &cancelToken, uint64_t &scope, std::vector<float> &vector)
+    {
+        // 1. 只缓存以 user 消息结尾的请求；显式关闭或带随机性的请求不参与
+        // 最后一条消息是外部内容 (大文档) 时无法向量化，同样不参与
+        if (!_embedding || messages.empty() || messages.back()._role != "user" || messages.back()._contentSource)
+            return false;
+        auto it = requestParam.find("semantic_cache");
+        if (it != requestParam.end() && it->second == "false")
+            return false;
+        if (!_options._cacheSampled)
+        {
+            it = requestParam.find("temperature");
+            try
+            {
+                if (it == requestParam.end() || std::stod(it->second) > 0.0)
+                    return false;
+            }
+            catch (...)
+            {
+                return false;
+            }
+        }
+
+        // 2. scope：模型、之前的全部消息以及请求参数 (超时参数除外) 必须完全一致
+        uint64_t hash = fnv1a(1469598103934665603ULL, getModelName());
+        for (size_t i = 0; i + 1 < messages.size(); ++i)
+        {
+            hash = fnv1a(hash, messages[i]._role);
+            // 外部内容按标识参与，不读取文档本身
+            hash = fnv1a(hash, messages[i]._contentSource ? "@" + messages[i]._contentSource->identity() : messages[i]._content);
+        }
+        for (const auto &param : requestParam) // std::map 已按 key 排序
+        {
+            if (param.first == "semantic_cache" || isTimeoutParam(param.first))
+                continue;
+            hash = fnv1a(hash, param.first);
+            hash = fnv1a(hash, param.second);
+        }
+        scope = hash;
+
+        // 3. 最后一条 user 消息向量化，失败时直接访问模型
+        if (!_embedding->embed(messages.back()._content, vector, cancelToken))
+        {
+            _cache->recordEmbedFailure();
+            WARN("SemanticCacheProvider: embedding failed, bypassing cache");
+            return false;
+        }
+        return true;
+    }
+
+    std::string SemanticCacheProvider::sendMessage(const std::vector<Message> &messages,
+                                                   const std::map<std::string, std::string> &requestParam,
+                                                   CancelTokenPtr cancelToken,
+                                                   TokenUsage *usage)
+    {
+        uint64_t scope = 0;
+        std::vector<float> vector;
+        if (!prepare(messages, requestParam, cancelToken, scope, vector))
+            return _inner->sendMessage(messages, requestParam, cancelToken, usage);
+
+        // 1. 命中直接返回，不消耗 token
+        std::string response;
+        float similarity = 0.0f;
+        if (_cache->lookup(scope, vector, response, &similarity))
+        {
+            INFO("SemanticCacheProvider: cache hit, similarity: {:.4f}", similarity);
+            if (usage)
+                *usage = TokenUsage();
+            return response;
+        }
+
+        // 2. 未命中：访问模型并写入缓存 (失败、取消的结果不缓存)
+        response = _inner->sendMessage(messages, requestParam, cancelToken, usage);
+        if (!response.empty() && !(cancelToken && cancelToken->isCancelled()))
+        {
+            _cache->insert(scope, vector, messages.back()._content, response);
+        }
+        return response;
+    }
+
+    std::string SemanticCacheProvider::sendMessageStream(const std::vector<Message> &messages,
+                                                         const std::map<std::string, std::string> &requestParam,
+                                                         std::function<void(const std::string &, bool)> callback,
+                                                         CancelTokenPtr cancelToken,
+                                                         TokenUsage *usage)
+    {
+        uint64_t scope = 0;
+        std::vector<float> vector;
+        if (!prepare(messages, requestParam, cancelToken, scope, vector))
+            return _inner->sendMessageStream(messages, requestParam, callback, cancelToken, usage);
+
+        // 1. 命中：整段回复作为一个增量下发，随后发送结束标记
+        std::string response;
+        float similarity = 0.0f;
+        if (_cache->lookup(scope, vector, response, &similarity))
+        {
+            INFO("SemanticCacheProvider: cache hit (stream), similarity: {:.4f}", similarity);
+            if (usage)
+                *usage = TokenUsage();
+            if (callback)
+            {
+                callback(response, false);
+                callback("", true);
+            }
+            return response;
+        }
+
+        // 2. 未命中：透传增量，完整结束后写入缓存
+        bool finished = false;
+        auto wrapped = [&](const std::string &delta, bool last)
+        {
+            if (last)
+                finished = true;
+            if (callback)
+                callback(delta, last);
+        };
+        response = _inner->sendMessageStream(messages, requestParam, wrapped, cancelToken, usage);
+        if (finished && !response.empty() && !(cancelToken && cancelToken->isCancelled()))
+        {
+            _cache->insert(scope, vector, messages.back()._content, response);
+        }
+        return response;
+    }
+
+} // end ai_chat_sdk
@@ -0,0 +1,412 @@
+#include "../include/SingleFlightProvider.h"
+#include "../include/ContentSource.h"
+#include "../include/util/myLog.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <openssl/evp.h>
+#include <thread>
+#include <unordered_map>
+
+namespace ai_chat_sdk
+{
+    // 一次在途的上游调用
+    struct SingleFlightProvider::Flight
+    {
+        std::string _key;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::deque<std::string> _deltas; // 流式增量 (deque 追加时不会使已有元素的引用失效)
+        bool _done = false;
+        std::string _result;
+        TokenUsage _usage;
+        size_t _waiters = 0; // 尚未返回的调用方数
+        CancelTokenPtr _upstreamToken = std::make_shared<CancelToken>();
+    };
+
+    // 在途请求表：key -> Flight
+    // 一个 Flight 只要还在表中，就一定没有结束、也没有被全部调用方放弃
+    struct SingleFlightProvider::Group
+    {
+        std::mutex _mutex;
+        std::unordered_map<std::string, std::shared_ptr<Flight>> _flights; // key 为请求摘要
+
+        // 上游调用的工作线程：按需创建，最多 _maxThreads 个，超出的调用排队
+        std::mutex _queueMutex;
+        std::condition_variable _queueCond;
+        std::deque<std::function<void()>> _queue;
+        std::vector<std::thread> _workers;
+        size_t _maxThreads = 1;
+        size_t _idle = 0;
+        bool _stop = false;
+
+        void erase(const std::shared_ptr<Flight> &flight)
+        {
+            auto it = _flights.find(flight->_key);
+            if (it != _flights.end() && it->second == flight)
+                _flights.erase(it);
+        }
+
+        void submit(std::function<void()> task)
+        {
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            _queue.push_back(std::move(task));
+            if (_idle == 0 && _workers.size() < _maxThreads)
+                _workers.emplace_back([this]()
+                                      { workerLoop(); });
+            else
+                _queueCond.notify_one();
+        }
+
+        void workerLoop()
+        {
+            std::unique_lock<std::mutex> lock(_queueMutex);
+            while (true)
+            {
+                ++_idle;
+                _queueCond.wait(lock, [this]()
+                                { return _stop || !_queue.empty(); });
+                --_idle;
+                if (_queue.empty())
+                    return; // _stop
+                std::function<void()> task = std::move(_queue.front());
+                _queue.pop_front();
+                lock.unlock();
+                task();
+                lock.lock();
+            }
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_queueMutex);
+                _stop = true;
+                _queueCond.notify_all();
+            }
+            for (auto &worker : _workers)
+                worker.join();
+        }
+    };
+
+    namespace
+    {
+        // 请求摘要：按长度前缀逐字段喂给 SHA-256，避免 ("ab","c") 与 ("a","bc") 相同，
+        // 也不必为长对话拼出一份完整的请求文本；碰撞概率可以忽略，摘要相同即视为同一请求
+        class KeyDigest
+        {
+        public:
+            KeyDigest() : _ctx(EVP_MD_CTX_new()) { EVP_DigestInit_ex(_ctx, EVP_sha256(), nullptr); }
+            ~KeyDigest() { EVP_MD_CTX_free(_ctx); }
+            KeyDigest(const KeyDigest &) = delete;
+            KeyDigest &operator=(const KeyDigest &) = delete;
+
+            void add(const std::string &field)
+            {
+                uint64_t size = field.size();
+                EVP_DigestUpdate(_ctx, &size, sizeof(size));
+                EVP_DigestUpdate(_ctx, field.data(), field.size());
+            }
+            void add(char tag) { EVP_DigestUpdate(_ctx, &tag, 1); }
+
+            std::string finish()
+            {
+                unsigned char digest[EVP_MAX_MD_SIZE];
+                unsigned int len = 0;
+                EVP_DigestFinal_ex(_ctx, digest, &len);
+                return std::string(reinterpret_cast<const char *>(digest), len);
+            }
+
+        private:
+            EVP_MD_CTX *_ctx;
+        };
+
+        std::string makeKey(const std::string &model, const std::vector<Message> &messages,
+                            const std::map<std::string, std::string> &requestParam, bool stream)
+        {
+            KeyDigest digest;
+            digest.add(stream ? 'S' : 'F');
+            digest.add(model);
+            for (const auto &msg : messages)
+            {
+                digest.add(msg._role);
+                // 外部内容按标识比较，不读取文档本身
+                digest.add(msg._contentSource ? '@' : '=');
+                digest.add(msg._contentSource ? msg._contentSource->identity() : msg._content);
+            }
+            digest.add('|');
+            for (const auto &param : requestParam) // std::map 已按 key 排序
+            {
+                digest.add(param.first);
+                digest.add(param.second);
+            }
+            return digest.finish();
+        }
+    }
+
+    SingleFlightProvider::SingleFlightProvider(std::shared_ptr<LLMProvider> inner, const SingleFlightOptions &options)
+        : _inner(std::move(inner)), _options(options), _group(std::make_shared<Group>())
+    {
+        _group->_maxThreads = std::max<size_t>(1, _options._maxUpstreamThreads);
+    }
+
+    // 调用方都已返回，队列为空；等待正在收尾的工作线程退出
+    SingleFlightProvider::~SingleFlightProvider()
+    {
+        _group->stop();
+    }
+
+    bool SingleFlightProvider::initModel(const std::map<std::string, std::string> &modelConfig)
+    {
+        auto it = modelConfig.find("single_flight_sampled");
+        if (it != modelConfig.end())
+        {
+            _options._dedupSampled = it->second != "false";
+        }
+        it = modelConfig.find("single_flight_threads");
+        if (it != modelConfig.end())
+        {
+            // 工作线程按需创建，上限只能在没有线程时调整
+            std::lock_guard<std::mutex> lock(_group->_queueMutex);
+            try
+            {
+                _options._maxUpstreamThreads = std::stoul(it->second);
+            }
+            catch (...)
+            {
+                WARN("SingleFlightProvider: invalid single_flight_threads '{}'", it->second);
+            }
+            if (_group->_workers.empty())
+                _group->_maxThreads = std::max<size_t>(1, _options._maxUpstreamThreads);
+        }
+        _isAvailable = _inner && _inner->initModel(modelConfig);
+        return _isAvailable;
+    }
+
+    bool SingleFlightProvider::isAvailable() const
+    {
+        return _inner && _inner->isAvailable();
+    }
+
+    std::string SingleFlightProvider::getModelName() const
+    {
+        return _inner ? _inner->getModelName() : "";
+    }
+
+    std::string SingleFlightProvider::getModelDesc() const
+    {
+        return _inner ? _inner->getModelDesc() : "";
+    }
+
+    bool SingleFlightProvider::rotateApiKey(const std::string &apiKey)
+    {
+        return _inner && _inner->rotateApiKey(apiKey);
+    }
+
+    std::string SingleFlightProvider::sendMessage(const std::vector<Message> &messages,
+                                                  const std::map<std::string, std::string> &requestParam,
+                                                  CancelTokenPtr cancelToken,
+                                                  TokenUsage *usage)
+    {
+        return request(messages, requestParam, false, nullptr, cancelToken, usage);
+    }
+
+    std::string SingleFlightProvider::sendMessageStream(const std::vector<Message> &messages,
+                                                        const std::map<std::string, std::string> &requestParam,
+                                                        std::function<void(const std::string &, bool)> callback,
+                                                        CancelTokenPtr cancelToken,
+                                                        TokenUsage *usage)
+    {
+        return request(messages, requestParam, true, callback, cancelToken, usage);
+    }
+
+    SingleFlightProvider::Stats SingleFlightProvider::stats() const
+    {
+        Stats stats;
+        stats._upstreamCalls = _upstreamCalls.load(std::memory_order_relaxed);
+        stats._joined = _joined.load(std::memory_order_relaxed);
+        stats._bypassed = _bypassed.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    bool SingleFlightProvider::shouldDedup(const std::map<std::string, std::string> &requestParam) const
+    {
+        if (_options._dedupSampled)
+            return true;
+
+        // 未指定 temperature 时模型默认 0.7，同样视为带随机性
+        auto it = requestParam.find("temperature");
+        if (it == requestParam.end())
+            return false;
+        try
+        {
+            return std::stod(it->second) <= 0.0;
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+
+    std::string SingleFlightProvider::request(const std::vector<Message> &messages,
+                                              const std::map<std::string, std::string> &requestParam,
+                                              bool stream,
+                                              const std::function<void(const std::string &, bool)> &callback,
+                                              const CancelTokenPtr &cancelToken,
+                                              TokenUsage *usage)
+    {
+        if (!isAvailable())
+        {
+            ERR("SingleFlightProvider: Model is not available.");
+            if (stream && callback)
+                callback("", true);
+            return "";
+        }
+
+        // 1. 不参与合并的请求直接转发
+        if (!shouldDedup(requestParam))
+        {
+            _bypassed.fetch_add(1, std::memory_order_relaxed);
+            if (stream)
+                return _inner->sendMessageStream(messages, requestParam, callback, cancelToken, usage);
+            return _inner->sendMessage(messages, requestParam, cancelToken, usage);
+        }
+
+        // 2. 查找相同的在途请求，没有则新建并交给工作线程发起上游调用
+        std::string key = makeKey(_inner->getModelName(), messages, requestParam, stream);
+        std::shared_ptr<Flight> flight;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> groupLock(_group->_mutex);
+            auto it = _group->_flights.find(key);
+            if (it != _group->_flights.end())
+            {
+                flight = it->second;
+            }
+            else
+            {
+                flight = std::make_shared<Flight>();
+                flight->_key = std::move(key);
+                _group->_flights.emplace(flight->_key, flight);
+                leader = true;
+            }
+            std::lock_guard<std::mutex> flightLock(flight->_mutex);
+            ++flight->_waiters;
+        }
+
+        if (leader)
+        {
+            _upstreamCalls.fetch_add(1, std::memory_order_relaxed);
+            // 工作线程数有上限：突发的不同请求排队等待，而不是各开一个线程
+            // 排队期间所有调用方都已取消时，上游令牌已取消，inner 会立即返回
+            _group->submit([group = _group.get(), inner = _inner, flight, messages, requestParam, stream]()
+                        {
+                            TokenUsage upstreamUsage;
+                            std::string result;
+                            if (stream)
+                            {
+                                auto onDelta = [&flight](const std::string &delta, bool last)
+                                {
+                                    if (last)
+                                        return;
+                                    std::lock_guard<std::mutex> lock(flight->_mutex);
+                                    flight->_deltas.push_back(delta);
+                                    flight->_cond.notify_all();
+                                };
+                                result = inner->sendMessageStream(messages, requestParam, onDelta, flight->_upstreamToken, &upstreamUsage);
+                            }
+                            else
+                            {
+                                result = inner->sendMessage(messages, requestParam, flight->_upstreamToken, &upstreamUsage);
+                            }
+
+                            // 先移出在途表，之后到达的相同请求会发起新的上游调用
+                            {
+                                std::lock_guard<std::mutex> groupLock(group->_mutex);
+                                group->erase(flight);
+                            }
+                            std::lock_guard<std::mutex> lock(flight->_mutex);
+                            flight->_done = true;
+                            flight->_result = std::move(result);
+                            flight->_usage = upstreamUsage;
+                            flight->_cond.notify_all();
+                        });
+        }
+        else
+        {
+            _joined.fetch_add(1, std::memory_order_relaxed);
+            DBG("SingleFlightProvider: joined in-flight {} request", stream ? "stream" : "full");
+        }
+
+        // 3. 等待结果；流式请求按顺序转发增量 (后到的调用方从第一个增量开始补发)
+        // 取消回调只负责唤醒，不能在持有 flight 锁时构造 / 析构守卫
+        CancelHookGuard hookGuard(cancelToken, [flight]()
+                                  {
+                                      std::lock_guard<std::mutex> lock(flight->_mutex);
+                                      flight->_cond.notify_all();
+                                  });
+
+        size_t next = 0;
+        std::string received; // 已转发的增量，取消时作为部分结果返回
+        bool cancelled = false;
+        std::string result;
+        {
+            std::unique_lock<std::mutex> lock(flight->_mutex);
+            while (true)
+            {
+                flight->_cond.wait(lock, [&]()
+                                   { return next < flight->_deltas.size() || flight->_done ||
+                                            (cancelToken && cancelToken->isCancelled()); });
+                if (cancelToken && cancelToken->isCancelled())
+                {
+                    cancelled = true;
+                    break;
+                }
+                while (next < flight->_deltas.size())
+                {
+                    const std::string &delta = flight->_deltas[next++];
+                    lock.unlock();
+                    received += delta;
+                    if (callback)
+                        callback(delta, false);
+                    lock.lock();
+                }
+                if (flight->_done && next == flight->_deltas.size())
+                {
+                    result = flight->_result;
+                    if (usage)
+                        *usage = flight->_usage;
+                    --flight->_waiters;
+                    break;
+                }
+            }
+        }
+
+        // 4. 取消：只有最后一个调用方离开时才取消上游
+        if (cancelled)
+        {
+            bool abandon = false;
+            {
+                std::lock_guard<std::mutex> groupLock(_group->_mutex);
+                std::lock_guard<std::mutex> flightLock(flight->_mutex);
+                abandon = --flight->_waiters == 0 && !flight->_done;
+                if (abandon)
+                    _group->erase(flight);
+            }
+            if (abandon)
+                flight->_upstreamToken->cancel();
+
+            WARN("SingleFlightProvider: Request cancelled, received {} bytes.", received.size());
+            CancelToken::recordCancelledRequest();
+            if (usage)
+                *usage = TokenUsage();
+            result = stream ? received : "";
+        }
+
+        if (stream && callback)
+            callback("", true);
+        return result;
+    }
+
+} // end ai_chat_sdk
@@ -0,0 +1,339 @@
+#include "../../include/transport/EventLoop.h"
+#include "../../include/util/myLog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        // 当前线程正在运行的事件循环
+        thread_local EventLoop *t_currentLoop = nullptr;
+    }
+
+    TimerWheel::TimerWheel(uint32_t tickMs, size_t slotCount)
+        : _tickMs(tickMs == 0 ? 1 : tickMs), _slots(slotCount == 0 ? 1 : slotCount)
+    {
+    }
+
+    TimerWheel::TimerId TimerWheel::add(uint32_t delayMs, std::function<void()> fn)
+    {
+        // 至少等待一个 tick，保证不会在当前 advance 中触发
+        uint64_t ticks = (delayMs + _tickMs - 1) / _tickMs;
+        if (ticks == 0)
+            ticks = 1;
+
+        size_t slot = (_currentTick + ticks) % _slots.size();
+        TimerId id = _nextId++;
+        auto &list = _slots[slot];
+        list.push_back(Timer{id, (ticks - 1) / _slots.size(), std::move(fn)});
+        _index[id] = {slot, std::prev(list.end())};
+        return id;
+    }
+
+    void TimerWheel::cancel(TimerId id)
+    {
+        auto it = _index.find(id);
+        if (it != _index.end())
+        {
+            _slots[it->second.first].erase(it->second.second);
+            _index.erase(it);
+            return;
+        }
+        _firing.erase(id);
+    }
+
+    void TimerWheel::advance(int64_t nowMs)
+    {
+        if (_startMs < 0)
+            _startMs = nowMs;
+        uint64_t targetTick = static_cast<uint64_t>(nowMs - _startMs) / _tickMs;
+        if (_index.empty())
+        {
+            // 没有定时器时直接跳到当前 tick，避免空转
+            _currentTick = std::max(_currentTick, targetTick);
+            return;
+        }
+
+        std::vector<std::pair<TimerId, std::function<void()>>> due;
+        while (_currentTick < targetTick)
+        {
+            ++_currentTick;
+            auto &list = _slots[_currentTick % _slots.size()];
+            for (auto it = list.begin(); it != list.end();)
+            {
+                if (it->_rounds > 0)
+                {
+                    --it->_rounds;
+                    ++it;
+                    continue;
+                }
+                due.emplace_back(it->_id, std::move(it->_fn));
+                _firing.insert(it->_id);
+                _index.erase(it->_id);
+                it = list.erase(it);
+            }
+        }
+
+        // 回调中可能取消同一批到期的其它定时器，执行前再确认一次
+        for (auto &timer : due)
+        {
+            if (_firing.erase(timer.first) > 0)
+                timer.second();
+        }
+    }
+
+    int TimerWheel::nextTimeoutMs(int64_t nowMs) const
+    {
+        if (_index.empty())
+            return -1;
+        if (_startMs < 0)
+            return static_cast<int>(_tickMs);
+        int64_t nextTickMs = _startMs + static_cast<int64_t>(_currentTick + 1) * _tickMs;
+        return nextTickMs > nowMs ? static_cast<int>(nextTickMs - nowMs) : 0;
+    }
+
+    EventLoop::EventLoop()
+    {
+        _epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        _wakeupFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_epollFd < 0 || _wakeupFd < 0)
+        {
+            ERR("EventLoop: create epoll / eventfd failed: {}", std::strerror(errno));
+            return;
+        }
+
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = 0; // generation 0 保留给 wakeup fd
+        ::epoll_ctl(_epollFd, EPOLL_CTL_ADD, _wakeupFd, &ev);
+    }
+
+    EventLoop::~EventLoop()
+    {
+        stop();
+        if (_wakeupFd >= 0)
+            ::close(_wakeupFd);
+        if (_epollFd >= 0)
+            ::close(_epollFd);
+    }
+
+    void EventLoop::start()
+    {
+        if (_running.exchange(true))
+            return;
+        _thread = std::thread([this]()
+                              { run(); });
+    }
+
+    void EventLoop::stop()
+    {
+        if (!_running.exchange(false))
+            return;
+        wakeup();
+        if (inLoopThread())
+            _thread.detach(); // 在循环自身的回调中停止，不能 join 自己
+        else if (_thread.joinable())
+            _thread.join();
+    }
+
+    bool EventLoop::inLoopThread() const
+    {
+        return t_currentLoop == this;
+    }
+
+    EventLoop *EventLoop::current()
+    {
+        return t_currentLoop;
+    }
+
+    void EventLoop::post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending.push_back(std::move(task));
+        }
+        wakeup();
+    }
+
+    void EventLoop::wakeup()
+    {
+        uint64_t one = 1;
+        ssize_t ret = ::write(_wakeupFd, &one, sizeof(one));
+        (void)ret;
+    }
+
+    bool EventLoop::addFd(int fd, uint32_t events, IoHandler handler)
+    {
+        uint32_t generation = _nextGeneration++;
+        if (_nextGeneration == 0)
+            _nextGeneration = 1;
+
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = events;
+        ev.data.u64 = (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+        if (::epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &ev) != 0)
+        {
+            ERR("EventLoop: epoll_ctl add fd {} failed: {}", fd, std::strerror(errno));
+            return false;
+        }
+        _fds[fd] = FdEntry{generation, std::make_shared<IoHandler>(std::move(handler))};
+        _fdCount.store(_fds.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    bool EventLoop::modifyFd(int fd, uint32_t events)
+    {
+        auto it = _fds.find(fd);
+        if (it == _fds.end())
+            return false;
+
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = events;
+        ev.data.u64 = (static_cast<uint64_t>(it->second._generation) << 32) | static_cast<uint32_t>(fd);
+        return ::epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &ev) == 0;
+    }
+
+    void EventLoop::removeFd(int fd)
+    {
+        if (_fds.erase(fd) > 0)
+        {
+            ::epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            _fdCount.store(_fds.size(), std::memory_order_relaxed);
+        }
+    }
+
+    TimerWheel::TimerId EventLoop::runAfter(uint32_t delayMs, std::function<void()> fn)
+    {
+        if (_timers.size() == 0)
+            _timers.advance(nowMs()); // 时间轮空闲期间不推进，添加前先对齐当前时间
+        return _timers.add(delayMs, std::move(fn));
+    }
+
+    void EventLoop::cancelTimer(TimerWheel::TimerId id)
+    {
+        _timers.cancel(id);
+    }
+
+    int64_t EventLoop::nowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void EventLoop::runPending()
+    {
+        std::vector<std::function<void()>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            tasks.swap(_pending);
+        }
+        for (auto &task : tasks)
+        {
+            task();
+        }
+    }
+
+    void EventLoop::run()
+    {
+        t_currentLoop = this;
+        std::vector<epoll_event> events(256);
+
+        while (_running)
+        {
+            int timeout = _timers.nextTimeoutMs(nowMs());
+            int n = ::epoll_wait(_epollFd, events.data(), static_cast<int>(events.size()), timeout);
+            if (n < 0 && errno != EINTR)
+            {
+                ERR("EventLoop: epoll_wait failed: {}", std::strerror(errno));
+                break;
+            }
+
+            for (int i = 0; i < n; ++i)
+            {
+                uint64_t data = events[i].data.u64;
+                uint32_t generation = static_cast<uint32_t>(data >> 32);
+                if (generation == 0)
+                {
+                    uint64_t value;
+                    while (::read(_wakeupFd, &value, sizeof(value)) > 0)
+                    {
+                    }
+                    continue;
+                }
+
+                // 同一批事件中 fd 可能已被前面的回调注销甚至复用
+                int fd = static_cast<int>(static_cast<uint32_t>(data));
+                auto it = _fds.find(fd);
+                if (it == _fds.end() || it->second._generation != generation)
+                    continue;
+                auto handler = it->second._handler; // 回调内可能注销自身
+                (*handler)(events[i].events);
+            }
+
+            runPending();
+            _timers.advance(nowMs());
+
+            if (n == static_cast<int>(events.size()))
+                events.resize(events.size() * 2);
+        }
+
+        // 退出前执行剩余任务，让等待中的请求得到完成通知
+        runPending();
+        t_currentLoop = nullptr;
+    }
+
+    EventLoopPool &EventLoopPool::shared(size_t threadCount)
+    {
+        static std::mutex mutex;
+        static EventLoopPool *pool = nullptr;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pool == nullptr)
+        {
+            pool = new EventLoopPool(threadCount);
+            std::atexit([]()
+                        { pool->stop(); });
+        }
+        return *pool;
+    }
+
+    EventLoopPool::EventLoopPool(size_t threadCount)
+    {
+        if (threadCount == 0)
+            threadCount = 1;
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            _loops.emplace_back(new EventLoop());
+            _loops.back()->start();
+        }
+        INFO("EventLoopPool started with {} threads", threadCount);
+    }
+
+    EventLoopPool::~EventLoopPool()
+    {
+        stop();
+    }
+
+    void EventLoopPool::stop()
+    {
+        for (auto &loop : _loops)
+        {
+            loop->stop();
+        }
+    }
+
+    EventLoop &EventLoopPool::next()
+    {
+        return *_loops[_next.fetch_add(1, std::memory_order_relaxed) % _loops.size()];
+    }
+
+} // end ai_chat_sdk
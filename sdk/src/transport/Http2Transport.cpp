@@ -0,0 +1,918 @@
+#ifdef CHATSDK_WITH_NGHTTP2
+
+#include "../../include/transport/Http2Transport.h"
+#include "../../include/transport/StreamingBody.h"
+#include "../../include/util/myLog.h"
+#include <nghttp2/nghttp2.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        // 单个流在调用线程与 I/O 线程之间共享的状态，由 _mutex 保护
+        struct StreamState
+        {
+            std::mutex _mutex;
+            std::condition_variable _cond;
+
+            int32_t _streamId = -1;
+            int _status = 0;
+            std::deque<std::string> _chunks; // 已收到、尚未交给调用方的数据
+            bool _closed = false;
+            bool _cancelled = false;
+            uint32_t _errorCode = 0; // RST_STREAM / GOAWAY 错误码
+            std::string _error;      // 连接级错误描述
+
+            // 请求部分，只在 I/O 线程读取
+            std::string _method;
+            std::string _path;
+            std::vector<std::pair<std::string, std::string>> _headers;
+            std::string _body;
+            size_t _bodyOffset = 0;
+            std::unique_ptr<StreamingBody::Reader> _bodyReader; // 流式请求体，按流控窗口逐帧读取
+        };
+
+        using StreamPtr = std::shared_ptr<StreamState>;
+
+        // 调用线程发给 I/O 线程的命令
+        struct Command
+        {
+            enum Type
+            {
+                Submit,  // 提交新请求
+                Consume, // 调用方已处理完 _bytes 字节，归还流控窗口
+                Cancel   // 取消流 (RST_STREAM)
+            };
+            Type _type;
+            StreamPtr _stream;
+            size_t _bytes = 0;
+        };
+
+        std::string lowerCase(std::string text)
+        {
+            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c)
+                           { return static_cast<char>(std::tolower(c)); });
+            return text;
+        }
+
+        nghttp2_nv makeNv(const std::string &name, const std::string &value)
+        {
+            nghttp2_nv nv;
+            nv.name = reinterpret_cast<uint8_t *>(const_cast<char *>(name.data()));
+            nv.value = reinterpret_cast<uint8_t *>(const_cast<char *>(value.data()));
+            nv.namelen = name.size();
+            nv.valuelen = value.size();
+            nv.flags = NGHTTP2_NV_FLAG_NONE;
+            return nv;
+        }
+
+        // 只取一次错误码：队列为空时 ERR_reason_error_string 返回 NULL
+        std::string sslErrorString()
+        {
+            unsigned long code = ERR_get_error();
+            const char *reason = code ? ERR_reason_error_string(code) : nullptr;
+            return reason ? reason : "unknown";
+        }
+
+        // 一条 HTTP/2 连接：一个 socket、一个 nghttp2 会话、一个 I/O 线程
+        class Connection
+        {
+        public:
+            Connection(const HttpEndpoint &endpoint, const TransportOptions &options, SSL_CTX *sslCtx)
+                : _endpoint(endpoint), _options(options), _sslCtx(sslCtx)
+            {
+            }
+
+            ~Connection()
+            {
+                _stopping = true;
+                wakeup();
+                if (_thread.joinable())
+                    _thread.join();
+                if (_session)
+                    nghttp2_session_del(_session);
+                if (_ssl)
+                    SSL_free(_ssl);
+                if (_fd >= 0)
+                    ::close(_fd);
+                if (_eventFd >= 0)
+                    ::close(_eventFd);
+            }
+
+            // 建立 TCP / TLS 连接，创建会话并启动 I/O 线程
+            bool connect(int timeoutSec, std::string &error)
+            {
+                if (!connectTcp(timeoutSec, error))
+                    return false;
+                if (_endpoint._tls && !handshakeTls(timeoutSec, error))
+                    return false;
+                if (!createSession(error))
+                    return false;
+
+                _eventFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                if (_eventFd < 0)
+                {
+                    error = "eventfd failed";
+                    return false;
+                }
+                _alive = true;
+                _thread = std::thread([this]()
+                                      { run(); });
+                return true;
+            }
+
+            bool usable() const { return _alive && !_goaway; }
+
+            // 调用方预留 / 释放一个流的名额，用于选择负载最低的连接
+            uint32_t reserved() const { return _reserved.load(); }
+            void reserve() { ++_reserved; }
+            void release() { --_reserved; }
+
+            uint32_t maxStreams() const
+            {
+                return std::min(_options._maxStreamsPerConnection, _remoteMaxStreams.load());
+            }
+
+            // 连接已断开 (I/O 线程已执行 failAll) 时不再入队：Submit 立即失败，其它命令丢弃
+            void post(Command command)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_commandMutex);
+                    if (_alive)
+                    {
+                        _commands.push_back(std::move(command));
+                    }
+                    else
+                    {
+                        if (command._type == Command::Submit)
+                        {
+                            StreamState &stream = *command._stream;
+                            std::lock_guard<std::mutex> streamLock(stream._mutex);
+                            stream._closed = true;
+                            stream._error = _closeError.empty() ? "connection closed" : _closeError;
+                            stream._cond.notify_all();
+                        }
+                        return;
+                    }
+                }
+                wakeup();
+            }
+
+        private:
+            void wakeup()
+            {
+                if (_eventFd >= 0)
+                {
+                    uint64_t one = 1;
+                    ssize_t ret = ::write(_eventFd, &one, sizeof(one));
+                    (void)ret;
+                }
+            }
+
+            bool connectTcp(int timeoutSec, std::string &error)
+            {
+                addrinfo hints;
+                std::memset(&hints, 0, sizeof(hints));
+                hints.ai_family = AF_UNSPEC;
+                hints.ai_socktype = SOCK_STREAM;
+                addrinfo *result = nullptr;
+                std::string port = std::to_string(_endpoint._port);
+                if (::getaddrinfo(_endpoint._host.c_str(), port.c_str(), &hints, &result) != 0)
+                {
+                    error = "resolve " + _endpoint._host + " failed";
+                    return false;
+                }
+
+                for (addrinfo *ai = result; ai != nullptr; ai = ai->ai_next)
+                {
+                    int fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+                    if (fd < 0)
+                        continue;
+
+                    int ret = ::connect(fd, ai->ai_addr, ai->ai_addrlen);
+                    if (ret != 0 && errno == EINPROGRESS)
+                    {
+                        // 非阻塞 connect，用 poll 控制连接超时
+                        pollfd pfd{fd, POLLOUT, 0};
+                        if (::poll(&pfd, 1, timeoutSec * 1000) == 1)
+                        {
+                            int soError = 0;
+                            socklen_t len = sizeof(soError);
+                            ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &soError, &len);
+                            ret = soError == 0 ? 0 : -1;
+                        }
+                    }
+                    if (ret == 0)
+                    {
+                        int one = 1;
+                        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                        _fd = fd;
+                        break;
+                    }
+                    ::close(fd);
+                }
+                ::freeaddrinfo(result);
+
+                if (_fd < 0)
+                {
+                    error = "connect " + _endpoint._authority + " failed";
+                    return false;
+                }
+                return true;
+            }
+
+            bool handshakeTls(int timeoutSec, std::string &error)
+            {
+                _ssl = SSL_new(_sslCtx);
+                SSL_set_fd(_ssl, _fd);
+                SSL_set_tlsext_host_name(_ssl, _endpoint._host.c_str());
+                X509_VERIFY_PARAM_set1_host(SSL_get0_param(_ssl), _endpoint._host.c_str(), 0);
+                SSL_set_mode(_ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSec);
+                while (true)
+                {
+                    int ret = SSL_connect(_ssl);
+                    if (ret == 1)
+                        break;
+
+                    int sslError = SSL_get_error(_ssl, ret);
+                    short events = 0;
+                    if (sslError == SSL_ERROR_WANT_READ)
+                        events = POLLIN;
+                    else if (sslError == SSL_ERROR_WANT_WRITE)
+                        events = POLLOUT;
+                    else
+                    {
+                        error = "TLS handshake failed: " + sslErrorString();
+                        return false;
+                    }
+
+                    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                    pollfd pfd{_fd, events, 0};
+                    if (left <= 0 || ::poll(&pfd, 1, static_cast<int>(left)) != 1)
+                    {
+                        error = "TLS handshake timeout";
+                        return false;
+                    }
+                }
+
+                // 服务端必须通过 ALPN 选择 h2
+                const unsigned char *alpn = nullptr;
+                unsigned int alpnLen = 0;
+                SSL_get0_alpn_selected(_ssl, &alpn, &alpnLen);
+                if (alpnLen != 2 || std::memcmp(alpn, "h2", 2) != 0)
+                {
+                    error = "server did not negotiate h2 via ALPN";
+                    return false;
+                }
+                return true;
+            }
+
+            bool createSession(std::string &error)
+            {
+                nghttp2_session_callbacks *callbacks = nullptr;
+                nghttp2_session_callbacks_new(&callbacks);
+                nghttp2_session_callbacks_set_on_header_callback(callbacks, onHeader);
+                nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, onFrameRecv);
+                nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, onDataChunkRecv);
+                nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, onStreamClose);
+
+                // 关闭自动 WINDOW_UPDATE，由调用方消费数据后再归还窗口 (逐流流控)
+                nghttp2_option *option = nullptr;
+                nghttp2_option_new(&option);
+                nghttp2_option_set_no_auto_window_update(option, 1);
+
+                int ret = nghttp2_session_client_new2(&_session, callbacks, this, option);
+                nghttp2_option_del(option);
+                nghttp2_session_callbacks_del(callbacks);
+                if (ret != 0)
+                {
+                    error = std::string("nghttp2_session_client_new2: ") + nghttp2_strerror(ret);
+                    return false;
+                }
+
+                nghttp2_settings_entry settings[] = {
+                    {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, _options._maxStreamsPerConnection},
+                    {NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, _options._streamWindowSize}};
+                nghttp2_submit_settings(_session, NGHTTP2_FLAG_NONE, settings, 2);
+
+                // 连接级窗口按 "单流窗口 x 最大并发流" 放大，避免连接窗口先于流窗口耗尽
+                int32_t connectionWindow = static_cast<int32_t>(std::min<uint64_t>(
+                    static_cast<uint64_t>(_options._streamWindowSize) * _options._maxStreamsPerConnection, (1u << 31) - 1));
+                nghttp2_session_set_local_window_size(_session, NGHTTP2_FLAG_NONE, 0, connectionWindow);
+                return true;
+            }
+
+            // I/O 线程主循环
+            void run()
+            {
+                std::string error;
+                while (!_stopping)
+                {
+                    processCommands();
+                    if (!flushOutput(error))
+                        break;
+                    if (!nghttp2_session_want_read(_session) && !nghttp2_session_want_write(_session) && _out.empty())
+                    {
+                        error = "session finished";
+                        break;
+                    }
+
+                    pollfd fds[2];
+                    fds[0] = {_fd, static_cast<short>(POLLIN | (_out.empty() ? 0 : POLLOUT)), 0};
+                    fds[1] = {_eventFd, POLLIN, 0};
+                    // TLS 层可能还缓存着已解密的数据，此时不能阻塞在 poll 上
+                    int timeout = (_ssl && SSL_pending(_ssl) > 0) ? 0 : 1000;
+                    if (::poll(fds, 2, timeout) < 0 && errno != EINTR)
+                    {
+                        error = "poll failed";
+                        break;
+                    }
+
+                    if (fds[1].revents & POLLIN)
+                    {
+                        uint64_t value;
+                        while (::read(_eventFd, &value, sizeof(value)) > 0)
+                        {
+                        }
+                    }
+                    if ((fds[0].revents & (POLLIN | POLLHUP | POLLERR)) || (_ssl && SSL_pending(_ssl) > 0))
+                    {
+                        if (!readInput(error))
+                            break;
+                    }
+                }
+
+                _alive = false;
+                failAll(error.empty() ? "connection closed" : error);
+            }
+
+            // 从 socket 读取并交给 nghttp2 解析
+            bool readInput(std::string &error)
+            {
+                char buf[16384];
+                while (true)
+                {
+                    ssize_t n = 0;
+                    if (_ssl)
+                    {
+                        int ret = SSL_read(_ssl, buf, sizeof(buf));
+                        if (ret <= 0)
+                        {
+                            int sslError = SSL_get_error(_ssl, ret);
+                            if (sslError == SSL_ERROR_WANT_READ || sslError == SSL_ERROR_WANT_WRITE)
+                                return true;
+                            error = sslError == SSL_ERROR_ZERO_RETURN ? "peer closed" : "TLS read failed";
+                            return false;
+                        }
+                        n = ret;
+                    }
+                    else
+                    {
+                        n = ::recv(_fd, buf, sizeof(buf), 0);
+                        if (n < 0)
+                        {
+                            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                                return true;
+                            error = std::string("recv failed: ") + std::strerror(errno);
+                            return false;
+                        }
+                        if (n == 0)
+                        {
+                            error = "peer closed";
+                            return false;
+                        }
+                    }
+
+                    ssize_t ret = nghttp2_session_mem_recv(_session, reinterpret_cast<const uint8_t *>(buf), static_cast<size_t>(n));
+                    if (ret < 0)
+                    {
+                        error = std::string("nghttp2_session_mem_recv: ") + nghttp2_strerror(static_cast<int>(ret));
+                        return false;
+                    }
+                }
+            }
+
+            // 把 nghttp2 待发送的帧写入 socket，写不完的留到 POLLOUT
+            bool flushOutput(std::string &error)
+            {
+                while (true)
+                {
+                    if (_out.empty())
+                    {
+                        const uint8_t *data = nullptr;
+                        ssize_t len;
+                        while (_out.size() < 65536 && (len = nghttp2_session_mem_send(_session, &data)) > 0)
+                        {
+                            _out.append(reinterpret_cast<const char *>(data), static_cast<size_t>(len));
+                        }
+                        if (_out.empty())
+                            return true;
+                    }
+
+                    ssize_t n = 0;
+                    if (_ssl)
+                    {
+                        int ret = SSL_write(_ssl, _out.data(), static_cast<int>(_out.size()));
+                        if (ret <= 0)
+                        {
+                            int sslError = SSL_get_error(_ssl, ret);
+                            if (sslError == SSL_ERROR_WANT_READ || sslError == SSL_ERROR_WANT_WRITE)
+                                return true;
+                            error = "TLS write failed";
+                            return false;
+                        }
+                        n = ret;
+                    }
+                    else
+                    {
+                        n = ::send(_fd, _out.data(), _out.size(), MSG_NOSIGNAL);
+                        if (n < 0)
+                        {
+                            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                                return true;
+                            error = std::string("send failed: ") + std::strerror(errno);
+                            return false;
+                        }
+                    }
+                    _out.erase(0, static_cast<size_t>(n));
+                }
+            }
+
+            void processCommands()
+            {
+                std::deque<Command> commands;
+                {
+                    std::lock_guard<std::mutex> lock(_commandMutex);
+                    commands.swap(_commands);
+                }
+
+                for (auto &command : commands)
+                {
+                    StreamState &stream = *command._stream;
+                    switch (command._type)
+                    {
+                    case Command::Submit:
+                        submit(command._stream);
+                        break;
+                    case Command::Consume:
+                        nghttp2_session_consume(_session, stream._streamId, command._bytes);
+                        break;
+                    case Command::Cancel:
+                    {
+                        size_t pending = 0;
+                        {
+                            std::lock_guard<std::mutex> lock(stream._mutex);
+                            for (const auto &chunk : stream._chunks)
+                                pending += chunk.size();
+                            stream._chunks.clear();
+                        }
+                        if (stream._streamId > 0)
+                        {
+                            // 归还调用方不再读取的数据占用的窗口，再结束该流
+                            if (pending > 0)
+                                nghttp2_session_consume(_session, stream._streamId, pending);
+                            nghttp2_submit_rst_stream(_session, NGHTTP2_FLAG_NONE, stream._streamId, NGHTTP2_CANCEL);
+                        }
+                        break;
+                    }
+                    }
+                }
+            }
+
+            void submit(const StreamPtr &stream)
+            {
+                std::vector<nghttp2_nv> nva;
+                const std::string scheme = _endpoint._tls ? "https" : "http";
+                nva.push_back(makeNv(":method", stream->_method));
+                nva.push_back(makeNv(":scheme", scheme));
+                nva.push_back(makeNv(":authority", _endpoint._authority));
+                nva.push_back(makeNv(":path", stream->_path));
+                for (const auto &header : stream->_headers)
+                {
+                    nva.push_back(makeNv(header.first, header.second));
+                }
+
+                nghttp2_data_provider provider;
+                provider.source.ptr = stream.get();
+                provider.read_callback = onReadBody;
+
+                int32_t streamId = nghttp2_submit_request(_session, nullptr, nva.data(), nva.size(),
+                                                          stream->_body.empty() && !stream->_bodyReader ? nullptr : &provider, stream.get());
+                std::lock_guard<std::mutex> lock(stream->_mutex);
+                if (streamId < 0)
+                {
+                    stream->_closed = true;
+                    stream->_error = std::string("nghttp2_submit_request: ") + nghttp2_strerror(streamId);
+                    stream->_cond.notify_all();
+                    return;
+                }
+                stream->_streamId = streamId;
+                _streams[streamId] = stream;
+            }
+
+            // 连接断开：所有未结束的流以错误结束
+            void failAll(const std::string &error)
+            {
+                for (auto &item : _streams)
+                {
+                    StreamState &stream = *item.second;
+                    std::lock_guard<std::mutex> lock(stream._mutex);
+                    if (!stream._closed)
+                    {
+                        stream._closed = true;
+                        stream._error = error;
+                        stream._cond.notify_all();
+                    }
+                }
+                _streams.clear();
+
+                // 尚未提交的请求同样失败；_alive 已为 false，此后 post 的请求直接失败
+                std::lock_guard<std::mutex> lock(_commandMutex);
+                _closeError = error;
+                for (auto &command : _commands)
+                {
+                    if (command._type != Command::Submit)
+                        continue;
+                    std::lock_guard<std::mutex> streamLock(command._stream->_mutex);
+                    command._stream->_closed = true;
+                    command._stream->_error = error;
+                    command._stream->_cond.notify_all();
+                }
+                _commands.clear();
+            }
+
+            static ssize_t onReadBody(nghttp2_session * /*session*/, int32_t /*streamId*/, uint8_t *buf, size_t length,
+                                      uint32_t *dataFlags, nghttp2_data_source *source, void * /*userData*/)
+            {
+                StreamState *stream = static_cast<StreamState *>(source->ptr);
+                if (stream->_bodyReader)
+                {
+                    // 读取失败时 nghttp2 以 RST_STREAM 结束该流，连接上的其他流不受影响
+                    ssize_t got = stream->_bodyReader->read(reinterpret_cast<char *>(buf), length);
+                    if (got < 0)
+                        return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+                    if (got == 0)
+                    {
+                        *dataFlags |= NGHTTP2_DATA_FLAG_EOF;
+                        stream->_bodyReader.reset();
+                    }
+                    return got;
+                }
+                size_t n = std::min(length, stream->_body.size() - stream->_bodyOffset);
+                std::memcpy(buf, stream->_body.data() + stream->_bodyOffset, n);
+                stream->_bodyOffset += n;
+                if (stream->_bodyOffset == stream->_body.size())
+                    *dataFlags |= NGHTTP2_DATA_FLAG_EOF;
+                return static_cast<ssize_t>(n);
+            }
+
+            static int onHeader(nghttp2_session *session, const nghttp2_frame *frame, const uint8_t *name, size_t namelen,
+                                const uint8_t *value, size_t valuelen, uint8_t /*flags*/, void * /*userData*/)
+            {
+                if (frame->hd.type != NGHTTP2_HEADERS || frame->headers.cat != NGHTTP2_HCAT_RESPONSE)
+                    return 0;
+                auto *stream = static_cast<StreamState *>(nghttp2_session_get_stream_user_data(session, frame->hd.stream_id));
+                if (stream && namelen == 7 && std::memcmp(name, ":status", 7) == 0)
+                {
+                    std::lock_guard<std::mutex> lock(stream->_mutex);
+                    stream->_status = std::atoi(std::string(reinterpret_cast<const char *>(value), valuelen).c_str());
+                    stream->_cond.notify_all();
+                }
+                return 0;
+            }
+
+            static int onFrameRecv(nghttp2_session *session, const nghttp2_frame *frame, void *userData)
+            {
+                Connection *conn = static_cast<Connection *>(userData);
+                if (frame->hd.type == NGHTTP2_SETTINGS)
+                {
+                    conn->_remoteMaxStreams = nghttp2_session_get_remote_settings(session, NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS);
+                }
+                else if (frame->hd.type == NGHTTP2_GOAWAY)
+                {
+                    // 不再在该连接上发起新请求，已有的流继续完成
+                    conn->_goaway = true;
+                }
+                return 0;
+            }
+
+            static int onDataChunkRecv(nghttp2_session *session, uint8_t /*flags*/, int32_t streamId,
+                                       const uint8_t *data, size_t len, void * /*userData*/)
+            {
+                auto *stream = static_cast<StreamState *>(nghttp2_session_get_stream_user_data(session, streamId));
+                if (stream)
+                {
+                    std::lock_guard<std::mutex> lock(stream->_mutex);
+                    if (!stream->_cancelled)
+                    {
+                        stream->_chunks.emplace_back(reinterpret_cast<const char *>(data), len);
+                        stream->_cond.notify_all();
+                        return 0;
+                    }
+                }
+                // 无人读取的数据直接归还窗口
+                nghttp2_session_consume(session, streamId, len);
+                return 0;
+            }
+
+            static int onStreamClose(nghttp2_session * /*session*/, int32_t streamId, uint32_t errorCode, void *userData)
+            {
+                Connection *conn = static_cast<Connection *>(userData);
+                auto it = conn->_streams.find(streamId);
+                if (it == conn->_streams.end())
+                    return 0;
+
+                StreamState &stream = *it->second;
+                {
+                    std::lock_guard<std::mutex> lock(stream._mutex);
+                    stream._closed = true;
+                    stream._errorCode = errorCode;
+                    stream._cond.notify_all();
+                }
+                conn->_streams.erase(it);
+                return 0;
+            }
+
+        private:
+            HttpEndpoint _endpoint;
+            TransportOptions _options;
+            SSL_CTX *_sslCtx = nullptr;
+            SSL *_ssl = nullptr;
+            int _fd = -1;
+            int _eventFd = -1;
+            nghttp2_session *_session = nullptr;
+            std::thread _thread;
+            std::string _out; // 待写出的帧
+
+            std::atomic<bool> _stopping{false};
+            std::atomic<bool> _alive{false};
+            std::atomic<bool> _goaway{false};
+            std::atomic<uint32_t> _reserved{0};
+            std::atomic<uint32_t> _remoteMaxStreams{100}; // 收到服务端 SETTINGS 之前按 RFC 建议值估计
+
+            std::mutex _commandMutex;
+            std::deque<Command> _commands;
+            std::string _closeError; // 连接断开的原因，由 _commandMutex 保护
+            std::map<int32_t, StreamPtr> _streams; // 只在 I/O 线程访问
+        };
+
+        using ConnectionPtr = std::shared_ptr<Connection>;
+    }
+
+    struct Http2Transport::Impl
+    {
+        HttpEndpoint _endpoint;
+        TransportOptions _options;
+        SSL_CTX *_sslCtx = nullptr;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _connectCond; // 有连接建立完成 (成功或失败)
+        std::vector<ConnectionPtr> _connections;
+        size_t _connecting = 0;               // 正在建立的连接数，计入 _maxConnections
+
+        ~Impl()
+        {
+            _connections.clear();
+            if (_sslCtx)
+                SSL_CTX_free(_sslCtx);
+        }
+
+        // 选择负载最低的可用连接，全部占满且未达上限时新建连接
+        // 建立连接 (TCP + TLS 握手) 期间不持锁，其它请求可以继续使用已有连接
+        ConnectionPtr acquire(int connectTimeoutSec, std::string &error)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true)
+            {
+                _connections.erase(std::remove_if(_connections.begin(), _connections.end(), [](const ConnectionPtr &conn)
+                                                  { return !conn->usable() && conn->reserved() == 0; }),
+                                   _connections.end());
+                ConnectionPtr best = leastLoaded();
+                bool atLimit = _connections.size() + _connecting >= _options._maxConnections;
+                // 超过服务端并发上限的请求由 nghttp2 排队，等待其它流结束
+                if (best && (best->reserved() < best->maxStreams() || atLimit))
+                {
+                    best->reserve();
+                    return best;
+                }
+                if (!atLimit || _connecting == 0)
+                    break;
+                // 没有可用连接且名额都在建立中：等待结果
+                _connectCond.wait(lock);
+            }
+
+            ++_connecting;
+            lock.unlock();
+            auto conn = std::make_shared<Connection>(_endpoint, _options, _sslCtx);
+            bool connected = conn->connect(connectTimeoutSec, error);
+            lock.lock();
+            --_connecting;
+            _connectCond.notify_all();
+
+            ConnectionPtr best;
+            if (connected)
+            {
+                _connections.push_back(conn);
+                best = conn;
+            }
+            else
+            {
+                best = leastLoaded();
+                if (!best)
+                    return nullptr;
+            }
+            best->reserve();
+            return best;
+        }
+
+        // 调用方持有 _mutex
+        ConnectionPtr leastLoaded() const
+        {
+            ConnectionPtr best;
+            for (auto &conn : _connections)
+            {
+                if (!conn->usable())
+                    continue;
+                if (!best || conn->reserved() < best->reserved())
+                    best = conn;
+            }
+            return best;
+        }
+    };
+
+    Http2Transport::Http2Transport(const std::string &endpoint, const TransportOptions &options)
+        : _impl(std::make_shared<Impl>())
+    {
+        _impl->_options = options;
+        if (_impl->_options._maxConnections == 0)
+            _impl->_options._maxConnections = 1;
+        if (!parseEndpoint(endpoint, _impl->_endpoint))
+        {
+            ERR("Http2Transport: invalid endpoint {}", endpoint);
+        }
+
+        if (_impl->_endpoint._tls)
+        {
+            _impl->_sslCtx = SSL_CTX_new(TLS_client_method());
+            SSL_CTX_set_default_verify_paths(_impl->_sslCtx);
+            SSL_CTX_set_verify(_impl->_sslCtx, SSL_VERIFY_PEER, nullptr);
+            SSL_CTX_set_min_proto_version(_impl->_sslCtx, TLS1_2_VERSION);
+            static const unsigned char alpn[] = {2, 'h', '2'};
+            SSL_CTX_set_alpn_protos(_impl->_sslCtx, alpn, sizeof(alpn));
+        }
+        if (!_impl->_options._proxyHost.empty())
+        {
+            WARN("Http2Transport: proxy is not supported, connecting directly to {}", endpoint);
+        }
+    }
+
+    Http2Transport::~Http2Transport()
+    {
+    }
+
+    size_t Http2Transport::connectionCount() const
+    {
+        std::lock_guard<std::mutex> lock(_impl->_mutex);
+        return _impl->_connections.size();
+    }
+
+    bool Http2Transport::send(const HttpRequest &request, HttpResponse &response,
+                              const BodyHandler &bodyHandler, const CancelTokenPtr &cancelToken)
+    {
+        if (cancelToken && cancelToken->isCancelled())
+        {
+            response._error = "cancelled";
+            return false;
+        }
+
+        // 1. 选择连接
+        ConnectionPtr conn = _impl->acquire(clampTimeoutSec(request._connectTimeoutSec, request._deadlineMs), response._error);
+        if (!conn)
+            return false;
+
+        // 离开作用域时释放流名额
+        std::shared_ptr<void> releaseGuard(nullptr, [conn](void *)
+                                           { conn->release(); });
+
+        // 2. 构造流并提交给 I/O 线程 (HTTP/2 头部名必须为小写)
+        auto stream = std::make_shared<StreamState>();
+        stream->_method = request._method;
+        stream->_path = request._path;
+        for (const auto &header : request._headers)
+        {
+            stream->_headers.emplace_back(lowerCase(header.first), header.second);
+        }
+        if (request._streamingBody)
+        {
+            // 长度事先未知，不发送 content-length，以 END_STREAM 标记结束
+            stream->_bodyReader.reset(new StreamingBody::Reader(request._streamingBody, request._onUploadProgress));
+        }
+        else
+        {
+            stream->_headers.emplace_back("content-length", std::to_string(request._body.size()));
+            stream->_body = request._body;
+        }
+        conn->post(Command{Command::Submit, stream, 0});
+
+        // 取消：标记流并通知 I/O 线程发送 RST_STREAM，连接本身不受影响
+        auto cancelStream = [conn, stream]()
+        {
+            {
+                std::lock_guard<std::mutex> lock(stream->_mutex);
+                if (stream->_cancelled || stream->_closed)
+                    return;
+                stream->_cancelled = true;
+                stream->_cond.notify_all();
+            }
+            conn->post(Command{Command::Cancel, stream, 0});
+        };
+        CancelHookGuard cancelGuard(cancelToken, cancelStream);
+
+        // 3. 在调用线程上逐块交付数据，交付完成后归还流控窗口
+        auto readTimeout = std::chrono::seconds(request._readTimeoutSec);
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        if (request._deadlineMs > 0)
+            deadline = std::chrono::steady_clock::time_point(std::chrono::milliseconds(request._deadlineMs));
+        while (true)
+        {
+            std::string chunk;
+            {
+                std::unique_lock<std::mutex> lock(stream->_mutex);
+                bool ready = stream->_cond.wait_until(lock, std::min(std::chrono::steady_clock::now() + readTimeout, deadline), [&]()
+                                                      { return stream->_cancelled || stream->_closed || !stream->_chunks.empty() ||
+                                                               (stream->_status != 0 && response._status == 0); });
+                response._status = stream->_status;
+
+                if (stream->_cancelled)
+                {
+                    response._error = "cancelled";
+                    return false;
+                }
+                if (!ready)
+                {
+                    lock.unlock();
+                    cancelStream();
+                    response._error = std::chrono::steady_clock::now() >= deadline ? "deadline exceeded" : "read timeout";
+                    return false;
+                }
+                if (stream->_chunks.empty())
+                {
+                    if (!stream->_closed)
+                        continue;
+                    if (!stream->_error.empty())
+                    {
+                        response._error = stream->_error;
+                        return false;
+                    }
+                    if (stream->_errorCode != NGHTTP2_NO_ERROR)
+                    {
+                        response._error = std::string("stream reset: ") + nghttp2_http2_strerror(stream->_errorCode);
+                        return false;
+                    }
+                    return true;
+                }
+                chunk.swap(stream->_chunks.front());
+                stream->_chunks.pop_front();
+            }
+
+            bool keepGoing = true;
+            if (bodyHandler)
+                keepGoing = bodyHandler(chunk.data(), chunk.size());
+            else
+                response._body += chunk;
+            conn->post(Command{Command::Consume, stream, chunk.size()});
+
+            if (!keepGoing)
+            {
+                cancelStream();
+                response._error = "aborted by body handler";
+                return false;
+            }
+        }
+    }
+
+} // end ai_chat_sdk
+
+#endif // CHATSDK_WITH_NGHTTP2
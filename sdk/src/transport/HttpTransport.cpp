@@ -0,0 +1,87 @@
+#include "../../include/transport/HttpTransport.h"
+#include "../../include/transport/HttplibTransport.h"
+#include "../../include/transport/Http2Transport.h"
+#include "../../include/transport/ReactorTransport.h"
+#include "../../include/util/myLog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+namespace ai_chat_sdk
+{
+    int64_t steadyNowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    int clampTimeoutSec(int timeoutSec, int64_t deadlineMs)
+    {
+        if (deadlineMs <= 0)
+            return timeoutSec;
+        int64_t remainingSec = (deadlineMs - steadyNowMs() + 999) / 1000;
+        return static_cast<int>(std::max<int64_t>(1, std::min<int64_t>(timeoutSec, remainingSec)));
+    }
+
+    bool parseEndpoint(const std::string &url, HttpEndpoint &endpoint)
+    {
+        std::string rest = url;
+        if (rest.compare(0, 8, "https://") == 0)
+        {
+            endpoint._tls = true;
+            endpoint._port = 443;
+            rest = rest.substr(8);
+        }
+        else if (rest.compare(0, 7, "http://") == 0)
+        {
+            endpoint._tls = false;
+            endpoint._port = 80;
+            rest = rest.substr(7);
+        }
+        else
+        {
+            return false;
+        }
+
+        // 去掉路径部分，base url 只取 host[:port]
+        size_t slash = rest.find('/');
+        if (slash != std::string::npos)
+            rest = rest.substr(0, slash);
+        endpoint._authority = rest;
+
+        size_t colon = rest.rfind(':');
+        if (colon != std::string::npos && rest.find(']') == std::string::npos)
+        {
+            endpoint._host = rest.substr(0, colon);
+            endpoint._port = std::atoi(rest.substr(colon + 1).c_str());
+        }
+        else
+        {
+            endpoint._host = rest;
+        }
+        return !endpoint._host.empty() && endpoint._port > 0;
+    }
+
+    HttpTransportPtr createTransport(const std::string &kind, const std::string &endpoint, const TransportOptions &options)
+    {
+        if ("http2" == kind)
+        {
+#ifdef CHATSDK_WITH_NGHTTP2
+            return std::make_shared<Http2Transport>(endpoint, options);
+#else
+            ERR("createTransport: http2 transport is not compiled in (CHATSDK_WITH_NGHTTP2), fallback to httplib");
+#endif
+        }
+        else if ("reactor" == kind)
+        {
+            return std::make_shared<ReactorTransport>(endpoint, options);
+        }
+        else if ("httplib" != kind)
+        {
+            ERR("createTransport: unknown transport '{}', fallback to httplib", kind);
+        }
+        return std::make_shared<HttplibTransport>(endpoint, options);
+    }
+
+} // end ai_chat_sdk
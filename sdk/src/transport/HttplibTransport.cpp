@@ -0,0 +1,100 @@
+#include "../../include/transport/HttplibTransport.h"
+#include "../../include/transport/StreamingBody.h"
+#include "../../include/util/myLog.h"
+#include <httplib.h>
+
+namespace ai_chat_sdk
+{
+    HttplibTransport::HttplibTransport(const std::string &endpoint, const TransportOptions &options)
+        : _endpoint(endpoint), _options(options)
+    {
+    }
+
+    bool HttplibTransport::send(const HttpRequest &request, HttpResponse &response,
+                                const BodyHandler &bodyHandler, const CancelTokenPtr &cancelToken)
+    {
+        // 1. 创建 HTTP 客户端
+        httplib::Client client(_endpoint.c_str());
+        // 有截止时间时超时不超过剩余预算，整体预算由调用方的 RequestDeadline 取消令牌保证
+        client.set_connection_timeout(clampTimeoutSec(request._connectTimeoutSec, request._deadlineMs), 0);
+        client.set_read_timeout(clampTimeoutSec(request._readTimeoutSec, request._deadlineMs), 0);
+        if (!_options._proxyHost.empty())
+        {
+            client.set_proxy(_options._proxyHost, _options._proxyPort);
+        }
+
+        // 2. 构造 Request 对象
+        httplib::Request req;
+        req.method = request._method;
+        req.path = request._path;
+        for (const auto &header : request._headers)
+        {
+            req.headers.emplace(header.first, header.second);
+        }
+        if (request._streamingBody)
+        {
+            // 流式请求体：chunked 编码，httplib 每次回调读取一块
+            // 公开的 Post(ContentProviderWithoutLength) 接口会缓冲整个响应，这里与普通请求共用同一个 Request，
+            // 请求体边读边发的同时，响应仍经 response_handler / content_receiver 逐块交付
+            auto reader = std::make_shared<StreamingBody::Reader>(request._streamingBody, request._onUploadProgress);
+            req.set_header("Transfer-Encoding", "chunked");
+            req.is_chunked_content_provider_ = true;
+            req.content_provider_ = [reader, &cancelToken](size_t /*offset*/, size_t /*length*/, httplib::DataSink &sink)
+            {
+                if (cancelToken && cancelToken->isCancelled())
+                    return false;
+                char buf[16384];
+                ssize_t n = reader->read(buf, sizeof(buf));
+                if (n < 0)
+                    return false;
+                if (n == 0)
+                {
+                    sink.done();
+                    return true;
+                }
+                return sink.write(buf, static_cast<size_t>(n));
+            };
+        }
+        else
+        {
+            req.body = request._body;
+        }
+
+        // 3. 响应头处理器：记录状态码，已取消则不再接收 Body
+        req.response_handler = [&](const httplib::Response &res)
+        {
+            response._status = res.status;
+            return !(cancelToken && cancelToken->isCancelled());
+        };
+
+        // 4. 内容接收器：返回 false 让 httplib 立即中止读取
+        req.content_receiver = [&](const char *data, size_t len, uint64_t /*offset*/, uint64_t /*total*/)
+        {
+            if (cancelToken && cancelToken->isCancelled())
+                return false;
+            if (bodyHandler)
+                return bodyHandler(data, len);
+            response._body.append(data, len);
+            return true;
+        };
+
+        // 取消时关闭 socket，打断阻塞中的读操作 (守卫在 client 之前析构)
+        CancelHookGuard cancelGuard(cancelToken, [&client]()
+                                    { client.stop(); });
+
+        // 5. 发送请求
+        auto res = client.send(req);
+        if (cancelToken && cancelToken->isCancelled())
+        {
+            response._error = "cancelled";
+            return false;
+        }
+        if (!res)
+        {
+            response._error = to_string(res.error());
+            return false;
+        }
+        return true;
+    }
+
+} // end ai_chat_sdk
@@ -0,0 +1,913 @@
+#include "../../include/transport/ReactorTransport.h"
+#include "../../include/transport/StreamingBody.h"
+#include "../../include/util/myLog.h"
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        const size_t kMaxHeaderBytes = 64 * 1024; // 响应头上限
+        const int64_t kDnsCacheMs = 60 * 1000;    // DNS 结果缓存时间
+
+        bool equalsIgnoreCase(const std::string &a, const char *b)
+        {
+            size_t len = std::strlen(b);
+            if (a.size() != len)
+                return false;
+            for (size_t i = 0; i < len; ++i)
+            {
+                if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+                    return false;
+            }
+            return true;
+        }
+
+        std::string trim(const std::string &text)
+        {
+            size_t begin = text.find_first_not_of(" \t");
+            if (begin == std::string::npos)
+                return "";
+            size_t end = text.find_last_not_of(" \t");
+            return text.substr(begin, end - begin + 1);
+        }
+
+        // 传输实例与其上所有请求共享的状态 (请求可能比传输实例活得更久)
+        struct ReactorContext
+        {
+            HttpEndpoint _endpoint;
+            bool _valid = false;
+            TransportOptions _options;
+            SSL_CTX *_sslCtx = nullptr;
+            EventLoopPool *_pool = nullptr;
+            std::atomic<size_t> _inflight{0};
+
+            // DNS 缓存：解析是阻塞调用，在调用线程完成，避免卡住事件循环
+            struct CachedAddress
+            {
+                sockaddr_storage _addr;
+                socklen_t _len;
+                int64_t _expireMs;
+            };
+            std::mutex _dnsMutex;
+            std::map<std::string, CachedAddress> _dnsCache;
+
+            ~ReactorContext()
+            {
+                if (_sslCtx)
+                    SSL_CTX_free(_sslCtx);
+            }
+
+            bool resolve(const std::string &host, int port, sockaddr_storage &addr, socklen_t &len, std::string &error)
+            {
+                std::string key = host + ":" + std::to_string(port);
+                int64_t now = EventLoop::nowMs();
+                {
+                    std::lock_guard<std::mutex> lock(_dnsMutex);
+                    auto it = _dnsCache.find(key);
+                    if (it != _dnsCache.end() && it->second._expireMs > now)
+                    {
+                        addr = it->second._addr;
+                        len = it->second._len;
+                        return true;
+                    }
+                }
+
+                addrinfo hints;
+                std::memset(&hints, 0, sizeof(hints));
+                hints.ai_family = AF_UNSPEC;
+                hints.ai_socktype = SOCK_STREAM;
+                addrinfo *result = nullptr;
+                if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || result == nullptr)
+                {
+                    error = "resolve " + host + " failed";
+                    return false;
+                }
+                std::memcpy(&addr, result->ai_addr, result->ai_addrlen);
+                len = result->ai_addrlen;
+                ::freeaddrinfo(result);
+
+                std::lock_guard<std::mutex> lock(_dnsMutex);
+                _dnsCache[key] = CachedAddress{addr, len, now + kDnsCacheMs};
+                return true;
+            }
+        };
+
+        // 一次 HTTP 请求 / 响应的状态机，只在所属事件循环线程中运行
+        class Exchange : public std::enable_shared_from_this<Exchange>
+        {
+        public:
+            enum State
+            {
+                Connecting,     // 等待非阻塞 connect 完成
+                ProxyHandshake, // 通过代理 CONNECT 建立隧道
+                TlsHandshake,   // TLS 握手
+                Writing,        // 写出请求
+                ReadingHead,    // 读取响应头
+                ReadingBody,    // 读取响应体
+                Done
+            };
+
+            Exchange(EventLoop &loop, const std::shared_ptr<ReactorContext> &owner)
+                : _loop(loop), _owner(owner)
+            {
+            }
+
+            ~Exchange()
+            {
+                closeSocket();
+            }
+
+            // 由调用线程填写，start 之后只在循环线程访问
+            sockaddr_storage _addr;
+            socklen_t _addrLen = 0;
+            std::string _request; // 序列化好的请求报文 (流式请求体时为请求头，之后依次存放每个 chunk)
+            std::unique_ptr<StreamingBody::Reader> _bodyReader; // 流式请求体，写完最后一个 chunk 后释放
+            uint32_t _connectTimeoutMs = 30000;
+            uint32_t _readTimeoutMs = 60000;
+            int64_t _deadlineMs = 0; // 绝对截止时间，0 表示不限
+            HttpResponsePtr _response;
+            BodyHandler _bodyHandler;
+            CompletionHandler _onComplete;
+            CancelTokenPtr _cancelToken;
+
+            void start()
+            {
+                auto self = shared_from_this();
+                if (_cancelToken)
+                {
+                    // 取消可能发生在任意线程，统一投递回循环线程处理
+                    std::weak_ptr<Exchange> weak = self;
+                    EventLoop *loop = &_loop;
+                    _hookId = _cancelToken->addHook([weak, loop]()
+                                                    { loop->post([weak]()
+                                                                 {
+                            if (auto exchange = weak.lock())
+                                exchange->finish(false, "cancelled"); }); });
+                }
+                // 1. 发起非阻塞连接
+                _fd = ::socket(_addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+                if (_fd < 0)
+                {
+                    finish(false, std::string("socket failed: ") + std::strerror(errno));
+                    return;
+                }
+                int one = 1;
+                ::setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+                _phaseStartMs = EventLoop::nowMs();
+                armTimer(withinDeadline(_connectTimeoutMs));
+
+                int ret = ::connect(_fd, reinterpret_cast<sockaddr *>(&_addr), _addrLen);
+                if (ret != 0 && errno != EINPROGRESS)
+                {
+                    finish(false, std::string("connect failed: ") + std::strerror(errno));
+                    return;
+                }
+                if (!_loop.addFd(_fd, EPOLLOUT, [self](uint32_t events)
+                                 { self->onEvent(events); }))
+                {
+                    finish(false, "register socket failed");
+                }
+            }
+
+        private:
+            void onEvent(uint32_t events)
+            {
+                switch (_state)
+                {
+                case Connecting:
+                    onConnectEvent(events);
+                    break;
+                case ProxyHandshake:
+                    onProxyEvent();
+                    break;
+                case TlsHandshake:
+                    doTlsHandshake();
+                    break;
+                case Writing:
+                    doWrite();
+                    break;
+                case ReadingHead:
+                case ReadingBody:
+                    doRead();
+                    break;
+                case Done:
+                    break;
+                }
+            }
+
+            // 2. 连接完成：按需建立代理隧道 / TLS，然后写请求
+            void onConnectEvent(uint32_t /*events*/)
+            {
+                int soError = 0;
+                socklen_t len = sizeof(soError);
+                ::getsockopt(_fd, SOL_SOCKET, SO_ERROR, &soError, &len);
+                if (soError != 0)
+                {
+                    finish(false, std::string("connect failed: ") + std::strerror(soError));
+                    return;
+                }
+
+                const auto &endpoint = _owner->_endpoint;
+                if (!_owner->_options._proxyHost.empty() && endpoint._tls)
+                {
+                    _state = ProxyHandshake;
+                    _proxyOut = "CONNECT " + endpoint._host + ":" + std::to_string(endpoint._port) + " HTTP/1.1\r\n" +
+                                "Host: " + endpoint._host + ":" + std::to_string(endpoint._port) + "\r\n\r\n";
+                    onProxyEvent();
+                    return;
+                }
+                startTlsOrWrite();
+            }
+
+            void onProxyEvent()
+            {
+                // 先写完 CONNECT 请求
+                while (!_proxyOut.empty())
+                {
+                    ssize_t n = ::send(_fd, _proxyOut.data(), _proxyOut.size(), MSG_NOSIGNAL);
+                    if (n < 0)
+                    {
+                        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                            return;
+                        finish(false, std::string("proxy send failed: ") + std::strerror(errno));
+                        return;
+                    }
+                    _proxyOut.erase(0, static_cast<size_t>(n));
+                    if (_proxyOut.empty())
+                        _loop.modifyFd(_fd, EPOLLIN);
+                }
+
+                // 再读代理响应头，必须是 2xx
+                char buf[4096];
+                while (true)
+                {
+                    ssize_t n = ::recv(_fd, buf, sizeof(buf), 0);
+                    if (n < 0)
+                    {
+                        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                            return;
+                        finish(false, std::string("proxy recv failed: ") + std::strerror(errno));
+                        return;
+                    }
+                    if (n == 0)
+                    {
+                        finish(false, "proxy closed connection");
+                        return;
+                    }
+                    _in.append(buf, static_cast<size_t>(n));
+                    size_t headEnd = _in.find("\r\n\r\n");
+                    if (headEnd == std::string::npos)
+                    {
+                        if (_in.size() > kMaxHeaderBytes)
+                        {
+                            finish(false, "proxy response too large");
+                            return;
+                        }
+                        continue;
+                    }
+
+                    size_t space = _in.find(' ');
+                    if (space == std::string::npos || space + 1 >= _in.size() || _in[space + 1] != '2')
+                    {
+                        finish(false, "proxy CONNECT rejected: " + _in.substr(0, _in.find("\r\n")));
+                        return;
+                    }
+                    _in.clear();
+                    startTlsOrWrite();
+                    return;
+                }
+            }
+
+            void startTlsOrWrite()
+            {
+                if (_owner->_endpoint._tls)
+                {
+                    _state = TlsHandshake;
+                    _ssl = SSL_new(_owner->_sslCtx);
+                    SSL_set_fd(_ssl, _fd);
+                    SSL_set_tlsext_host_name(_ssl, _owner->_endpoint._host.c_str());
+                    X509_VERIFY_PARAM_set1_host(SSL_get0_param(_ssl), _owner->_endpoint._host.c_str(), 0);
+                    SSL_set_mode(_ssl, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+                    doTlsHandshake();
+                    return;
+                }
+                startWrite();
+            }
+
+            void doTlsHandshake()
+            {
+                int ret = SSL_connect(_ssl);
+                if (ret == 1)
+                {
+                    startWrite();
+                    return;
+                }
+                int sslError = SSL_get_error(_ssl, ret);
+                if (sslError == SSL_ERROR_WANT_READ)
+                    _loop.modifyFd(_fd, EPOLLIN);
+                else if (sslError == SSL_ERROR_WANT_WRITE)
+                    _loop.modifyFd(_fd, EPOLLOUT);
+                else
+                    finish(false, "TLS handshake failed: " + sslErrorString());
+            }
+
+            // 3. 写出请求，之后超时从连接超时切换为读空闲超时
+            void startWrite()
+            {
+                _state = Writing;
+                _lastActivityMs = EventLoop::nowMs();
+                if (_timer != 0)
+                    _loop.cancelTimer(_timer);
+                armTimer(withinDeadline(_readTimeoutMs));
+                _loop.modifyFd(_fd, EPOLLOUT);
+                doWrite();
+            }
+
+            void doWrite()
+            {
+                while (true)
+                {
+                    while (_outOffset < _request.size())
+                    {
+                        ssize_t n = ioWrite(_request.data() + _outOffset, _request.size() - _outOffset);
+                        if (n < 0)
+                        {
+                            finish(false, "send request failed: " + _ioError);
+                            return;
+                        }
+                        if (n == 0)
+                            return;
+                        _outOffset += static_cast<size_t>(n);
+                        _lastActivityMs = EventLoop::nowMs();
+                    }
+                    // 流式请求体：上一块写完才读下一块，占用的内存不超过一个 chunk
+                    if (!_bodyReader || !nextBodyChunk())
+                        break;
+                }
+                if (_state != Writing)
+                    return;
+
+                // 请求已写完，释放内存，等待响应
+                std::string().swap(_request);
+                _state = ReadingHead;
+                _loop.modifyFd(_fd, EPOLLIN);
+            }
+
+            // 从流式请求体读取下一块并按 chunked 编码放入 _request，读取失败时结束请求并返回 false
+            bool nextBodyChunk()
+            {
+                char buf[16384];
+                ssize_t n = _bodyReader->read(buf, sizeof(buf));
+                if (n < 0)
+                {
+                    finish(false, "read request body failed");
+                    return false;
+                }
+                _request.clear();
+                _outOffset = 0;
+                if (n == 0)
+                {
+                    _request = "0\r\n\r\n";
+                    _bodyReader.reset();
+                    return true;
+                }
+                char size[24];
+                int len = std::snprintf(size, sizeof(size), "%zx\r\n", static_cast<size_t>(n));
+                _request.append(size, static_cast<size_t>(len));
+                _request.append(buf, static_cast<size_t>(n));
+                _request += "\r\n";
+                return true;
+            }
+
+            // 4. 读取响应：头部解析完成后逐块交给 BodyHandler
+            void doRead()
+            {
+                char buf[16384];
+                while (_state == ReadingHead || _state == ReadingBody)
+                {
+                    ssize_t n = ioRead(buf, sizeof(buf));
+                    if (n == 0)
+                        return;
+                    if (n < 0)
+                    {
+                        if (_eof)
+                            onEof();
+                        else
+                            finish(false, "recv failed: " + _ioError);
+                        return;
+                    }
+                    _lastActivityMs = EventLoop::nowMs();
+                    onData(buf, static_cast<size_t>(n));
+                }
+            }
+
+            void onData(const char *data, size_t len)
+            {
+                if (_state == ReadingBody)
+                {
+                    onBodyData(data, len);
+                    return;
+                }
+
+                _in.append(data, len);
+                size_t headEnd = _in.find("\r\n\r\n");
+                if (headEnd == std::string::npos)
+                {
+                    if (_in.size() > kMaxHeaderBytes)
+                        finish(false, "response header too large");
+                    return;
+                }
+
+                if (!parseHead(_in.substr(0, headEnd)))
+                {
+                    finish(false, "malformed response header");
+                    return;
+                }
+                std::string rest = _in.substr(headEnd + 4);
+                _in.clear();
+                _state = ReadingBody;
+
+                if (_bodyMode == Length && _remaining == 0)
+                {
+                    finish(true, "");
+                    return;
+                }
+                if (!rest.empty())
+                    onBodyData(rest.data(), rest.size());
+            }
+
+            bool parseHead(const std::string &head)
+            {
+                // 状态行：HTTP/1.1 200 OK
+                size_t lineEnd = head.find("\r\n");
+                std::string statusLine = head.substr(0, lineEnd);
+                size_t space = statusLine.find(' ');
+                if (statusLine.compare(0, 5, "HTTP/") != 0 || space == std::string::npos)
+                    return false;
+                _response->_status = std::atoi(statusLine.c_str() + space + 1);
+                if (_response->_status <= 0)
+                    return false;
+
+                // 头部：只关心决定 Body 长度的字段
+                _bodyMode = UntilClose;
+                size_t pos = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+                while (pos < head.size())
+                {
+                    size_t end = head.find("\r\n", pos);
+                    if (end == std::string::npos)
+                        end = head.size();
+                    std::string line = head.substr(pos, end - pos);
+                    pos = end + 2;
+
+                    size_t colon = line.find(':');
+                    if (colon == std::string::npos)
+                        continue;
+                    std::string key = trim(line.substr(0, colon));
+                    std::string value = trim(line.substr(colon + 1));
+                    if (equalsIgnoreCase(key, "transfer-encoding") && value.find("chunked") != std::string::npos)
+                    {
+                        _bodyMode = Chunked;
+                    }
+                    else if (equalsIgnoreCase(key, "content-length") && _bodyMode != Chunked)
+                    {
+                        _bodyMode = Length;
+                        _remaining = std::strtoull(value.c_str(), nullptr, 10);
+                    }
+                }
+                if (_response->_status == 204 || _response->_status == 304)
+                {
+                    _bodyMode = Length;
+                    _remaining = 0;
+                }
+                return true;
+            }
+
+            void onBodyData(const char *data, size_t len)
+            {
+                if (_bodyMode == UntilClose)
+                {
+                    deliver(data, len);
+                    return;
+                }
+                if (_bodyMode == Length)
+                {
+                    size_t n = static_cast<size_t>(std::min<uint64_t>(_remaining, len));
+                    _remaining -= n;
+                    if (deliver(data, n) && _remaining == 0)
+                        finish(true, "");
+                    return;
+                }
+
+                // chunked：数据可能跨越多次读取，先缓存再按块解析
+                _in.append(data, len);
+                size_t pos = 0;
+                while (_state == ReadingBody)
+                {
+                    if (_chunkState == ChunkSize || _chunkState == ChunkDataEnd || _chunkState == Trailer)
+                    {
+                        size_t lineEnd = _in.find("\r\n", pos);
+                        if (lineEnd == std::string::npos)
+                            break;
+                        std::string line = _in.substr(pos, lineEnd - pos);
+                        pos = lineEnd + 2;
+
+                        if (_chunkState == ChunkSize)
+                        {
+                            _remaining = std::strtoull(line.c_str(), nullptr, 16);
+                            _chunkState = _remaining == 0 ? Trailer : ChunkData;
+                        }
+                        else if (_chunkState == ChunkDataEnd)
+                        {
+                            _chunkState = ChunkSize;
+                        }
+                        else if (line.empty())
+                        {
+                            finish(true, "");
+                        }
+                    }
+                    else
+                    {
+                        if (pos >= _in.size())
+                            break;
+                        size_t n = static_cast<size_t>(std::min<uint64_t>(_remaining, _in.size() - pos));
+                        if (!deliver(_in.data() + pos, n))
+                            return;
+                        pos += n;
+                        _remaining -= n;
+                        if (_remaining == 0)
+                            _chunkState = ChunkDataEnd;
+                    }
+                }
+                if (_state == ReadingBody)
+                    _in.erase(0, pos);
+            }
+
+            bool deliver(const char *data, size_t len)
+            {
+                if (len == 0)
+                    return true;
+                if (_cancelToken && _cancelToken->isCancelled())
+                {
+                    finish(false, "cancelled");
+                    return false;
+                }
+                if (!_bodyHandler)
+                {
+                    _response->_body.append(data, len);
+                    return true;
+                }
+                if (!_bodyHandler(data, len))
+                {
+                    finish(false, "aborted by body handler");
+                    return false;
+                }
+                return true;
+            }
+
+            void onEof()
+            {
+                if (_state == ReadingBody && _bodyMode == UntilClose)
+                    finish(true, "");
+                else
+                    finish(false, "connection closed before response completed");
+            }
+
+            // 返回写入字节数，0 表示需要等待可写，-1 表示出错
+            ssize_t ioWrite(const char *data, size_t len)
+            {
+                if (_ssl)
+                {
+                    int ret = SSL_write(_ssl, data, static_cast<int>(std::min<size_t>(len, 1 << 30)));
+                    if (ret > 0)
+                        return ret;
+                    int sslError = SSL_get_error(_ssl, ret);
+                    if (sslError == SSL_ERROR_WANT_WRITE || sslError == SSL_ERROR_WANT_READ)
+                        return 0;
+                    _ioError = sslErrorString();
+                    return -1;
+                }
+                ssize_t n = ::send(_fd, data, len, MSG_NOSIGNAL);
+                if (n >= 0)
+                    return n;
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                    return 0;
+                _ioError = std::strerror(errno);
+                return -1;
+            }
+
+            // 返回读取字节数，0 表示暂无数据，-1 表示出错或对端关闭 (_eof)
+            ssize_t ioRead(char *buf, size_t len)
+            {
+                if (_ssl)
+                {
+                    int ret = SSL_read(_ssl, buf, static_cast<int>(len));
+                    if (ret > 0)
+                        return ret;
+                    int sslError = SSL_get_error(_ssl, ret);
+                    if (sslError == SSL_ERROR_WANT_READ || sslError == SSL_ERROR_WANT_WRITE)
+                        return 0;
+                    // 部分服务端不发送 close_notify 直接断开，同样视为 EOF
+                    _eof = sslError == SSL_ERROR_ZERO_RETURN || (sslError == SSL_ERROR_SYSCALL && ERR_peek_error() == 0);
+                    _ioError = sslErrorString();
+                    return -1;
+                }
+                ssize_t n = ::recv(_fd, buf, len, 0);
+                if (n > 0)
+                    return n;
+                if (n == 0)
+                {
+                    _eof = true;
+                    return -1;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                    return 0;
+                _ioError = std::strerror(errno);
+                return -1;
+            }
+
+            std::string sslErrorString()
+            {
+                unsigned long code = ERR_get_error();
+                const char *reason = code ? ERR_reason_error_string(code) : nullptr;
+                return reason ? reason : "unknown";
+            }
+
+            // 超时检查：连接阶段看总时长，之后看距上次读写的空闲时长
+            void armTimer(uint32_t delayMs)
+            {
+                auto self = shared_from_this();
+                _timer = _loop.runAfter(delayMs, [self]()
+                                        {
+                    self->_timer = 0;
+                    self->onTimer(); });
+            }
+
+            // 阶段超时不超过到截止时间的剩余毫秒数
+            uint32_t withinDeadline(uint32_t delayMs) const
+            {
+                if (_deadlineMs <= 0)
+                    return delayMs;
+                int64_t remaining = std::max<int64_t>(0, _deadlineMs - EventLoop::nowMs());
+                return static_cast<uint32_t>(std::min<int64_t>(delayMs, remaining));
+            }
+
+            void onTimer()
+            {
+                if (_state == Done)
+                    return;
+                int64_t now = EventLoop::nowMs();
+                if (_deadlineMs > 0 && now >= _deadlineMs)
+                {
+                    finish(false, "deadline exceeded");
+                    return;
+                }
+                bool connecting = _state == Connecting || _state == ProxyHandshake || _state == TlsHandshake;
+                int64_t deadline = connecting ? _phaseStartMs + _connectTimeoutMs : _lastActivityMs + _readTimeoutMs;
+                if (now >= deadline)
+                {
+                    finish(false, connecting ? "connect timeout" : "read timeout");
+                    return;
+                }
+                if (_deadlineMs > 0)
+                    deadline = std::min(deadline, _deadlineMs);
+                armTimer(static_cast<uint32_t>(deadline - now));
+            }
+
+            void closeSocket()
+            {
+                if (_ssl)
+                {
+                    SSL_free(_ssl);
+                    _ssl = nullptr;
+                }
+                if (_fd >= 0)
+                {
+                    ::close(_fd);
+                    _fd = -1;
+                }
+            }
+
+        public:
+            // 结束请求：释放资源后通知调用方，只执行一次
+            void finish(bool ok, const std::string &error)
+            {
+                if (_state == Done)
+                    return;
+                _state = Done;
+
+                if (_timer != 0)
+                {
+                    _loop.cancelTimer(_timer);
+                    _timer = 0;
+                }
+                if (_fd >= 0)
+                    _loop.removeFd(_fd);
+                closeSocket();
+                if (_cancelToken && _hookId != 0)
+                    _cancelToken->removeHook(_hookId);
+
+                if (!ok)
+                    _response->_error = error;
+                --_owner->_inflight;
+
+                CompletionHandler onComplete;
+                onComplete.swap(_onComplete);
+                if (onComplete)
+                    onComplete(ok);
+            }
+
+        private:
+            enum BodyMode
+            {
+                Length,    // Content-Length
+                Chunked,   // Transfer-Encoding: chunked
+                UntilClose // 读到连接关闭
+            };
+            enum ChunkState
+            {
+                ChunkSize,
+                ChunkData,
+                ChunkDataEnd,
+                Trailer
+            };
+
+            EventLoop &_loop;
+            std::shared_ptr<ReactorContext> _owner;
+            State _state = Connecting;
+            int _fd = -1;
+            SSL *_ssl = nullptr;
+            uint64_t _hookId = 0;
+            TimerWheel::TimerId _timer = 0;
+            int64_t _phaseStartMs = 0;
+            int64_t _lastActivityMs = 0;
+
+            std::string _proxyOut;
+            size_t _outOffset = 0;
+            std::string _in; // 未解析的输入 (响应头 / chunked 数据)
+            BodyMode _bodyMode = UntilClose;
+            ChunkState _chunkState = ChunkSize;
+            uint64_t _remaining = 0;
+            bool _eof = false;
+            std::string _ioError;
+        };
+    }
+
+    struct ReactorTransport::Impl : public ReactorContext
+    {
+    };
+
+    ReactorTransport::ReactorTransport(const std::string &endpoint, const TransportOptions &options)
+        : _impl(std::make_shared<Impl>())
+    {
+        _impl->_options = options;
+        _impl->_valid = parseEndpoint(endpoint, _impl->_endpoint);
+        if (!_impl->_valid)
+        {
+            ERR("ReactorTransport: invalid endpoint {}", endpoint);
+        }
+        if (_impl->_endpoint._tls)
+        {
+            _impl->_sslCtx = SSL_CTX_new(TLS_client_method());
+            SSL_CTX_set_default_verify_paths(_impl->_sslCtx);
+            SSL_CTX_set_verify(_impl->_sslCtx, SSL_VERIFY_PEER, nullptr);
+            SSL_CTX_set_min_proto_version(_impl->_sslCtx, TLS1_2_VERSION);
+        }
+        _impl->_pool = &EventLoopPool::shared(options._ioThreads);
+    }
+
+    ReactorTransport::~ReactorTransport()
+    {
+    }
+
+    size_t ReactorTransport::inflight() const
+    {
+        return _impl->_inflight.load();
+    }
+
+    void ReactorTransport::sendAsync(const HttpRequest &request, const HttpResponsePtr &response, const BodyHandler &bodyHandler,
+                                     const CompletionHandler &onComplete, const CancelTokenPtr &cancelToken)
+    {
+        auto fail = [&](const std::string &error)
+        {
+            response->_error = error;
+            if (onComplete)
+                onComplete(false);
+        };
+        if (!_impl->_valid)
+        {
+            fail("invalid endpoint");
+            return;
+        }
+        if (cancelToken && cancelToken->isCancelled())
+        {
+            fail("cancelled");
+            return;
+        }
+
+        EventLoop &loop = _impl->_pool->next();
+        auto exchange = std::make_shared<Exchange>(loop, _impl);
+
+        // 1. 解析地址 (走代理时连接代理)
+        const auto &endpoint = _impl->_endpoint;
+        const auto &options = _impl->_options;
+        bool viaProxy = !options._proxyHost.empty();
+        std::string error;
+        if (!_impl->resolve(viaProxy ? options._proxyHost : endpoint._host, viaProxy ? options._proxyPort : endpoint._port,
+                            exchange->_addr, exchange->_addrLen, error))
+        {
+            fail(error);
+            return;
+        }
+
+        // 2. 序列化请求报文，每个请求独占一条连接 (Connection: close)
+        std::string target = request._path;
+        if (viaProxy && !endpoint._tls)
+            target = "http://" + endpoint._authority + request._path; // 明文代理使用绝对 URI
+        std::string &wire = exchange->_request;
+        wire.reserve(request._body.size() + 512);
+        wire += request._method + " " + target + " HTTP/1.1\r\n";
+        wire += "Host: " + endpoint._authority + "\r\n";
+        for (const auto &header : request._headers)
+        {
+            wire += header.first + ": " + header.second + "\r\n";
+        }
+        if (request._streamingBody)
+        {
+            // 请求体长度事先未知，使用 chunked 编码，在循环线程中边读边发
+            wire += "Transfer-Encoding: chunked\r\n";
+            exchange->_bodyReader.reset(new StreamingBody::Reader(request._streamingBody, request._onUploadProgress));
+        }
+        else
+        {
+            wire += "Content-Length: " + std::to_string(request._body.size()) + "\r\n";
+        }
+        wire += "Connection: close\r\n\r\n";
+        if (!request._streamingBody)
+            wire += request._body;
+
+        exchange->_connectTimeoutMs = static_cast<uint32_t>(std::max(request._connectTimeoutSec, 1)) * 1000;
+        exchange->_readTimeoutMs = static_cast<uint32_t>(std::max(request._readTimeoutSec, 1)) * 1000;
+        exchange->_deadlineMs = request._deadlineMs;
+        exchange->_response = response;
+        exchange->_bodyHandler = bodyHandler;
+        exchange->_onComplete = onComplete;
+        exchange->_cancelToken = cancelToken;
+
+        // 3. 交给事件循环
+        ++_impl->_inflight;
+        loop.post([exchange]()
+                  { exchange->start(); });
+    }
+
+    bool ReactorTransport::send(const HttpRequest &request, HttpResponse &response,
+                                const BodyHandler &bodyHandler, const CancelTokenPtr &cancelToken)
+    {
+        // 在循环线程中同步等待会阻塞自身，导致死锁
+        if (EventLoop::current() != nullptr)
+        {
+            ERR("ReactorTransport::send called from an event loop thread, use sendAsync instead");
+            response._error = "send called from event loop thread";
+            return false;
+        }
+
+        struct Waiter
+        {
+            std::mutex _mutex;
+            std::condition_variable _cond;
+            bool _done = false;
+            bool _ok = false;
+        };
+        auto waiter = std::make_shared<Waiter>();
+
+        // 调用方的 response 在完成前一直有效，用不持有所有权的 shared_ptr 包装
+        HttpResponsePtr responsePtr(std::shared_ptr<HttpResponse>(), &response);
+        sendAsync(request, responsePtr, bodyHandler, [waiter](bool ok)
+                  {
+            std::lock_guard<std::mutex> lock(waiter->_mutex);
+            waiter->_ok = ok;
+            waiter->_done = true;
+            waiter->_cond.notify_all(); }, cancelToken);
+
+        std::unique_lock<std::mutex> lock(waiter->_mutex);
+        waiter->_cond.wait(lock, [&]()
+                           { return waiter->_done; });
+        return waiter->_ok;
+    }
+
+} // end ai_chat_sdk
@@ -0,0 +1,277 @@
+#include "../../include/transport/StreamingBody.h"
+#include "../../include/util/myLog.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ai_chat_sdk
+{
+    namespace
+    {
+        const size_t kReadBufferSize = 16384;   // 非连续数据源每次读取的字节数
+        const size_t kMappedChunkSize = 65536;  // 连续数据源每次处理的字节数 (不复制)
+
+        bool isPlain(unsigned char c)
+        {
+            return c >= 0x20 && c != '"' && c != '\\';
+        }
+
+        // 与 JsonWriter 相同的转义规则，返回转义序列长度
+        size_t escapeChar(unsigned char c, char *out)
+        {
+            static const char hex[] = "0123456789abcdef";
+            switch (c)
+            {
+            case '"':
+                std::memcpy(out, "\\\"", 2);
+                return 2;
+            case '\\':
+                std::memcpy(out, "\\\\", 2);
+                return 2;
+            case '\n':
+                std::memcpy(out, "\\n", 2);
+                return 2;
+            case '\r':
+                std::memcpy(out, "\\r", 2);
+                return 2;
+            case '\t':
+                std::memcpy(out, "\\t", 2);
+                return 2;
+            case '\b':
+                std::memcpy(out, "\\b", 2);
+                return 2;
+            case '\f':
+                std::memcpy(out, "\\f", 2);
+                return 2;
+            default:
+                std::memcpy(out, "\\u00", 4);
+                out[4] = hex[c >> 4];
+                out[5] = hex[c & 0xF];
+                return 6;
+            }
+        }
+    }
+
+    StreamingBody::StreamingBody(std::string json, std::vector<BodySplice> splices)
+        : _json(std::move(json)), _splices(std::move(splices))
+    {
+        std::stable_sort(_splices.begin(), _splices.end(), [](const BodySplice &a, const BodySplice &b)
+                         { return a._offset < b._offset; });
+    }
+
+    bool StreamingBody::toString(std::string &out) const
+    {
+        // Reader 只需要共享所有权来延长生命周期，这里调用方保证 *this 有效
+        Reader reader(std::shared_ptr<const StreamingBody>(std::shared_ptr<const StreamingBody>(), this));
+        out.clear();
+        char buf[kReadBufferSize];
+        while (true)
+        {
+            ssize_t n = reader.read(buf, sizeof(buf));
+            if (n < 0)
+                return false;
+            if (n == 0)
+                return true;
+            out.append(buf, static_cast<size_t>(n));
+        }
+    }
+
+    StreamingBody::Reader::Reader(std::shared_ptr<const StreamingBody> body, std::function<void()> onProgress)
+        : _body(std::move(body)), _onProgress(std::move(onProgress))
+    {
+    }
+
+    ssize_t StreamingBody::Reader::read(char *buf, size_t len)
+    {
+        const std::string &json = _body->_json;
+        const std::vector<BodySplice> &splices = _body->_splices;
+        size_t n = 0;
+        while (n < len)
+        {
+            // 1. 先写出上次放不下的转义序列
+            if (_pendingPos < _pendingLen)
+            {
+                size_t count = std::min(len - n, _pendingLen - _pendingPos);
+                std::memcpy(buf + n, _pending + _pendingPos, count);
+                _pendingPos += count;
+                n += count;
+                continue;
+            }
+            _pendingPos = _pendingLen = 0;
+
+            // 2. 骨架：输出到下一个插入点为止
+            if (!_inContent)
+            {
+                size_t end = _index < splices.size() ? std::min(splices[_index]._offset, json.size()) : json.size();
+                if (_jsonPos < end)
+                {
+                    size_t count = std::min(len - n, end - _jsonPos);
+                    std::memcpy(buf + n, json.data() + _jsonPos, count);
+                    _jsonPos += count;
+                    n += count;
+                    continue;
+                }
+                if (_index >= splices.size())
+                    break; // 全部写完
+                _inContent = true;
+                _sourceEof = false;
+                _pendingCR = false;
+                _sourceOffset = 0;
+                _chunkPos = _chunkLen = 0;
+                if (!splices[_index]._raw)
+                    stash("\"", 1);
+                continue;
+            }
+
+            // 3. 外部内容：转义当前数据块 (原样插入时直接复制)
+            if (_chunkPos < _chunkLen)
+            {
+                // 映射内存：访问前确认本次要读的范围未被截断，否则会触发 SIGBUS
+                // 每次最多消耗 len - n 字节输入 (转义只会变长)
+                uint64_t chunkStart = _sourceOffset - _chunkLen;
+                if (_chunkMapped && !splices[_index]._source->dataValid(chunkStart + std::min(_chunkLen, _chunkPos + (len - n))))
+                {
+                    ERR("StreamingBody: {} changed at offset {}", splices[_index]._source->identity(), chunkStart + _chunkPos);
+                    return -1;
+                }
+                if (splices[_index]._raw)
+                {
+                    size_t count = std::min(len - n, _chunkLen - _chunkPos);
+                    std::memcpy(buf + n, _chunk + _chunkPos, count);
+                    _chunkPos += count;
+                    n += count;
+                }
+                else
+                {
+                    n += escape(buf + n, len - n);
+                }
+                continue;
+            }
+
+            // 4. 当前数据块用完，读取下一块
+            const ContentSource &source = *splices[_index]._source;
+            if (!_sourceEof)
+            {
+                if (const char *data = source.data())
+                {
+                    uint64_t size = static_cast<uint64_t>(std::max<int64_t>(source.size(), 0));
+                    _chunk = data + _sourceOffset;
+                    _chunkLen = static_cast<size_t>(std::min<uint64_t>(kMappedChunkSize, size - std::min(size, _sourceOffset)));
+                    _chunkMapped = true;
+                }
+                else
+                {
+                    if (!_buffer)
+                        _buffer.reset(new char[kReadBufferSize]);
+                    ssize_t got = source.read(_sourceOffset, _buffer.get(), kReadBufferSize);
+                    if (got < 0)
+                    {
+                        ERR("StreamingBody: read {} failed at offset {}", source.identity(), _sourceOffset);
+                        return -1;
+                    }
+                    _chunk = _buffer.get();
+                    _chunkLen = static_cast<size_t>(got);
+                    _chunkMapped = false;
+                }
+                _chunkPos = 0;
+                _sourceOffset += _chunkLen;
+                _sourceEof = _chunkLen == 0;
+                continue;
+            }
+
+            // 5. 数据源结束：补上末尾单独的 \r 与右引号
+            if (_pendingCR)
+            {
+                _pendingCR = false;
+                stash("\\r", 2);
+            }
+            if (!splices[_index]._raw)
+                stash("\"", 1);
+            _inContent = false;
+            ++_index;
+        }
+        if (n > 0 && _onProgress)
+            _onProgress();
+        return static_cast<ssize_t>(n);
+    }
+
+    size_t StreamingBody::Reader::escape(char *out, size_t len)
+    {
+        bool normalize = _body->_splices[_index]._normalizeNewlines;
+        size_t n = 0;
+        while (n < len && _chunkPos < _chunkLen)
+        {
+            unsigned char c = static_cast<unsigned char>(_chunk[_chunkPos]);
+
+            // 1. 上一个字符是 \r：后面紧跟 \n 时丢弃，否则照常转义
+            if (_pendingCR)
+            {
+                _pendingCR = false;
+                if (c != '\n')
+                {
+                    char escaped[8];
+                    size_t count = escapeChar('\r', escaped);
+                    size_t direct = std::min(count, len - n);
+                    std::memcpy(out + n, escaped, direct);
+                    n += direct;
+                    if (direct < count)
+                    {
+                        stash(escaped + direct, count - direct);
+                        return n;
+                    }
+                    continue;
+                }
+            }
+
+            // 2. 连续的普通字符整段复制
+            if (isPlain(c))
+            {
+                size_t end = _chunkPos + 1;
+                size_t limit = _chunkPos + std::min(len - n, _chunkLen - _chunkPos);
+                while (end < limit && isPlain(static_cast<unsigned char>(_chunk[end])))
+                    ++end;
+                std::memcpy(out + n, _chunk + _chunkPos, end - _chunkPos);
+                n += end - _chunkPos;
+                _chunkPos = end;
+                continue;
+            }
+
+            // 3. 需要转义的字符，放不下的部分暂存
+            ++_chunkPos;
+            if (c == '\r' && normalize)
+            {
+                _pendingCR = true;
+                continue;
+            }
+            char escaped[8];
+            size_t count = escapeChar(c, escaped);
+            size_t direct = std::min(count, len - n);
+            std::memcpy(out + n, escaped, direct);
+            n += direct;
+            if (direct < count)
+            {
+                stash(escaped + direct, count - direct);
+                return n;
+            }
+        }
+        return n;
+    }
+
+    void StreamingBody::Reader::stash(const char *text, size_t len)
+    {
+        std::memcpy(_pending + _pendingLen, text, len);
+        _pendingLen += len;
+    }
+
+    void assignRequestBody(HttpRequest &request, std::string_view json, std::vector<BodySplice> splices)
+    {
+        if (splices.empty())
+        {
+            request._body.assign(json);
+            request._streamingBody.reset();
+            return;
+        }
+        request._body.clear();
+        request._streamingBody = std::make_shared<StreamingBody>(std::string(json), std::move(splices));
+    }
+
+} // end ai_chat_sdk
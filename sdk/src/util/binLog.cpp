@@ -0,0 +1,458 @@
+#include "../../include/util/binLog.h"
+#include <spdlog/details/log_msg.h>
+#include <algorithm>
+#include <cstdlib>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace mylog
+{
+    namespace binlog
+    {
+        namespace
+        {
+            // 记录在环中的前缀：记录长度 (含前缀，按 8 字节对齐)
+            // kWrapMarker 表示环尾剩余空间不足，读端应跳到环头
+            const uint32_t kWrapMarker = 0xFFFFFFFFu;
+            const size_t kAlign = 8;
+
+            size_t alignUp(size_t size)
+            {
+                return (size + kAlign - 1) & ~(kAlign - 1);
+            }
+
+            // 单生产者单消费者字节环：生产者是所属线程，消费者是后台线程
+            class ThreadRing
+            {
+            public:
+                ThreadRing(size_t capacity, uint32_t threadIndex)
+                    : _capacity(capacity), _mask(capacity - 1), _buffer(new char[capacity]), _threadIndex(threadIndex)
+                {
+                }
+
+                // 生产者：预留 recordSize 字节 (不含长度前缀)
+                char *reserve(size_t recordSize)
+                {
+                    size_t need = alignUp(recordSize + sizeof(uint64_t));
+                    size_t head = _head.load(std::memory_order_relaxed);
+                    size_t tail = _tail.load(std::memory_order_acquire);
+                    size_t pos = head & _mask;
+                    size_t padding = (pos + need > _capacity) ? _capacity - pos : 0;
+
+                    if (need > _capacity || _capacity - (head - tail) < padding + need)
+                    {
+                        _dropped.fetch_add(1, std::memory_order_relaxed);
+                        return nullptr;
+                    }
+
+                    if (padding > 0)
+                    {
+                        std::memcpy(_buffer.get() + pos, &kWrapMarker, sizeof(kWrapMarker));
+                        head += padding;
+                        pos = 0;
+                    }
+
+                    uint32_t size32 = static_cast<uint32_t>(need);
+                    std::memcpy(_buffer.get() + pos, &size32, sizeof(size32));
+                    _pendingHead = head + need;
+                    return _buffer.get() + pos + sizeof(uint64_t);
+                }
+
+                // 生产者：发布记录，消费者此后可见
+                void commit()
+                {
+                    _head.store(_pendingHead, std::memory_order_release);
+                }
+
+                // 消费者：依次处理已发布的记录，返回处理条数
+                template <typename Fn>
+                size_t drain(Fn &&fn)
+                {
+                    size_t count = 0;
+                    size_t tail = _tail.load(std::memory_order_relaxed);
+                    size_t head = _head.load(std::memory_order_acquire);
+                    while (tail != head)
+                    {
+                        size_t pos = tail & _mask;
+                        uint32_t size32;
+                        std::memcpy(&size32, _buffer.get() + pos, sizeof(size32));
+                        if (size32 == kWrapMarker)
+                        {
+                            tail += _capacity - pos;
+                            continue;
+                        }
+                        fn(_buffer.get() + pos + sizeof(uint64_t));
+                        tail += size32;
+                        ++count;
+                    }
+                    _tail.store(tail, std::memory_order_release);
+                    return count;
+                }
+
+                bool empty() const
+                {
+                    return _tail.load(std::memory_order_acquire) == _head.load(std::memory_order_acquire);
+                }
+
+                uint64_t takeDropped() { return _dropped.exchange(0, std::memory_order_relaxed); }
+                uint32_t threadIndex() const { return _threadIndex; }
+                void retire() { _retired.store(true, std::memory_order_release); }
+                bool retired() const { return _retired.load(std::memory_order_acquire); }
+
+            private:
+                const size_t _capacity;
+                const size_t _mask;
+                std::unique_ptr<char[]> _buffer;
+                const uint32_t _threadIndex;
+
+                // 生产者与消费者各自频繁写的索引放在不同缓存行，避免伪共享
+                alignas(64) std::atomic<size_t> _head{0};
+                size_t _pendingHead = 0;
+                alignas(64) std::atomic<size_t> _tail{0};
+                alignas(64) std::atomic<uint64_t> _dropped{0};
+                std::atomic<bool> _retired{false};
+            };
+
+            // 后台线程解码后的一条日志
+            struct Entry
+            {
+                int64_t _timestampNs;
+                const LogSite *_site;
+                uint32_t _threadIndex;
+                std::string _text;
+            };
+
+            // JSON 字符串转义
+            void appendJsonString(std::string &out, std::string_view text)
+            {
+                out += '"';
+                for (unsigned char c : text)
+                {
+                    switch (c)
+                    {
+                    case '"':
+                        out += "\\\"";
+                        break;
+                    case '\\':
+                        out += "\\\\";
+                        break;
+                    case '\n':
+                        out += "\\n";
+                        break;
+                    case '\r':
+                        out += "\\r";
+                        break;
+                    case '\t':
+                        out += "\\t";
+                        break;
+                    default:
+                        if (c < 0x20)
+                            out += fmt::format("\\u{:04x}", c);
+                        else
+                            out += static_cast<char>(c);
+                    }
+                }
+                out += '"';
+            }
+
+            class JsonFormatter final : public spdlog::formatter
+            {
+            public:
+                void format(const spdlog::details::log_msg &msg, spdlog::memory_buf_t &dest) override
+                {
+                    std::string line = fmt::format("{{\"ts\":{},\"logger\":",
+                                                   std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count());
+                    appendJsonString(line, std::string_view(msg.logger_name.data(), msg.logger_name.size()));
+                    line += ",\"level\":";
+                    spdlog::string_view_t level = spdlog::level::to_string_view(msg.level);
+                    appendJsonString(line, std::string_view(level.data(), level.size()));
+                    line += fmt::format(",\"thread\":{}", msg.thread_id);
+                    if (!msg.source.empty())
+                    {
+                        line += ",\"file\":";
+                        appendJsonString(line, msg.source.filename);
+                        line += fmt::format(",\"line\":{}", msg.source.line);
+                    }
+                    line += ",\"msg\":";
+                    appendJsonString(line, std::string_view(msg.payload.data(), msg.payload.size()));
+                    line += "}\n";
+                    dest.append(line.data(), line.data() + line.size());
+                }
+
+                std::unique_ptr<spdlog::formatter> clone() const override
+                {
+                    return std::unique_ptr<spdlog::formatter>(new JsonFormatter());
+                }
+            };
+
+            class Backend
+            {
+            public:
+                void start(const std::string &loggerName, const std::vector<spdlog::sink_ptr> &sinks, size_t ringBytes)
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (_running)
+                        return;
+
+                    // 容量取 2 的幂，便于用掩码取模
+                    size_t capacity = 4096;
+                    while (capacity < ringBytes)
+                        capacity <<= 1;
+
+                    _loggerName = loggerName;
+                    _sinks = sinks;
+                    _ringBytes = capacity;
+                    _stopping = false;
+                    _running = true;
+                    _thread = std::thread([this]()
+                                          { run(); });
+
+                    // 进程退出前取空缓冲区，避免丢失最后的日志
+                    static bool registered = false;
+                    if (!registered)
+                    {
+                        registered = true;
+                        std::atexit([]()
+                                    { binlog::stop(); });
+                    }
+                }
+
+                void stop()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        if (!_running)
+                            return;
+                        _stopping = true;
+                    }
+                    _wakeup.notify_one();
+                    _thread.join();
+
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _running = false;
+                }
+
+                bool running() const { return _running.load(std::memory_order_acquire); }
+
+                // 后端未运行时的写入：没有后台线程输出提示，只计数
+                void countDropped() { _dropped.fetch_add(1, std::memory_order_relaxed); }
+
+                std::shared_ptr<ThreadRing> createRing()
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    auto ring = std::make_shared<ThreadRing>(_ringBytes, _nextThreadIndex++);
+                    _rings.push_back(ring);
+                    return ring;
+                }
+
+                Stats stats()
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    Stats result;
+                    result._written = _written.load(std::memory_order_relaxed);
+                    result._dropped = _dropped.load(std::memory_order_relaxed);
+                    result._threads = _rings.size();
+                    return result;
+                }
+
+            private:
+                void run()
+                {
+                    std::vector<Entry> batch;
+                    while (true)
+                    {
+                        bool stopping = false;
+                        {
+                            std::lock_guard<std::mutex> lock(_mutex);
+                            stopping = _stopping;
+                        }
+
+                        collect(batch);
+                        if (!batch.empty())
+                        {
+                            output(batch);
+                            batch.clear();
+                            continue;
+                        }
+                        if (stopping)
+                            break;
+
+                        // 空闲时短暂休眠；生产者从不通知后台线程，写入路径上没有系统调用
+                        std::unique_lock<std::mutex> lock(_mutex);
+                        _wakeup.wait_for(lock, std::chrono::milliseconds(1), [this]()
+                                         { return _stopping; });
+                    }
+                    for (auto &sink : _sinks)
+                        sink->flush();
+                }
+
+                // 从所有线程缓冲区取出记录并解码
+                void collect(std::vector<Entry> &batch)
+                {
+                    std::vector<std::shared_ptr<ThreadRing>> rings;
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        rings = _rings;
+                    }
+
+                    for (auto &ring : rings)
+                    {
+                        bool retired = ring->retired();
+                        ring->drain([&](const char *record)
+                                    {
+                            RecordHeader header;
+                            std::memcpy(&header, record, sizeof(header));
+                            const char *cursor = record + sizeof(header);
+
+                            ArgStore store;
+                            store.push_back(header._site->_file);
+                            store.push_back(header._site->_line);
+                            header._decode(cursor, store);
+
+                            Entry entry;
+                            entry._timestampNs = header._timestampNs;
+                            entry._site = header._site;
+                            entry._threadIndex = ring->threadIndex();
+                            try
+                            {
+                                entry._text = fmt::vformat(header._site->_format, store);
+                            }
+                            catch (const std::exception &e)
+                            {
+                                entry._text = header._site->_format + " <format error: " + e.what() + ">";
+                            }
+                            batch.push_back(std::move(entry)); });
+
+                        uint64_t dropped = ring->takeDropped();
+                        if (dropped > 0)
+                        {
+                            _dropped.fetch_add(dropped, std::memory_order_relaxed);
+                            Entry entry;
+                            entry._timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                     std::chrono::system_clock::now().time_since_epoch())
+                                                     .count();
+                            entry._site = nullptr;
+                            entry._threadIndex = ring->threadIndex();
+                            entry._text = fmt::format("binlog: thread #{} dropped {} records (ring full)", ring->threadIndex(), dropped);
+                            batch.push_back(std::move(entry));
+                        }
+
+                        // 线程已退出且缓冲区已取空，移除
+                        if (retired && ring->empty())
+                        {
+                            std::lock_guard<std::mutex> lock(_mutex);
+                            _rings.erase(std::remove(_rings.begin(), _rings.end(), ring), _rings.end());
+                        }
+                    }
+
+                    // 各线程缓冲区之间按时间戳归并
+                    std::stable_sort(batch.begin(), batch.end(), [](const Entry &a, const Entry &b)
+                                     { return a._timestampNs < b._timestampNs; });
+                }
+
+                void output(const std::vector<Entry> &batch)
+                {
+                    for (const auto &entry : batch)
+                    {
+                        spdlog::level::level_enum level = entry._site ? entry._site->_level : spdlog::level::warn;
+                        spdlog::log_clock::time_point time{std::chrono::duration_cast<spdlog::log_clock::duration>(
+                            std::chrono::nanoseconds(entry._timestampNs))};
+                        spdlog::source_loc source;
+                        if (entry._site)
+                            source = spdlog::source_loc{entry._site->_file, entry._site->_line, ""};
+
+                        // 格式 (文本或 JSON) 由 sink 的 formatter 在后台线程完成
+                        spdlog::details::log_msg msg(time, source, _loggerName, level, entry._text);
+                        msg.thread_id = entry._threadIndex;
+                        for (auto &sink : _sinks)
+                        {
+                            if (sink->should_log(level))
+                                sink->log(msg);
+                        }
+                    }
+                    _written.fetch_add(batch.size(), std::memory_order_relaxed);
+
+                    // 批量写入后统一刷新
+                    for (auto &sink : _sinks)
+                        sink->flush();
+                }
+
+            private:
+                std::mutex _mutex;
+                std::condition_variable _wakeup;
+                std::thread _thread;
+                std::atomic<bool> _running{false};
+                bool _stopping = false;
+
+                std::string _loggerName;
+                std::vector<spdlog::sink_ptr> _sinks;
+                size_t _ringBytes = 1 << 20;
+
+                std::vector<std::shared_ptr<ThreadRing>> _rings;
+                uint32_t _nextThreadIndex = 0;
+                std::atomic<uint64_t> _written{0};
+                std::atomic<uint64_t> _dropped{0};
+            };
+
+            Backend &backend()
+            {
+                // 故意不析构：线程局部的缓冲区可能在静态对象析构之后才释放
+                static Backend *instance = new Backend();
+                return *instance;
+            }
+
+            // 线程局部句柄：线程退出时标记缓冲区退役，由后台线程取空后回收
+            struct RingHandle
+            {
+                std::shared_ptr<ThreadRing> _ring;
+                ~RingHandle()
+                {
+                    if (_ring)
+                        _ring->retire();
+                }
+            };
+
+            thread_local RingHandle tlsRing;
+        }
+
+        char *reserve(size_t size)
+        {
+            // 后端已停止时不再写入缓冲区 (没有消费者)，直接计为丢弃
+            if (!backend().running())
+            {
+                backend().countDropped();
+                return nullptr;
+            }
+            if (!tlsRing._ring)
+                tlsRing._ring = backend().createRing();
+            return tlsRing._ring->reserve(size);
+        }
+
+        void commit()
+        {
+            tlsRing._ring->commit();
+        }
+
+        void start(const std::string &loggerName, const std::vector<spdlog::sink_ptr> &sinks, size_t ringBytes)
+        {
+            backend().start(loggerName, sinks, ringBytes);
+        }
+
+        void stop()
+        {
+            backend().stop();
+        }
+
+        Stats stats()
+        {
+            return backend().stats();
+        }
+
+        std::unique_ptr<spdlog::formatter> jsonFormatter()
+        {
+            return std::unique_ptr<spdlog::formatter>(new JsonFormatter());
+        }
+
+    } // end binlog
+} // end mylog
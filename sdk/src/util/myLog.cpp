@@ -2,6 +2,7 @@
 #include <memory>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/sinks/rotating_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/async.h>
 
@@ -9,16 +10,43 @@ namespace mylog
 {
     std::shared_ptr<spdlog::logger> Logger::_logger = nullptr;
     std::mutex Logger::_mutex;
+    std::atomic<bool> Logger::_binary{false};
 
     Logger::Logger()
     {
     }
 
-    void Logger::initLogger(const std::string &loggerName, const std::string &loggerFile, spdlog::level::level_enum logLevel)
+    void Logger::initLogger(const std::string &loggerName, const std::string &loggerFile, spdlog::level::level_enum logLevel,
+                            const LoggerOptions &options)
     {
         if (nullptr == _logger)
         {
             std::lock_guard<std::mutex> lock(_mutex);
+            if (nullptr == _logger && LogBackend::Binary == options._backend)
+            {
+                // 二进制后端：输出端由后台线程独占写入，这里的 logger 是同步的，
+                // 只用于级别过滤和兼容直接调用 getLogger()->info(...) 的代码
+                std::vector<spdlog::sink_ptr> sinks;
+                if ("stdout" == loggerFile)
+                {
+                    sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+                }
+                else
+                {
+                    // 按文件大小轮转
+                    sinks.push_back(std::make_shared<spdlog::sinks::rotating_file_sink_mt>(loggerFile, options._maxFileSize, options._maxFiles));
+                }
+                _logger = std::make_shared<spdlog::logger>(loggerName, sinks.begin(), sinks.end());
+                // JSON 输出使用独立的 formatter，后台线程的记录与直接调用 getLogger() 的日志都输出为 JSON 行
+                if (options._jsonOutput)
+                    _logger->set_formatter(mylog::binlog::jsonFormatter());
+                else
+                    _logger->set_pattern("[%H:%M:%S][%n][%-7l]%v");
+                _logger->set_level(logLevel);
+                mylog::binlog::start(loggerName, sinks, options._ringBytes);
+                _binary = true;
+                return;
+            }
             if (nullptr == _logger)
             {
                 // 设置全局自动刷新级别，当日志级别 ≥ logLevel 时，日志会被立即刷新到文件
@@ -0,0 +1,155 @@
+#include "../../include/util/vectorMath.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VECMATH_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define VECMATH_NEON 1
+#endif
+
+namespace ai_chat_sdk
+{
+    namespace vecmath
+    {
+        float dotScalar(const float *a, const float *b, size_t n)
+        {
+            float sum = 0.0f;
+            for (size_t i = 0; i < n; ++i)
+                sum += a[i] * b[i];
+            return sum;
+        }
+
+        namespace
+        {
+            using DotFn = float (*)(const float *, const float *, size_t);
+
+#if defined(VECMATH_X86)
+            // 每次处理 32 个元素，4 组累加器隐藏 FMA 延迟
+            __attribute__((target("avx2,fma"))) float dotAvx2(const float *a, const float *b, size_t n)
+            {
+                __m256 acc0 = _mm256_setzero_ps();
+                __m256 acc1 = _mm256_setzero_ps();
+                __m256 acc2 = _mm256_setzero_ps();
+                __m256 acc3 = _mm256_setzero_ps();
+                size_t i = 0;
+                for (; i + 32 <= n; i += 32)
+                {
+                    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+                    acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+                    acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+                    acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+                }
+                for (; i + 8 <= n; i += 8)
+                    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+
+                __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+                __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+                sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+                sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+                float result = _mm_cvtss_f32(sum);
+                for (; i < n; ++i)
+                    result += a[i] * b[i];
+                return result;
+            }
+
+            float dotSse2(const float *a, const float *b, size_t n)
+            {
+                __m128 acc0 = _mm_setzero_ps();
+                __m128 acc1 = _mm_setzero_ps();
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+                    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+                }
+                __m128 sum = _mm_add_ps(acc0, acc1);
+                sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+                sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+                float result = _mm_cvtss_f32(sum);
+                for (; i < n; ++i)
+                    result += a[i] * b[i];
+                return result;
+            }
+
+            DotFn resolveDot(const char **name)
+            {
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                {
+                    *name = "avx2";
+                    return dotAvx2;
+                }
+                *name = "sse2";
+                return dotSse2;
+            }
+#elif defined(VECMATH_NEON)
+            float dotNeon(const float *a, const float *b, size_t n)
+            {
+                float32x4_t acc0 = vdupq_n_f32(0.0f);
+                float32x4_t acc1 = vdupq_n_f32(0.0f);
+                size_t i = 0;
+                for (; i + 8 <= n; i += 8)
+                {
+                    acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+                    acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+                }
+                float result = vaddvq_f32(vaddq_f32(acc0, acc1));
+                for (; i < n; ++i)
+                    result += a[i] * b[i];
+                return result;
+            }
+
+            DotFn resolveDot(const char **name)
+            {
+                *name = "neon";
+                return dotNeon;
+            }
+#else
+            DotFn resolveDot(const char **name)
+            {
+                *name = "scalar";
+                return dotScalar;
+            }
+#endif
+
+            struct Kernels
+            {
+                const char *_name = "scalar";
+                DotFn _dot = dotScalar;
+
+                Kernels() { _dot = resolveDot(&_name); }
+            };
+
+            const Kernels &kernels()
+            {
+                static const Kernels instance;
+                return instance;
+            }
+        }
+
+        float dot(const float *a, const float *b, size_t n)
+        {
+            return kernels()._dot(a, b, n);
+        }
+
+        float normalize(float *v, size_t n)
+        {
+            float norm = std::sqrt(dot(v, v, n));
+            if (norm > 0.0f)
+            {
+                float inv = 1.0f / norm;
+                for (size_t i = 0; i < n; ++i)
+                    v[i] *= inv;
+            }
+            return norm;
+        }
+
+        const char *kernelName()
+        {
+            return kernels()._name;
+        }
+    }
+
+} // end ai_chat_sdk
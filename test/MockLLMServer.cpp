@@ -0,0 +1,567 @@
+#include "MockLLMServer.h"
+#include "../sdk/include/util/myLog.h"
+#include <jsoncpp/json/json.h>
+#include <httplib.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace ai_chat_sdk_test
+{
+    namespace
+    {
+        // 紧凑格式序列化
+        std::string writeJson(const Json::Value &value)
+        {
+            Json::StreamWriterBuilder writerBuilder;
+            writerBuilder["indentation"] = "";
+            return Json::writeString(writerBuilder, value);
+        }
+
+        bool parseJson(const std::string &text, Json::Value &value)
+        {
+            Json::CharReaderBuilder readerBuilder;
+            std::string errs;
+            std::istringstream ss(text);
+            return Json::parseFromStream(readerBuilder, ss, &value, &errs);
+        }
+
+        void sleepMs(double ms)
+        {
+            if (ms > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(ms * 1000)));
+            }
+        }
+    }
+
+    std::string StreamTrace::fullContent() const
+    {
+        // 录制的数据块是网络分包的结果，先拼接再按 SSE 消息切分
+        std::string raw;
+        for (const auto &chunk : _chunks)
+        {
+            raw += chunk._data;
+        }
+
+        std::string content;
+        size_t start = 0;
+        size_t pos = 0;
+        const std::string prefix = "data: ";
+        while ((pos = raw.find("\n\n", start)) != std::string::npos)
+        {
+            std::string event = raw.substr(start, pos - start);
+            start = pos + 2;
+            if (event.compare(0, prefix.size(), prefix) != 0)
+                continue;
+
+            Json::Value jsonResp;
+            if (!parseJson(event.substr(prefix.size()), jsonResp))
+                continue;
+            if (jsonResp.isMember("choices") && !jsonResp["choices"].empty())
+            {
+                auto choice = jsonResp["choices"][0];
+                if (choice.isMember("delta") && choice["delta"].isMember("content"))
+                {
+                    content += choice["delta"]["content"].asString();
+                }
+            }
+        }
+        return content;
+    }
+
+    double StreamTrace::totalMs() const
+    {
+        double total = 0;
+        for (const auto &chunk : _chunks)
+        {
+            total += chunk._delayMs;
+        }
+        return total;
+    }
+
+    bool saveTraces(const std::string &file, const std::vector<StreamTrace> &traces)
+    {
+        std::ofstream out(file, std::ios::trunc);
+        if (!out)
+        {
+            ERR("saveTraces: cannot open {}", file);
+            return false;
+        }
+
+        for (const auto &trace : traces)
+        {
+            Json::Value line;
+            line["status"] = trace._status;
+            Json::Value chunks(Json::arrayValue);
+            for (const auto &chunk : trace._chunks)
+            {
+                Json::Value item;
+                item["delay_ms"] = chunk._delayMs;
+                item["data"] = chunk._data;
+                chunks.append(item);
+            }
+            line["chunks"] = chunks;
+            out << writeJson(line) << "\n";
+        }
+        return static_cast<bool>(out);
+    }
+
+    bool loadTraces(const std::string &file, std::vector<StreamTrace> &traces)
+    {
+        std::ifstream in(file);
+        if (!in)
+        {
+            ERR("loadTraces: cannot open {}", file);
+            return false;
+        }
+
+        std::string text;
+        while (std::getline(in, text))
+        {
+            if (text.empty())
+                continue;
+
+            Json::Value line;
+            if (!parseJson(text, line))
+            {
+                WARN("loadTraces: skip invalid line in {}", file);
+                continue;
+            }
+
+            StreamTrace trace;
+            trace._status = line.get("status", 200).asInt();
+            for (const auto &item : line["chunks"])
+            {
+                TraceChunk chunk;
+                chunk._delayMs = item.get("delay_ms", 0.0).asDouble();
+                chunk._data = item.get("data", "").asString();
+                trace._chunks.push_back(chunk);
+            }
+            traces.push_back(trace);
+        }
+        return !traces.empty();
+    }
+
+    StreamTrace makeSyntheticTrace(const std::string &text, size_t chunkSize, double chunkDelayMs, double firstTokenMs)
+    {
+        StreamTrace trace;
+        if (chunkSize == 0)
+            chunkSize = 1;
+
+        size_t offset = 0;
+        while (offset < text.size())
+        {
+            // 不在 UTF-8 多字节字符中间切分
+            size_t end = std::min(text.size(), offset + chunkSize);
+            while (end < text.size() && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80)
+                ++end;
+
+            Json::Value delta;
+            delta["choices"][0]["index"] = 0;
+            delta["choices"][0]["delta"]["content"] = text.substr(offset, end - offset);
+
+            TraceChunk chunk;
+            chunk._delayMs = trace._chunks.empty() ? firstTokenMs : chunkDelayMs;
+            chunk._data = "data: " + writeJson(delta) + "\n\n";
+            trace._chunks.push_back(chunk);
+            offset = end;
+        }
+
+        TraceChunk done;
+        done._delayMs = chunkDelayMs;
+        done._data = "data: [DONE]\n\n";
+        trace._chunks.push_back(done);
+        return trace;
+    }
+
+    TraceRecorder::TraceRecorder(const std::string &endpoint, const std::string &apiKey, const std::string &path)
+        : _endpoint(endpoint), _apiKey(apiKey), _path(path)
+    {
+    }
+
+    bool TraceRecorder::record(const std::string &model, const std::string &prompt, StreamTrace &trace)
+    {
+        Json::Value requestBody;
+        requestBody["model"] = model;
+        requestBody["stream"] = true;
+        requestBody["messages"][0]["role"] = "user";
+        requestBody["messages"][0]["content"] = prompt;
+
+        httplib::Client client(_endpoint.c_str());
+        client.set_connection_timeout(30, 0);
+        client.set_read_timeout(300, 0);
+
+        httplib::Request req;
+        req.method = "POST";
+        req.path = _path;
+        req.headers = {
+            {"Authorization", "Bearer " + _apiKey},
+            {"Content-Type", "application/json"},
+            {"Accept", "text/event-stream"}};
+        req.body = writeJson(requestBody);
+
+        trace = StreamTrace();
+        auto last = std::chrono::steady_clock::now();
+        req.response_handler = [&](const httplib::Response &res)
+        {
+            trace._status = res.status;
+            return true;
+        };
+        req.content_receiver = [&](const char *data, size_t len, uint64_t /*offset*/, uint64_t /*total*/)
+        {
+            // 记录每个网络数据块相对上一块的到达间隔
+            auto now = std::chrono::steady_clock::now();
+            TraceChunk chunk;
+            chunk._delayMs = std::chrono::duration<double, std::milli>(now - last).count();
+            chunk._data.assign(data, len);
+            trace._chunks.push_back(chunk);
+            last = now;
+            return true;
+        };
+
+        auto res = client.send(req);
+        if (!res)
+        {
+            ERR("TraceRecorder: request failed: {}", to_string(res.error()));
+            return false;
+        }
+        INFO("TraceRecorder: status {}, {} chunks, {:.1f} ms", trace._status, trace._chunks.size(), trace.totalMs());
+        return trace._status == 200;
+    }
+
+    MockLLMServer::MockLLMServer(std::vector<StreamTrace> traces, const MockServerConfig &config)
+        : _traces(std::move(traces)), _config(config), _server(new httplib::Server()), _rng(config._seed)
+    {
+        if (_config._speedup <= 0)
+            _config._speedup = 1.0;
+        if (_traces.empty())
+        {
+            _traces.push_back(makeSyntheticTrace("Hello from MockLLMServer."));
+        }
+        setupRoutes();
+    }
+
+    MockLLMServer::~MockLLMServer()
+    {
+        stop();
+    }
+
+    int MockLLMServer::start(const std::string &host, int port)
+    {
+        _host = host;
+        if (port == 0)
+        {
+            _port = _server->bind_to_any_port(host);
+        }
+        else
+        {
+            _port = _server->bind_to_port(host, port) ? port : -1;
+        }
+        if (_port < 0)
+        {
+            ERR("MockLLMServer: bind {}:{} failed", host, port);
+            return -1;
+        }
+
+        _thread = std::thread([this]()
+                              { _server->listen_after_bind(); });
+        _server->wait_until_ready();
+        INFO("MockLLMServer listening on {}", endpoint());
+        return _port;
+    }
+
+    bool MockLLMServer::listen(const std::string &host, int port)
+    {
+        _host = host;
+        _port = port;
+        return _server->listen(host, port);
+    }
+
+    void MockLLMServer::stop()
+    {
+        if (_server && _server->is_running())
+        {
+            _server->stop();
+        }
+        if (_thread.joinable())
+        {
+            _thread.join();
+        }
+    }
+
+    std::string MockLLMServer::endpoint() const
+    {
+        return "http://" + _host + ":" + std::to_string(_port);
+    }
+
+    const StreamTrace &MockLLMServer::nextTrace()
+    {
+        return _traces[_next.fetch_add(1) % _traces.size()];
+    }
+
+    bool MockLLMServer::chance(double rate)
+    {
+        if (rate <= 0)
+            return false;
+        std::lock_guard<std::mutex> lock(_rngMutex);
+        return std::uniform_real_distribution<double>(0, 1)(_rng) < rate;
+    }
+
+    void MockLLMServer::setupRoutes()
+    {
+        // 每个连接占用一个工作线程，线程数按测试的并发量配置 (httplib 会立即创建全部线程)
+        size_t threads = std::max<size_t>(_config._threads, 1);
+        _server->new_task_queue = [threads]
+        { return new httplib::ThreadPool(threads); };
+
+        auto chatHandler = [this](const httplib::Request &req, httplib::Response &res)
+        {
+            ++_requests;
+            {
+                std::lock_guard<std::mutex> lock(_lastRequestMutex);
+                _lastRequestBody = req.body;
+            }
+
+            Json::Value requestBody;
+            bool stream = parseJson(req.body, requestBody) && requestBody.get("stream", false).asBool();
+            std::string model = requestBody.get("model", "mock-model").asString();
+
+            // 注入错误状态码
+            if (chance(_config._errorRate))
+            {
+                ++_injectedErrors;
+                res.status = _config._errorStatus;
+                res.set_content("{\"error\":{\"message\":\"injected fault\"}}", "application/json");
+                return;
+            }
+
+            const StreamTrace &trace = nextTrace();
+            if (!stream)
+            {
+                // 全量接口：等待整段录制的时长后一次性返回
+                sleepMs(trace.totalMs() / _config._speedup);
+                Json::Value body;
+                body["object"] = "chat.completion";
+                body["model"] = model;
+                body["choices"][0]["index"] = 0;
+                body["choices"][0]["message"]["role"] = "assistant";
+                body["choices"][0]["message"]["content"] = trace.fullContent();
+                body["choices"][0]["finish_reason"] = "stop";
+                // 按约 4 字节一个 token 估算用量
+                body["usage"]["prompt_tokens"] = Json::UInt64(req.body.size() / 4);
+                body["usage"]["completion_tokens"] = Json::UInt64(trace.fullContent().size() / 4);
+                body["usage"]["total_tokens"] = body["usage"]["prompt_tokens"].asUInt64() + body["usage"]["completion_tokens"].asUInt64();
+                res.status = trace._status;
+                res.set_content(writeJson(body), "application/json");
+                return;
+            }
+
+            // 流式接口：按录制的间隔逐块回放
+            // 中途断开和停顿的位置在请求开始时确定
+            size_t dropAt = chance(_config._dropRate) ? trace._chunks.size() / 2 : SIZE_MAX;
+            size_t stallAt = chance(_config._stallRate) ? trace._chunks.size() / 3 : SIZE_MAX;
+            if (dropAt != SIZE_MAX)
+                ++_injectedDrops;
+
+            auto index = std::make_shared<size_t>(0);
+            res.status = trace._status;
+            res.set_chunked_content_provider(
+                "text/event-stream",
+                [this, &trace, index, dropAt, stallAt](size_t /*offset*/, httplib::DataSink &sink)
+                {
+                    if (*index >= trace._chunks.size())
+                    {
+                        sink.done();
+                        return true;
+                    }
+                    if (*index == dropAt)
+                    {
+                        // 返回 false 让 httplib 直接关闭连接
+                        return false;
+                    }
+                    if (*index == stallAt)
+                    {
+                        sleepMs(_config._stallMs);
+                    }
+
+                    const TraceChunk &chunk = trace._chunks[*index];
+                    sleepMs(chunk._delayMs / _config._speedup);
+                    ++*index;
+                    return sink.write(chunk._data.data(), chunk._data.size());
+                });
+        };
+
+        auto responsesHandler = [this](const httplib::Request &req, httplib::Response &res)
+        {
+            ++_requests;
+
+            if (chance(_config._errorRate))
+            {
+                ++_injectedErrors;
+                res.status = _config._errorStatus;
+                res.set_content("{\"error\":{\"message\":\"injected fault\"}}", "application/json");
+                return;
+            }
+
+            // OpenAI Responses API 的返回结构：output[0].content[0].text
+            const StreamTrace &trace = nextTrace();
+            sleepMs(trace.totalMs() / _config._speedup);
+            Json::Value body;
+            body["object"] = "response";
+            body["output"][0]["type"] = "message";
+            body["output"][0]["role"] = "assistant";
+            body["output"][0]["content"][0]["type"] = "output_text";
+            body["output"][0]["content"][0]["text"] = trace.fullContent();
+            res.status = trace._status;
+            res.set_content(writeJson(body), "application/json");
+        };
+
+        // Batch API：上传请求文件
+        auto uploadHandler = [this](const httplib::Request &req, httplib::Response &res)
+        {
+            if (!req.has_file("file"))
+            {
+                res.status = 400;
+                res.set_content("{\"error\":{\"message\":\"missing file\"}}", "application/json");
+                return;
+            }
+            Json::Value body;
+            {
+                std::lock_guard<std::mutex> lock(_batchMutex);
+                std::string id = "file-" + std::to_string(_nextObjectId++);
+                _files[id] = req.get_file_value("file").content;
+                body["id"] = id;
+                body["bytes"] = Json::UInt64(_files[id].size());
+            }
+            body["object"] = "file";
+            body["purpose"] = "batch";
+            res.set_content(writeJson(body), "application/json");
+        };
+
+        // Batch API：创建批任务，逐行按录制内容生成结果，按 _errorRate 注入单行错误
+        auto createBatchHandler = [this](const httplib::Request &req, httplib::Response &res)
+        {
+            Json::Value request;
+            std::string input;
+            {
+                std::lock_guard<std::mutex> lock(_batchMutex);
+                auto it = parseJson(req.body, request) ? _files.find(request["input_file_id"].asString()) : _files.end();
+                if (it == _files.end())
+                {
+                    res.status = 404;
+                    res.set_content("{\"error\":{\"message\":\"input file not found\"}}", "application/json");
+                    return;
+                }
+                input = it->second;
+            }
+
+            MockBatch batch;
+            std::string output;
+            std::string errors;
+            std::istringstream lines(input);
+            std::string line;
+            while (std::getline(lines, line))
+            {
+                Json::Value item;
+                if (!parseJson(line, item))
+                    continue;
+                ++_requests;
+                ++batch._total;
+                Json::Value result;
+                result["custom_id"] = item["custom_id"];
+                if (chance(_config._errorRate))
+                {
+                    ++_injectedErrors;
+                    ++batch._failed;
+                    result["response"]["status_code"] = _config._errorStatus;
+                    result["response"]["body"]["error"]["message"] = "injected fault";
+                    errors += writeJson(result) + "\n";
+                    continue;
+                }
+                const std::string content = nextTrace().fullContent();
+                result["response"]["status_code"] = 200;
+                Json::Value &body = result["response"]["body"];
+                body["object"] = "chat.completion";
+                body["model"] = item["body"]["model"];
+                body["choices"][0]["index"] = 0;
+                body["choices"][0]["message"]["role"] = "assistant";
+                body["choices"][0]["message"]["content"] = content;
+                body["usage"]["prompt_tokens"] = Json::UInt64(line.size() / 4);
+                body["usage"]["completion_tokens"] = Json::UInt64(content.size() / 4);
+                result["error"] = Json::nullValue;
+                output += writeJson(result) + "\n";
+            }
+
+            Json::Value body;
+            {
+                std::lock_guard<std::mutex> lock(_batchMutex);
+                batch._outputFileId = "file-" + std::to_string(_nextObjectId++);
+                _files[batch._outputFileId] = std::move(output);
+                if (!errors.empty())
+                {
+                    batch._errorFileId = "file-" + std::to_string(_nextObjectId++);
+                    _files[batch._errorFileId] = std::move(errors);
+                }
+                std::string id = "batch-" + std::to_string(_nextObjectId++);
+                _batches[id] = batch;
+                body["id"] = id;
+            }
+            ++_batchesCreated;
+            body["object"] = "batch";
+            body["status"] = "validating";
+            res.set_content(writeJson(body), "application/json");
+        };
+
+        auto getBatchHandler = [this](const httplib::Request &req, httplib::Response &res)
+        {
+            std::lock_guard<std::mutex> lock(_batchMutex);
+            auto it = _batches.find(req.matches[1]);
+            if (it == _batches.end())
+            {
+                res.status = 404;
+                res.set_content("{\"error\":{\"message\":\"batch not found\"}}", "application/json");
+                return;
+            }
+            MockBatch &batch = it->second;
+            bool done = batch._polls++ > 0;
+            Json::Value body;
+            body["id"] = it->first;
+            body["object"] = "batch";
+            body["status"] = done ? "completed" : "in_progress";
+            body["request_counts"]["total"] = Json::UInt64(batch._total);
+            body["request_counts"]["completed"] = Json::UInt64(done ? batch._total - batch._failed : 0);
+            body["request_counts"]["failed"] = Json::UInt64(done ? batch._failed : 0);
+            if (done)
+            {
+                body["output_file_id"] = batch._outputFileId;
+                if (!batch._errorFileId.empty())
+                    body["error_file_id"] = batch._errorFileId;
+            }
+            res.set_content(writeJson(body), "application/json");
+        };
+
+        auto fileContentHandler = [this](const httplib::Request &req, httplib::Response &res)
+        {
+            std::lock_guard<std::mutex> lock(_batchMutex);
+            auto it = _files.find(req.matches[1]);
+            if (it == _files.end())
+            {
+                res.status = 404;
+                res.set_content("{\"error\":{\"message\":\"file not found\"}}", "application/json");
+                return;
+            }
+            res.set_content(it->second, "application/jsonl");
+        };
+
+        _server->Post("/chat/completions", chatHandler);
+        _server->Post("/v1/chat/completions", chatHandler);
+        _server->Post("/v1/responses", responsesHandler);
+        _server->Post("/v1/files", uploadHandler);
+        _server->Post("/v1/batches", createBatchHandler);
+        _server->Get(R"(/v1/batches/([^/]+))", getBatchHandler);
+        _server->Get(R"(/v1/files/([^/]+)/content)", fileContentHandler);
+    }
+
+} // end ai_chat_sdk_test
@@ -0,0 +1,143 @@
+#pragma once
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace httplib
+{
+    class Server;
+}
+
+namespace ai_chat_sdk_test
+{
+    // 一个 SSE 数据块：距离上一块的间隔 + 原始字节
+    struct TraceChunk
+    {
+        double _delayMs = 0; // 距离上一块 (首块为距离请求发出) 的时间间隔，毫秒
+        std::string _data;   // 原始 SSE 字节，例如 "data: {...}\n\n"
+    };
+
+    // 一次完整的流式响应录制结果
+    struct StreamTrace
+    {
+        int _status = 200;               // HTTP 状态码
+        std::vector<TraceChunk> _chunks; // 按到达顺序排列的数据块
+
+        // 从 SSE 数据块中还原完整回复 (用于全量接口的回放)
+        std::string fullContent() const;
+        // 总耗时，毫秒
+        double totalMs() const;
+    };
+
+    // 录制文件为 JSONL：每行一个 StreamTrace
+    bool saveTraces(const std::string &file, const std::vector<StreamTrace> &traces);
+    bool loadTraces(const std::string &file, std::vector<StreamTrace> &traces);
+
+    // 生成合成录制：把 text 按 chunkSize 个字节切块，每块间隔 chunkDelayMs
+    StreamTrace makeSyntheticTrace(const std::string &text, size_t chunkSize = 8, double chunkDelayMs = 20, double firstTokenMs = 200);
+
+    // 录制真实的 SSE 流 (DeepSeek / OpenAI Chat Completions 兼容接口)
+    class TraceRecorder
+    {
+    public:
+        TraceRecorder(const std::string &endpoint, const std::string &apiKey, const std::string &path = "/chat/completions");
+        // 发送一次流式请求并记录每个数据块的到达时间，失败返回 false
+        bool record(const std::string &model, const std::string &prompt, StreamTrace &trace);
+
+    private:
+        std::string _endpoint;
+        std::string _apiKey;
+        std::string _path;
+    };
+
+    // 故障注入与回放配置
+    struct MockServerConfig
+    {
+        double _speedup = 1.0;       // 回放加速倍数，2.0 表示两倍速
+        double _errorRate = 0.0;     // 直接返回 _errorStatus 的概率
+        int _errorStatus = 500;      // 注入的错误状态码 (如 429 / 500 / 503)
+        double _dropRate = 0.0;      // 流式响应中途断开连接的概率
+        double _stallRate = 0.0;     // 在某一块之前额外停顿 _stallMs 的概率
+        double _stallMs = 2000;      // 停顿时长，毫秒
+        unsigned _seed = 42;         // 随机数种子，保证多次运行可复现
+        size_t _threads = 16;        // 工作线程数：每个进行中的连接占用一个线程，应不小于预期的并发连接数
+    };
+
+    // 基于 httplib::Server 的本地模型服务，按录制文件回放
+    // 支持路径：/chat/completions、/v1/chat/completions (DeepSeek)、/v1/responses (OpenAI)
+    // 以及 OpenAI Batch API：/v1/files、/v1/batches、/v1/batches/{id}、/v1/files/{id}/content
+    // 批任务在创建时即执行完毕，第一次查询状态返回 in_progress，之后返回 completed
+    class MockLLMServer
+    {
+    public:
+        MockLLMServer(std::vector<StreamTrace> traces, const MockServerConfig &config = MockServerConfig());
+        ~MockLLMServer();
+
+        // 在后台线程启动服务，port 为 0 时自动选择端口，返回实际端口 (失败返回 -1)
+        int start(const std::string &host = "127.0.0.1", int port = 0);
+        // 在当前线程阻塞运行
+        bool listen(const std::string &host, int port);
+        void stop();
+
+        // 服务地址，例如 http://127.0.0.1:8089
+        std::string endpoint() const;
+
+        // 统计信息
+        uint64_t requestCount() const { return _requests.load(); }
+        uint64_t injectedErrors() const { return _injectedErrors.load(); }
+        uint64_t injectedDrops() const { return _injectedDrops.load(); }
+        uint64_t batchesCreated() const { return _batchesCreated.load(); }
+        // 最近一次对话请求的请求体 (chunked 请求体已由 httplib 还原)
+        std::string lastRequestBody() const
+        {
+            std::lock_guard<std::mutex> lock(_lastRequestMutex);
+            return _lastRequestBody;
+        }
+
+    private:
+        void setupRoutes();
+        // 轮流选取录制
+        const StreamTrace &nextTrace();
+        // 按概率抽样
+        bool chance(double rate);
+
+    private:
+        std::vector<StreamTrace> _traces;
+        MockServerConfig _config;
+        std::unique_ptr<httplib::Server> _server;
+        std::thread _thread;
+        std::string _host;
+        int _port = -1;
+
+        std::atomic<uint64_t> _next{0};
+        std::mutex _rngMutex;
+        std::mt19937 _rng;
+
+        std::atomic<uint64_t> _requests{0};
+        std::atomic<uint64_t> _injectedErrors{0};
+        std::atomic<uint64_t> _injectedDrops{0};
+        mutable std::mutex _lastRequestMutex;
+        std::string _lastRequestBody;
+
+        // Batch API 状态
+        struct MockBatch
+        {
+            std::string _outputFileId;
+            std::string _errorFileId;
+            uint64_t _total = 0;
+            uint64_t _failed = 0;
+            int _polls = 0;
+        };
+        std::mutex _batchMutex;
+        std::map<std::string, std::string> _files; // 文件ID -> 内容
+        std::map<std::string, MockBatch> _batches;  // 批任务ID -> 状态
+        uint64_t _nextObjectId = 1;
+        std::atomic<uint64_t> _batchesCreated{0};
+    };
+
+} // end ai_chat_sdk_test
@@ -0,0 +1,409 @@
+// 压测工具：录制真实 SSE 流 -> 本地模型服务回放 -> 闭环/开环压测
+//
+// 用法：
+//   loadTest record --endpoint https://api.deepseek.com --key $deepseek_apikey --prompt "..." --count 5 --out trace.jsonl
+//   loadTest serve  --trace trace.jsonl --port 8089 --speedup 2 --error-rate 0.01 --drop-rate 0.01
+//   loadTest run    --trace trace.jsonl --mode closed --concurrency 64 --requests 2000 --stream 1
+//   loadTest run    --target http://127.0.0.1:8089 --mode open --rate 200 --duration 30 --concurrency 256 --stream 1
+//   loadTest run    --trace trace.jsonl --concurrency 2000 --requests 20000 --transport reactor
+//
+// run 结束时额外输出每个请求的堆分配次数与内存池 (RequestArena) 使用量。
+//
+// run 未指定 --target 时会在进程内启动 MockLLMServer，服务端线程数由 --server-threads 指定 (默认按 --concurrency)。
+// 开环模式下 --concurrency 限制在途请求数，超出的到达请求排队等待。
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MockLLMServer.h"
+#include "../sdk/include/DeepSeekProvider.h"
+#include "../sdk/include/RequestArena.h"
+#include "../sdk/include/util/myLog.h"
+
+using namespace ai_chat_sdk_test;
+using Clock = std::chrono::steady_clock;
+
+// 统计进程内全部堆分配次数，用于衡量每个请求的分配开销
+static std::atomic<uint64_t> g_heapAllocations{0};
+
+void *operator new(size_t size)
+{
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    // 解析 --key value 形式的命令行参数
+    std::map<std::string, std::string> parseArgs(int argc, char **argv, int start)
+    {
+        std::map<std::string, std::string> args;
+        for (int i = start; i < argc; ++i)
+        {
+            std::string key = argv[i];
+            if (key.compare(0, 2, "--") != 0)
+                continue;
+            key = key.substr(2);
+            if (i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0)
+            {
+                args[key] = argv[++i];
+            }
+            else
+            {
+                args[key] = "1";
+            }
+        }
+        return args;
+    }
+
+    std::string getArg(const std::map<std::string, std::string> &args, const std::string &key, const std::string &def)
+    {
+        auto it = args.find(key);
+        return it == args.end() ? def : it->second;
+    }
+
+    double msSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // 单个请求的测量结果
+    struct Sample
+    {
+        bool _ok = false;
+        double _latencyMs = 0; // 从 (计划) 发出到完成
+        double _ttftMs = -1;   // 首个增量到达时间，非流式为 -1
+        size_t _bytes = 0;     // 回复长度
+    };
+
+    // 有锁的样本收集器
+    class Collector
+    {
+    public:
+        void add(const Sample &sample)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _samples.push_back(sample);
+        }
+
+        std::vector<Sample> samples()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _samples;
+        }
+
+    private:
+        std::mutex _mutex;
+        std::vector<Sample> _samples;
+    };
+
+    double percentile(std::vector<double> &values, double p)
+    {
+        if (values.empty())
+            return 0;
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+        rank = std::min(values.size(), std::max<size_t>(rank, 1));
+        return values[rank - 1];
+    }
+
+    void printDistribution(const char *name, std::vector<double> values)
+    {
+        if (values.empty())
+            return;
+        std::sort(values.begin(), values.end());
+        std::printf("  %-8s p50 %9.2f  p90 %9.2f  p99 %9.2f  p99.9 %9.2f  max %9.2f  (ms)\n", name,
+                    percentile(values, 50), percentile(values, 90), percentile(values, 99),
+                    percentile(values, 99.9), values.back());
+    }
+
+    void printReport(const std::vector<Sample> &samples, double elapsedMs)
+    {
+        std::vector<double> latency;
+        std::vector<double> ttft;
+        size_t ok = 0;
+        size_t bytes = 0;
+        for (const auto &sample : samples)
+        {
+            if (!sample._ok)
+                continue;
+            ++ok;
+            bytes += sample._bytes;
+            latency.push_back(sample._latencyMs);
+            if (sample._ttftMs >= 0)
+                ttft.push_back(sample._ttftMs);
+        }
+
+        double seconds = elapsedMs / 1000.0;
+        std::printf("requests: %zu  ok: %zu  failed: %zu  elapsed: %.2f s\n", samples.size(), ok, samples.size() - ok, seconds);
+        std::printf("throughput: %.1f req/s  %.1f KiB/s\n", ok / seconds, bytes / 1024.0 / seconds);
+        printDistribution("latency", latency);
+        printDistribution("ttft", ttft);
+    }
+
+    // 执行一次请求并测量
+    Sample runOne(ai_chat_sdk::LLMProvider &provider, const std::string &prompt, bool stream, Clock::time_point issuedAt)
+    {
+        std::vector<ai_chat_sdk::Message> messages = {{"user", prompt}};
+        std::map<std::string, std::string> requestParam = {{"temperature", "0.7"}, {"max_tokens", "2048"}};
+
+        Sample sample;
+        std::string reply;
+        if (stream)
+        {
+            auto onChunk = [&](const std::string &chunk, bool /*last*/)
+            {
+                if (!chunk.empty() && sample._ttftMs < 0)
+                    sample._ttftMs = msSince(issuedAt);
+            };
+            reply = provider.sendMessageStream(messages, requestParam, onChunk);
+        }
+        else
+        {
+            reply = provider.sendMessage(messages, requestParam);
+        }
+
+        sample._latencyMs = msSince(issuedAt);
+        sample._ok = !reply.empty();
+        sample._bytes = reply.size();
+        return sample;
+    }
+
+    int cmdRecord(const std::map<std::string, std::string> &args)
+    {
+        std::string endpoint = getArg(args, "endpoint", "https://api.deepseek.com");
+        std::string key = getArg(args, "key", "");
+        std::string out = getArg(args, "out", "trace.jsonl");
+        std::string model = getArg(args, "model", "deepseek-chat");
+        std::string prompt = getArg(args, "prompt", "请用 200 字介绍一下流式响应。");
+        int count = std::stoi(getArg(args, "count", "1"));
+        if (key.empty())
+        {
+            std::fprintf(stderr, "record: --key is required\n");
+            return 1;
+        }
+
+        TraceRecorder recorder(endpoint, key, getArg(args, "path", "/chat/completions"));
+        std::vector<StreamTrace> traces;
+        for (int i = 0; i < count; ++i)
+        {
+            StreamTrace trace;
+            if (recorder.record(model, prompt, trace))
+                traces.push_back(trace);
+        }
+        if (traces.empty() || !saveTraces(out, traces))
+        {
+            std::fprintf(stderr, "record: nothing recorded\n");
+            return 1;
+        }
+        std::printf("recorded %zu traces to %s\n", traces.size(), out.c_str());
+        return 0;
+    }
+
+    MockServerConfig serverConfig(const std::map<std::string, std::string> &args)
+    {
+        MockServerConfig config;
+        config._speedup = std::stod(getArg(args, "speedup", "1"));
+        config._errorRate = std::stod(getArg(args, "error-rate", "0"));
+        config._errorStatus = std::stoi(getArg(args, "error-status", "500"));
+        config._dropRate = std::stod(getArg(args, "drop-rate", "0"));
+        config._stallRate = std::stod(getArg(args, "stall-rate", "0"));
+        config._stallMs = std::stod(getArg(args, "stall-ms", "2000"));
+        config._seed = static_cast<unsigned>(std::stoul(getArg(args, "seed", "42")));
+        // 服务端线程数默认与客户端并发数相同 (每个连接一个线程)，另留少量余量
+        config._threads = std::stoul(getArg(args, "server-threads", std::to_string(std::stoi(getArg(args, "concurrency", "16")) + 8)));
+        return config;
+    }
+
+    std::vector<StreamTrace> traces(const std::map<std::string, std::string> &args)
+    {
+        std::vector<StreamTrace> result;
+        std::string file = getArg(args, "trace", "");
+        if (!file.empty())
+            loadTraces(file, result);
+        if (result.empty())
+            result.push_back(makeSyntheticTrace(std::string(600, 'x'), 8, 20, 300));
+        return result;
+    }
+
+    int cmdServe(const std::map<std::string, std::string> &args)
+    {
+        MockLLMServer server(traces(args), serverConfig(args));
+        std::string host = getArg(args, "host", "127.0.0.1");
+        int port = std::stoi(getArg(args, "port", "8089"));
+        std::printf("serving on http://%s:%d\n", host.c_str(), port);
+        return server.listen(host, port) ? 0 : 1;
+    }
+
+    int cmdRun(const std::map<std::string, std::string> &args)
+    {
+        std::string mode = getArg(args, "mode", "closed");
+        bool stream = getArg(args, "stream", "1") != "0";
+        std::string prompt = getArg(args, "prompt", "hello");
+        int concurrency = std::stoi(getArg(args, "concurrency", "16"));
+        int requests = std::stoi(getArg(args, "requests", "500"));
+        double rate = std::stod(getArg(args, "rate", "50"));
+        double duration = std::stod(getArg(args, "duration", "10"));
+
+        // 未指定目标时在进程内启动回放服务
+        std::unique_ptr<MockLLMServer> server;
+        std::string target = getArg(args, "target", "");
+        if (target.empty())
+        {
+            server.reset(new MockLLMServer(traces(args), serverConfig(args)));
+            if (server->start() < 0)
+                return 1;
+            target = server->endpoint();
+        }
+
+        ai_chat_sdk::DeepSeekProvider provider;
+        if (!provider.initModel({{"api_key", getArg(args, "key", "mock-key")},
+                                 {"endpoint", target},
+                                 {"transport", getArg(args, "transport", "httplib")}}))
+            return 1;
+
+        Collector collector;
+        auto start = Clock::now();
+        uint64_t heapBefore = g_heapAllocations.load();
+        auto arenaBefore = ai_chat_sdk::RequestArena::stats();
+
+        if (mode == "closed")
+        {
+            // 闭环：concurrency 个客户端，每个收到回复后立即发出下一个请求
+            std::atomic<int> issued{0};
+            std::vector<std::thread> workers;
+            for (int i = 0; i < concurrency; ++i)
+            {
+                workers.emplace_back([&]()
+                                     {
+                    while (issued.fetch_add(1) < requests)
+                    {
+                        collector.add(runOne(provider, prompt, stream, Clock::now()));
+                    } });
+            }
+            for (auto &worker : workers)
+                worker.join();
+        }
+        else
+        {
+            // 开环：按泊松过程到达，延迟从计划到达时刻起算，避免协同遗漏 (coordinated omission)
+            // 在途请求由 concurrency 个工作线程执行，全部忙碌时到达的请求排队，排队时间计入延迟
+            std::mt19937 rng(static_cast<unsigned>(std::stoul(getArg(args, "seed", "42"))));
+            std::exponential_distribution<double> gap(rate);
+            std::mutex mutex;
+            std::condition_variable cond;
+            std::deque<Clock::time_point> arrivals;
+            bool closed = false;
+            std::vector<std::thread> workers;
+            for (int i = 0; i < std::max(concurrency, 1); ++i)
+            {
+                workers.emplace_back([&]()
+                                     {
+                    while (true)
+                    {
+                        Clock::time_point scheduled;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            cond.wait(lock, [&]()
+                                      { return closed || !arrivals.empty(); });
+                            if (arrivals.empty())
+                                return;
+                            scheduled = arrivals.front();
+                            arrivals.pop_front();
+                        }
+                        collector.add(runOne(provider, prompt, stream, scheduled));
+                    } });
+            }
+            auto next = start;
+            auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(duration));
+            while (next < end)
+            {
+                std::this_thread::sleep_until(next);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    arrivals.push_back(next);
+                }
+                cond.notify_one();
+                next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(gap(rng)));
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            cond.notify_all();
+            for (auto &worker : workers)
+                worker.join();
+        }
+
+        printReport(collector.samples(), msSince(start));
+
+        // 分配统计：堆分配包含进程内回放服务，对比不同版本时保持相同的运行方式
+        double count = std::max<double>(requests, 1);
+        if (mode != "closed")
+            count = std::max<double>(collector.samples().size(), 1);
+        auto arenaAfter = ai_chat_sdk::RequestArena::stats();
+        std::printf("allocations: heap %.1f/req  arena %.1f/req (%.1f KiB/req)  arena refills %.2f/req\n",
+                    (g_heapAllocations.load() - heapBefore) / count,
+                    (arenaAfter._arenaAllocations - arenaBefore._arenaAllocations) / count,
+                    (arenaAfter._arenaBytes - arenaBefore._arenaBytes) / 1024.0 / count,
+                    (arenaAfter._upstreamAllocations - arenaBefore._upstreamAllocations) / count);
+        if (server)
+        {
+            std::printf("mock server: %lu requests, %lu injected errors, %lu injected drops\n",
+                        static_cast<unsigned long>(server->requestCount()),
+                        static_cast<unsigned long>(server->injectedErrors()),
+                        static_cast<unsigned long>(server->injectedDrops()));
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // 压测时只输出告警及以上日志，避免日志本身成为瓶颈
+    mylog::Logger::initLogger("loadTest", "stdout", spdlog::level::warn);
+
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s record|serve|run [--option value ...]\n", argv[0]);
+        return 1;
+    }
+
+    std::string command = argv[1];
+    auto args = parseArgs(argc, argv, 2);
+    if (command == "record")
+        return cmdRecord(args);
+    if (command == "serve")
+        return cmdServe(args);
+    if (command == "run")
+        return cmdRun(args);
+
+    std::fprintf(stderr, "unknown command: %s\n", command.c_str());
+    return 1;
+}
@@ -4,11 +4,38 @@
 #include <vector>
 #include <map>
 #include <cstdlib> // for std::getenv
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <jsoncpp/json/json.h>
+#include <atomic>
+#include <fstream>
+#include <set>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unistd.h>
+#include <sstream>
+#include <spdlog/sinks/ostream_sink.h>
 
 // 引入 SDK 头文件
 #include "../sdk/include/DeepSeekProvider.h"
 #include "../sdk/include/ChatGPTProvider.h"
 #include "../sdk/include/util/myLog.h"
+#include "../sdk/include/util/jsonWriter.h"
+#include "../sdk/include/RequestArena.h"
+#include "../sdk/include/PromptCache.h"
+#include "../sdk/include/SingleFlightProvider.h"
+#include "../sdk/include/BatchRunner.h"
+#include "../sdk/include/SemanticCache.h"
+#include "../sdk/include/util/vectorMath.h"
+#include "../sdk/include/transport/HttpTransport.h"
+#include "../sdk/include/transport/Http2Transport.h"
+#include "../sdk/include/transport/StreamingBody.h"
+#include "../sdk/include/ContentSource.h"
+#include "../sdk/include/JsonStreamParser.h"
+#include "MockLLMServer.h"
 
 // 测试用例：验证 DeepSeek 全量消息发送
 TEST(DeepSeekProviderTest, sendMessage)
@@ -144,6 +171,1241 @@ TEST(ChatGPTProviderTest, sendMessage)
     INFO("ChatGPT Response: {}", fullData);
 }
 
+// 测试用例：验证取消令牌——已取消的流式请求仍只收到一次结束回调
+TEST(CancelTokenTest, cancelledStreamDeliversFinalOnce)
+{
+    auto provider = std::make_shared<ai_chat_sdk::DeepSeekProvider>();
+    std::map<std::string, std::string> modelConfig = {{"api_key", "test-key"}};
+    ASSERT_TRUE(provider->initModel(modelConfig));
+
+    // 请求发出前就取消，不会产生任何网络访问
+    auto token = std::make_shared<ai_chat_sdk::CancelToken>();
+    token->cancel();
+
+    int finalCount = 0;
+    auto writeChunk = [&](const std::string &, bool last)
+    {
+        if (last)
+            ++finalCount;
+    };
+
+    uint64_t cancelledBefore = ai_chat_sdk::CancelToken::cancelledRequests();
+    std::string fullData = provider->sendMessageStream({{"user", "hello"}}, {}, writeChunk, token);
+
+    ASSERT_TRUE(fullData.empty());
+    ASSERT_EQ(finalCount, 1);
+    ASSERT_EQ(ai_chat_sdk::CancelToken::cancelledRequests(), cancelledBefore + 1);
+
+    // 已取消的令牌注册回调时立即执行
+    bool hookCalled = false;
+    ai_chat_sdk::CancelHookGuard guard(token, [&]()
+                                       { hookCalled = true; });
+    ASSERT_TRUE(hookCalled);
+}
+
+// 测试用例：本地回放服务——流式与全量接口都能还原录制内容，流式中途取消能及时结束
+TEST(MockLLMServerTest, replayAndCancel)
+{
+    const std::string text = "流式响应是指模型边生成边返回结果。";
+    ai_chat_sdk_test::MockLLMServer server({ai_chat_sdk_test::makeSyntheticTrace(text, 6, 50, 50)});
+    ASSERT_GT(server.start(), 0);
+
+    auto provider = std::make_shared<ai_chat_sdk::DeepSeekProvider>();
+    ASSERT_TRUE(provider->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}}));
+
+    std::vector<ai_chat_sdk::Message> messages = {{"user", "hello"}};
+    ASSERT_EQ(provider->sendMessage(messages, {}), text);
+    ASSERT_EQ(provider->sendMessageStream(messages, {}, nullptr), text);
+
+    // 收到第一个增量后取消，剩余数据不再接收
+    auto token = std::make_shared<ai_chat_sdk::CancelToken>();
+    int finalCount = 0;
+    auto onChunk = [&](const std::string &chunk, bool last)
+    {
+        if (!chunk.empty())
+            token->cancel();
+        if (last)
+            ++finalCount;
+    };
+    std::string partial = provider->sendMessageStream(messages, {}, onChunk, token);
+    ASSERT_LT(partial.size(), text.size());
+    ASSERT_EQ(finalCount, 1);
+}
+
+// 测试用例：二进制日志——环形缓冲区回绕不丢记录、写满时丢弃并计数、参数在后台线程格式化、JSON 输出每行合法
+TEST(BinaryLogTest, ringWrapDropsAndJson)
+{
+    std::ostringstream out;
+    auto sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(out);
+    sink->set_formatter(mylog::binlog::jsonFormatter());
+    // 与 Logger::initLogger 相同：直接调用 spdlog 日志器时同样输出 JSON
+    spdlog::logger direct("binlogTest", sink);
+    direct.set_formatter(mylog::binlog::jsonFormatter());
+    mylog::binlog::start("binlogTest", {sink}, 4096);
+
+    static const mylog::binlog::LogSite site(spdlog::level::info, __FILE__, __LINE__, "[{:>10s}:{:<4d}] record {:>5d} {}");
+    auto waitWritten = [](uint64_t target)
+    {
+        for (int i = 0; i < 2000 && mylog::binlog::stats()._written < target; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return mylog::binlog::stats()._written;
+    };
+
+    // 1. 每批 8 条，等后台线程取空再写下一批：4 KiB 的环回绕多次，一条不丢
+    const int kRecords = 400;
+    uint64_t written = mylog::binlog::stats()._written;
+    uint64_t dropped = mylog::binlog::stats()._dropped;
+    std::thread([&]()
+                {
+        for (int i = 0; i < kRecords; ++i)
+        {
+            std::string payload(40, static_cast<char>('a' + i % 26));
+            mylog::binlog::write(site, i, payload);
+            payload.assign("modified"); // 参数已复制进缓冲区，之后的修改不影响输出
+            if (i % 8 == 7)
+                waitWritten(written + i + 1);
+        } })
+        .join();
+    ASSERT_EQ(waitWritten(written + kRecords), written + kRecords);
+    ASSERT_EQ(mylog::binlog::stats()._dropped, dropped);
+
+    // 2. 不等待连续写入：环写满后丢弃并计数，后台线程输出一条丢弃提示
+    std::thread([&]()
+                {
+        for (int i = 0; i < 2000; ++i)
+            mylog::binlog::write(site, i, std::string(100, 'x')); })
+        .join();
+    for (int i = 0; i < 2000 && mylog::binlog::stats()._dropped == dropped; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_GT(mylog::binlog::stats()._dropped, dropped);
+    direct.info("direct {}", 42);
+    mylog::binlog::stop();
+
+    // 3. 停止后写入直接计为丢弃
+    dropped = mylog::binlog::stats()._dropped;
+    mylog::binlog::write(site, 0, std::string("after stop"));
+    ASSERT_EQ(mylog::binlog::stats()._dropped, dropped + 1);
+
+    // 4. 每行都是 JSON；记录按写入顺序、在后台线程格式化
+    std::istringstream lines(out.str());
+    std::string line;
+    int records = 0, dropNotices = 0, directLines = 0;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    while (std::getline(lines, line))
+    {
+        Json::Value value;
+        std::string error;
+        ASSERT_TRUE(reader->parse(line.data(), line.data() + line.size(), &value, &error)) << line;
+        std::string msg = value["msg"].asString();
+        if (msg == "direct 42")
+        {
+            ++directLines;
+            continue;
+        }
+        if (msg.find("dropped") != std::string::npos)
+        {
+            ++dropNotices;
+            continue;
+        }
+        ASSERT_EQ(value["level"].asString(), "info");
+        ASSERT_EQ(value["line"].asInt(), site._line);
+        if (records < kRecords)
+        {
+            std::string expected = fmt::format("record {:>5d} {}", records, std::string(40, static_cast<char>('a' + records % 26)));
+            ASSERT_NE(msg.find(expected), std::string::npos) << msg;
+        }
+        ++records;
+    }
+    ASSERT_GT(records, kRecords);
+    ASSERT_GE(dropNotices, 1);
+    ASSERT_EQ(directLines, 1);
+}
+
+// 测试用例：请求内存池——同一线程的请求复用内存池，小请求不访问堆；JsonWriter 输出合法 JSON
+TEST(RequestArenaTest, reuseAndJsonWriter)
+{
+    std::pmr::memory_resource *first = nullptr;
+    {
+        ai_chat_sdk::ArenaScope scope;
+        first = scope.resource();
+    }
+
+    auto before = ai_chat_sdk::RequestArena::stats();
+    std::string body;
+    {
+        ai_chat_sdk::ArenaScope scope;
+        ASSERT_EQ(scope.resource(), first);
+
+        // 嵌套作用域拿到独立的内存池
+        ai_chat_sdk::ArenaScope nested;
+        ASSERT_NE(nested.resource(), first);
+
+        ai_chat_sdk::JsonWriter writer(scope.resource());
+        writer.beginObject();
+        writer.key("model").value("deepseek-chat");
+        writer.key("messages").beginArray();
+        writer.beginObject().key("role").value("user").key("content").value("引号\"反斜杠\\换行\n\x01").endObject();
+        writer.endArray();
+        writer.key("temperature").value(0.7);
+        writer.key("max_tokens").value(2048);
+        writer.key("stream").value(true);
+        writer.endObject();
+        body.assign(writer.view());
+    }
+    auto after = ai_chat_sdk::RequestArena::stats();
+    ASSERT_EQ(after._scopes - before._scopes, 2u);
+    ASSERT_GT(after._arenaAllocations, before._arenaAllocations);
+    ASSERT_EQ(after._upstreamAllocations, before._upstreamAllocations); // 首块缓冲区足够，没有访问堆
+
+    ASSERT_EQ(body, R"({"model":"deepseek-chat","messages":[{"role":"user","content":"引号\"反斜杠\\换行\n\u0001"}],"temperature":0.7,"max_tokens":2048,"stream":true})");
+    Json::Value parsed;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    std::string errs;
+    ASSERT_TRUE(reader->parse(body.data(), body.data() + body.size(), &parsed, &errs));
+    ASSERT_EQ(parsed["messages"][0]["content"].asString(), "引号\"反斜杠\\换行\n\x01");
+
+    // 数字按最短可还原表示输出
+    ai_chat_sdk::JsonWriter numbers;
+    numbers.beginArray().value(0.1 + 0.2).value(1e21).value(-3).endArray();
+    ASSERT_EQ(numbers.view(), "[0.30000000000000004,1e+21,-3]");
+
+    // 其它线程 (包括已退出的线程) 的计数也汇总到 stats()
+    auto beforeThread = ai_chat_sdk::RequestArena::stats();
+    std::thread([]()
+                { ai_chat_sdk::ArenaScope scope; })
+        .join();
+    ASSERT_EQ(ai_chat_sdk::RequestArena::stats()._scopes - beforeThread._scopes, 1u);
+}
+
+// 测试用例：前缀缓存友好布局——追加历史后旧请求的序列化结果仍是新请求的前缀；usage 兼容三种格式
+TEST(PromptCacheTest, stablePrefixAndUsage)
+{
+    using ai_chat_sdk::RequestLayout;
+    auto serialize = [](const std::vector<ai_chat_sdk::Message> &messages)
+    {
+        ai_chat_sdk::JsonWriter writer;
+        writer.beginObject();
+        writer.key("model").value("deepseek-chat");
+        writer.key("messages");
+        ai_chat_sdk::writeMessages(writer, messages, RequestLayout::CacheAware);
+        writer.endObject();
+        return std::string(writer.view());
+    };
+
+    // \r\n 统一为 \n，追加历史后前缀不变
+    std::vector<ai_chat_sdk::Message> turn1 = {{"system", "你是助手"}, {"user", "你好\r\n"}};
+    std::vector<ai_chat_sdk::Message> turn2 = {{"system", "你是助手"}, {"user", "你好\n"}, {"assistant", "你好！"}, {"user", "再见"}};
+    std::string first = serialize(turn1);
+    std::string second = serialize(turn2);
+    ASSERT_EQ(first, R"({"model":"deepseek-chat","messages":[{"role":"system","content":"你是助手"},{"role":"user","content":"你好\n"}]})");
+    std::string prefix = first.substr(0, first.size() - 2); // 去掉 "]}"
+    ASSERT_EQ(second.compare(0, prefix.size(), prefix), 0);
+
+    // 中途插入的 system 消息保持原位置
+    std::string midSystem = serialize({{"user", "你好"}, {"system", "改用英文回答"}});
+    ASSERT_EQ(midSystem, R"({"model":"deepseek-chat","messages":[{"role":"user","content":"你好"},{"role":"system","content":"改用英文回答"}]})");
+    ASSERT_EQ(ai_chat_sdk::parseRequestLayout("cache_aware"), RequestLayout::CacheAware);
+    ASSERT_EQ(ai_chat_sdk::parseRequestLayout("unknown"), RequestLayout::Default);
+
+    auto parse = [](const std::string &text)
+    {
+        Json::Value root;
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        std::string errs;
+        reader->parse(text.data(), text.data() + text.size(), &root, &errs);
+        ai_chat_sdk::TokenUsage usage;
+        ai_chat_sdk::parseUsage(root, usage);
+        return usage;
+    };
+    // DeepSeek
+    auto usage = parse(R"({"prompt_tokens":100,"completion_tokens":20,"total_tokens":120,"prompt_cache_hit_tokens":64,"prompt_cache_miss_tokens":36})");
+    ASSERT_TRUE(usage._valid);
+    ASSERT_EQ(usage._promptTokens, 100);
+    ASSERT_EQ(usage._cachedPromptTokens, 64);
+    ASSERT_EQ(usage._totalTokens, 120);
+    // OpenAI Chat Completions
+    usage = parse(R"({"prompt_tokens":2006,"completion_tokens":300,"prompt_tokens_details":{"cached_tokens":1920}})");
+    ASSERT_EQ(usage._cachedPromptTokens, 1920);
+    ASSERT_EQ(usage._totalTokens, 2306);
+    // OpenAI Responses
+    usage = parse(R"({"input_tokens":1500,"output_tokens":50,"input_tokens_details":{"cached_tokens":1024}})");
+    ASSERT_EQ(usage._promptTokens, 1500);
+    ASSERT_EQ(usage._completionTokens, 50);
+    ASSERT_EQ(usage._cachedPromptTokens, 1024);
+    // 没有 usage
+    ASSERT_FALSE(parse("null")._valid);
+}
+
+// 测试用例：合并相同的在途请求——并发的相同请求只访问一次上游，流式调用方收到完整增量；失败结果同样共享
+TEST(SingleFlightTest, sharedUpstreamCall)
+{
+    const std::string text = "热门问题的回答会被所有并发请求共享。";
+    ai_chat_sdk_test::MockLLMServer server({ai_chat_sdk_test::makeSyntheticTrace(text, 6, 20, 300)});
+    ASSERT_GT(server.start(), 0);
+
+    auto provider = std::make_shared<ai_chat_sdk::SingleFlightProvider>(std::make_shared<ai_chat_sdk::DeepSeekProvider>());
+    ASSERT_TRUE(provider->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}}));
+
+    const int kCallers = 8;
+    std::vector<ai_chat_sdk::Message> messages = {{"user", "今天的热门话题是什么"}};
+    std::vector<std::string> results(kCallers);
+    std::vector<std::string> streamed(kCallers);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kCallers; ++i)
+    {
+        threads.emplace_back([&, i]()
+                             {
+                                 auto onChunk = [&, i](const std::string &chunk, bool last)
+                                 {
+                                     if (!last)
+                                         streamed[i] += chunk;
+                                 };
+                                 results[i] = provider->sendMessageStream(messages, {}, onChunk);
+                             });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    for (int i = 0; i < kCallers; ++i)
+    {
+        ASSERT_EQ(results[i], text);
+        ASSERT_EQ(streamed[i], text);
+    }
+    auto stats = provider->stats();
+    ASSERT_EQ(server.requestCount(), stats._upstreamCalls);
+    ASSERT_LT(stats._upstreamCalls, static_cast<uint64_t>(kCallers));
+    ASSERT_EQ(stats._upstreamCalls + stats._joined, static_cast<uint64_t>(kCallers));
+
+    // 关闭带随机性请求的合并后，未指定 temperature 的请求直接转发
+    ASSERT_TRUE(provider->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}, {"single_flight_sampled", "false"}}));
+    ASSERT_EQ(provider->sendMessage(messages, {}), text);
+    ASSERT_EQ(provider->stats()._bypassed, 1u);
+
+    // 工作线程只有一个时，不同的并发请求排队执行，结果不受影响
+    auto serialProvider = std::make_shared<ai_chat_sdk::SingleFlightProvider>(std::make_shared<ai_chat_sdk::DeepSeekProvider>());
+    ASSERT_TRUE(serialProvider->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}, {"single_flight_threads", "1"}}));
+    threads.clear();
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&, i]()
+                             { results[i] = serialProvider->sendMessage({{"user", "问题 " + std::to_string(i)}}, {}); });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    for (int i = 0; i < 4; ++i)
+        ASSERT_EQ(results[i], text);
+    ASSERT_EQ(serialProvider->stats()._upstreamCalls, 4u);
+
+    // 上游失败时所有调用方都拿到失败结果
+    ai_chat_sdk_test::MockServerConfig config;
+    config._errorRate = 1.0;
+    ai_chat_sdk_test::MockLLMServer failing({ai_chat_sdk_test::makeSyntheticTrace(text)}, config);
+    ASSERT_GT(failing.start(), 0);
+    auto failingProvider = std::make_shared<ai_chat_sdk::SingleFlightProvider>(std::make_shared<ai_chat_sdk::DeepSeekProvider>());
+    ASSERT_TRUE(failingProvider->initModel({{"api_key", "mock-key"}, {"endpoint", failing.endpoint()}}));
+    threads.clear();
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&, i]()
+                             { results[i] = failingProvider->sendMessage(messages, {{"temperature", "0"}}); });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    for (int i = 0; i < 4; ++i)
+        ASSERT_EQ(results[i], "");
+}
+
+// 测试用例：JSONL 批处理——从断点续跑 (跳过已完成行、丢弃写了一半的行)，以及 OpenAI Batch API 模式
+TEST(BatchRunnerTest, resumeAndBatchApi)
+{
+    const std::string text = "批处理回复";
+    ai_chat_sdk_test::MockLLMServer server({ai_chat_sdk_test::makeSyntheticTrace(text, 8, 1, 5)});
+    ASSERT_GT(server.start(), 0);
+
+    const int kLines = 50;
+    const std::string input = testing::TempDir() + "batch_input.jsonl";
+    const std::string output = testing::TempDir() + "batch_output.jsonl";
+    {
+        std::ofstream in(input, std::ios::trunc);
+        for (int i = 0; i < kLines; ++i)
+        {
+            if (i == 7)
+                in << "{not json}\n";
+            else if (i == 9)
+                in << "{\"id\":\"q9\",\"messages\":[\"hi\"]}\n"; // 消息不是对象
+            else if (i == 3)
+                in << "{\"id\":\"q3\",\"messages\":[{\"role\":\"user\",\"content\":[{\"type\":\"text\",\"text\":\"问题 3\"}]}]}\n";
+            else
+                in << "{\"id\":\"q" << i << "\",\"prompt\":\"问题 " << i << "\",\"params\":{\"temperature\":0}}\n";
+            if (i % 10 == 0)
+                in << "\n"; // 空行不计入行号
+        }
+    }
+    // 模拟上次 (乱序写出的) 运行在写第三行时崩溃
+    {
+        std::ofstream out(output, std::ios::trunc);
+        out << "{\"index\":5,\"id\":\"q5\",\"ok\":true,\"content\":\"old\"}\n";
+        out << "{\"index\":0,\"id\":\"q0\",\"ok\":true,\"content\":\"old\"}\n";
+        out << "{\"index\":2,\"id\":\"q2\",\"ok\"";
+    }
+    auto checkOutput = [&](int expectedOk)
+    {
+        std::ifstream out(output);
+        std::string line;
+        std::set<uint64_t> indices;
+        uint64_t prev = 0;
+        int ok = 0;
+        while (std::getline(out, line))
+        {
+            Json::Value root;
+            Json::CharReaderBuilder builder;
+            std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+            std::string errs;
+            EXPECT_TRUE(reader->parse(line.data(), line.data() + line.size(), &root, &errs)) << line;
+            EXPECT_TRUE(indices.insert(root["index"].asUInt64()).second) << line;
+            if (indices.size() > 1)
+                EXPECT_GT(root["index"].asUInt64(), prev) << line; // 按输入顺序
+            prev = root["index"].asUInt64();
+            ok += root["ok"].asBool();
+        }
+        ASSERT_EQ(indices.size(), static_cast<size_t>(kLines));
+        ASSERT_EQ(*indices.rbegin(), static_cast<uint64_t>(kLines - 1));
+        ASSERT_EQ(ok, expectedOk);
+    };
+
+    auto provider = std::make_shared<ai_chat_sdk::DeepSeekProvider>();
+    ASSERT_TRUE(provider->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}}));
+    ai_chat_sdk::BatchOptions options;
+    options._concurrency = 4;
+    options._maxAttempts = 1;
+    ai_chat_sdk::BatchReport report;
+    ASSERT_TRUE(ai_chat_sdk::BatchRunner(provider, options).run(input, output, report));
+    ASSERT_EQ(report._total, static_cast<uint64_t>(kLines));
+    ASSERT_EQ(report._skipped, 2u);
+    ASSERT_EQ(report._succeeded, static_cast<uint64_t>(kLines - 4));
+    ASSERT_EQ(report._failed, 2u); // 无法解析的第 7 行与第 9 行
+    ASSERT_GT(report.tokensPerSec(), 0.0);
+    checkOutput(kLines - 2);
+
+    // Batch API 模式：整批上传，轮询完成后下载结果
+    options._useBatchApi = true;
+    options._resume = false;
+    options._batchEndpoint = server.endpoint();
+    options._apiKey = "mock-key";
+    options._pollIntervalSec = 0;
+    ASSERT_TRUE(ai_chat_sdk::BatchRunner(provider, options).run(input, output, report));
+    ASSERT_EQ(server.batchesCreated(), 1u);
+    ASSERT_EQ(report._succeeded, static_cast<uint64_t>(kLines - 2));
+    ASSERT_EQ(report._failed, 2u);
+    checkOutput(kLines - 2);
+}
+
+// 测试用例：续跑时连续的已完成行多于重排窗口，有序模式下读取不会卡住
+TEST(BatchRunnerTest, resumePastReorderWindow)
+{
+    const std::string text = "批处理回复";
+    ai_chat_sdk_test::MockLLMServer server({ai_chat_sdk_test::makeSyntheticTrace(text, 8, 1, 5)});
+    ASSERT_GT(server.start(), 0);
+
+    const int kLines = 40;
+    const int kDone = 20; // 前 20 行已完成，连续的已完成行多于窗口 (4)
+    const std::string input = testing::TempDir() + "batch_window_input.jsonl";
+    const std::string output = testing::TempDir() + "batch_window_output.jsonl";
+    {
+        std::ofstream in(input, std::ios::trunc);
+        for (int i = 0; i < kLines; ++i)
+            in << "{\"id\":\"q" << i << "\",\"prompt\":\"问题 " << i << "\"}\n";
+        std::ofstream out(output, std::ios::trunc);
+        for (int i = 0; i < kDone; ++i)
+            out << "{\"index\":" << i << ",\"id\":\"q" << i << "\",\"ok\":true,\"content\":\"old\"}\n";
+    }
+
+    auto provider = std::make_shared<ai_chat_sdk::DeepSeekProvider>();
+    ASSERT_TRUE(provider->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}}));
+    ai_chat_sdk::BatchOptions options;
+    options._concurrency = 1;
+    options._maxAttempts = 1;
+    options._reorderWindow = 4;
+    ai_chat_sdk::BatchReport report;
+    ASSERT_TRUE(ai_chat_sdk::BatchRunner(provider, options).run(input, output, report));
+    ASSERT_EQ(report._skipped, static_cast<uint64_t>(kDone));
+    ASSERT_EQ(report._succeeded, static_cast<uint64_t>(kLines - kDone));
+
+    // 输出按输入顺序覆盖全部行
+    std::ifstream out(output);
+    std::string line;
+    uint64_t expected = 0;
+    while (std::getline(out, line))
+    {
+        Json::Value root;
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        std::string errs;
+        ASSERT_TRUE(reader->parse(line.data(), line.data() + line.size(), &root, &errs)) << line;
+        ASSERT_EQ(root["index"].asUInt64(), expected++) << line;
+    }
+    ASSERT_EQ(expected, static_cast<uint64_t>(kLines));
+}
+
+// 测试用例：HNSW 近似最近邻——SIMD 点积与标量一致，删除与槽位复用后召回率仍与暴力搜索接近
+TEST(HnswIndexTest, recallAgainstBruteForce)
+{
+    const size_t kDim = 64;
+    const size_t kCount = 2000;
+    std::mt19937 rng(7);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    auto randomVector = [&]()
+    {
+        std::vector<float> vec(kDim);
+        for (auto &x : vec)
+            x = normal(rng);
+        ai_chat_sdk::vecmath::normalize(vec.data(), vec.size());
+        return vec;
+    };
+
+    std::vector<std::vector<float>> vectors;
+    ai_chat_sdk::HnswIndex index(kDim, kCount);
+    for (size_t i = 0; i < kCount; ++i)
+    {
+        vectors.push_back(randomVector());
+        index.add(static_cast<uint32_t>(i), vectors.back().data());
+    }
+    ASSERT_NEAR(ai_chat_sdk::vecmath::dot(vectors[0].data(), vectors[1].data(), kDim),
+                ai_chat_sdk::vecmath::dotScalar(vectors[0].data(), vectors[1].data(), kDim), 1e-5);
+
+    // 删除一部分并在原槽位写入新向量
+    for (size_t i = 0; i < kCount; i += 10)
+        index.remove(static_cast<uint32_t>(i));
+    for (size_t i = 0; i < kCount; i += 20)
+    {
+        vectors[i] = randomVector();
+        index.add(static_cast<uint32_t>(i), vectors[i].data());
+    }
+    ASSERT_EQ(index.size(), kCount - kCount / 20);
+
+    const size_t kQueries = 100;
+    const size_t kTopK = 10;
+    size_t found = 0;
+    for (size_t q = 0; q < kQueries; ++q)
+    {
+        std::vector<float> query = randomVector();
+        std::vector<std::pair<float, uint32_t>> exact;
+        for (uint32_t slot = 0; slot < kCount; ++slot)
+        {
+            if (index.contains(slot))
+                exact.emplace_back(1.0f - ai_chat_sdk::vecmath::dotScalar(query.data(), vectors[slot].data(), kDim), slot);
+        }
+        std::partial_sort(exact.begin(), exact.begin() + kTopK, exact.end());
+        std::set<uint32_t> truth;
+        for (size_t i = 0; i < kTopK; ++i)
+            truth.insert(exact[i].second);
+        for (const auto &result : index.search(query.data(), kTopK, 128))
+            found += truth.count(result.second);
+    }
+    ASSERT_GT(static_cast<double>(found) / (kQueries * kTopK), 0.9);
+}
+
+// 测试用例：语义缓存——相近的问题命中且不再访问模型，上下文不同不命中，容量淘汰与快照恢复
+TEST(SemanticCacheTest, hitEvictAndSnapshot)
+{
+    const std::string text = "北京今天晴，最高气温二十五度。";
+    ai_chat_sdk_test::MockLLMServer server({ai_chat_sdk_test::makeSyntheticTrace(text, 8, 1, 5)});
+    ASSERT_GT(server.start(), 0);
+
+    // 本地哈希向量只反映字面相似度，阈值相应放低
+    auto embedding = std::make_shared<ai_chat_sdk::HashEmbeddingProvider>(256);
+    ai_chat_sdk::SemanticCacheOptions options;
+    options._threshold = 0.75f;
+    options._capacity = 2;
+    auto provider = std::make_shared<ai_chat_sdk::SemanticCacheProvider>(std::make_shared<ai_chat_sdk::DeepSeekProvider>(), embedding, options);
+    ASSERT_TRUE(provider->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}}));
+
+    std::vector<ai_chat_sdk::Message> first = {{"user", "今天北京的天气怎么样？"}};
+    std::vector<ai_chat_sdk::Message> paraphrase = {{"user", "今天北京天气怎么样"}};
+    ASSERT_EQ(provider->sendMessage(first, {}), text);
+    ASSERT_EQ(server.requestCount(), 1u);
+
+    // 改写后的问题命中，流式接口一次性下发缓存的回复
+    std::string streamed;
+    int finals = 0;
+    auto onChunk = [&](const std::string &chunk, bool last)
+    {
+        streamed += chunk;
+        finals += last;
+    };
+    ASSERT_EQ(provider->sendMessageStream(paraphrase, {}, onChunk), text);
+    ASSERT_EQ(streamed, text);
+    ASSERT_EQ(finals, 1);
+    ASSERT_EQ(server.requestCount(), 1u);
+
+    // 对话历史不同、显式关闭缓存时都会访问模型
+    std::vector<ai_chat_sdk::Message> withHistory = {{"system", "你是旅行助手"}, {"user", "今天北京天气怎么样"}};
+    ASSERT_EQ(provider->sendMessage(withHistory, {}), text);
+    ASSERT_EQ(provider->sendMessage(paraphrase, {{"semantic_cache", "false"}}), text);
+    ASSERT_EQ(server.requestCount(), 3u);
+
+    // 容量为 2：第三个不同的问题淘汰最久未使用的条目
+    ASSERT_EQ(provider->sendMessage({{"user", "如何用C++实现快速排序"}}, {}), text);
+    auto stats = provider->stats();
+    ASSERT_EQ(stats._hits, 1u);
+    ASSERT_EQ(stats._inserts, 3u);
+    ASSERT_EQ(stats._evictions, 1u);
+    ASSERT_EQ(stats._entries, 2u);
+    ASSERT_GE(stats.meanHitSimilarity(), 0.75);
+
+    // 快照恢复后仍能命中
+    const std::string snapshot = testing::TempDir() + "semantic_cache.bin";
+    ASSERT_TRUE(provider->saveSnapshot(snapshot));
+    auto restored = std::make_shared<ai_chat_sdk::SemanticCacheProvider>(std::make_shared<ai_chat_sdk::DeepSeekProvider>(), embedding, options);
+    ASSERT_TRUE(restored->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}, {"semantic_cache_snapshot", snapshot}}));
+    ASSERT_EQ(restored->stats()._entries, 2u);
+    ASSERT_EQ(restored->sendMessage({{"user", "怎么用C++实现快速排序？"}}, {}), text);
+    ASSERT_EQ(server.requestCount(), 4u);
+    ASSERT_FALSE(restored->cache().load(snapshot, "hash:128"));
+
+    // scope 隔离：其他 scope 中更近的条目不会挡住本 scope 的条目 (小 scope 精确扫描，大 scope 扩大搜索范围)
+    {
+        const size_t kDim = 16;
+        ai_chat_sdk::SemanticCacheOptions scoped;
+        scoped._threshold = 0.9f;
+        scoped._capacity = 1000;
+        ai_chat_sdk::SemanticCache cache(kDim, scoped);
+        std::mt19937 rng(11);
+        std::normal_distribution<float> noise(0.0f, 1.0f);
+        std::vector<float> query(kDim, 0.0f);
+        query[0] = 1.0f;
+        auto near = [&](float scale)
+        {
+            std::vector<float> vec = query;
+            for (auto &x : vec)
+                x += noise(rng) * scale;
+            return vec;
+        };
+        for (int i = 0; i < 400; ++i)
+            cache.insert(1, near(0.01f), "a" + std::to_string(i), "scope1");
+        cache.insert(2, near(0.1f), "b", "scope2");
+        std::string response;
+        ASSERT_TRUE(cache.lookup(2, query, response));
+        ASSERT_EQ(response, "scope2");
+        for (int i = 0; i < 300; ++i)
+            cache.insert(3, near(0.1f), "c" + std::to_string(i), "scope3");
+        ASSERT_TRUE(cache.lookup(3, query, response));
+        ASSERT_EQ(response, "scope3");
+        ASSERT_FALSE(cache.lookup(4, query, response));
+
+        // 阈值可在使用中调整，条目保留
+        cache.setThreshold(0.999999f);
+        ASSERT_FALSE(cache.lookup(2, query, response));
+        ASSERT_EQ(cache.size(), 701u);
+
+        // 快照中损坏的长度字段不会触发巨量分配
+        const std::string corrupted = testing::TempDir() + "semantic_cache_corrupted.bin";
+        {
+            std::ofstream out(corrupted, std::ios::binary | std::ios::trunc);
+            const char magic[8] = {'A', 'I', 'S', 'C', 'A', 'C', 'H', '1'};
+            const std::string name = "test";
+            uint32_t dim = kDim;
+            uint32_t nameSize = name.size();
+            uint64_t count = 1;
+            uint64_t scope = 1;
+            uint32_t hugeSize = 0xFFFFFFFFu;
+            out.write(magic, sizeof(magic));
+            out.write(reinterpret_cast<const char *>(&dim), sizeof(dim));
+            out.write(reinterpret_cast<const char *>(&nameSize), sizeof(nameSize));
+            out.write(name.data(), name.size());
+            out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+            out.write(reinterpret_cast<const char *>(&scope), sizeof(scope));
+            out.write(reinterpret_cast<const char *>(&hugeSize), sizeof(hugeSize));
+        }
+        ASSERT_FALSE(cache.load(corrupted, "test"));
+    }
+}
+
+// 测试用例：超时策略——首 token 超时、总预算与空闲超时都能及时放弃慢上游，BatchRunner 的重试共享同一预算
+TEST(DeadlineTest, abandonSlowUpstream)
+{
+    // 首块 1.5 秒后到达，之后每 50 毫秒一块
+    const std::string text = "慢上游的回复会被提前放弃，调用方可以尽快切换到其他模型。";
+    ai_chat_sdk_test::MockLLMServer server({ai_chat_sdk_test::makeSyntheticTrace(text, 3, 50, 1500)});
+    ASSERT_GT(server.start(), 0);
+    auto provider = std::make_shared<ai_chat_sdk::DeepSeekProvider>();
+    ASSERT_TRUE(provider->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}}));
+
+    std::vector<ai_chat_sdk::Message> messages = {{"user", "你好"}};
+    std::string streamed;
+    int finals = 0;
+    auto onChunk = [&](const std::string &chunk, bool last)
+    {
+        streamed += chunk;
+        finals += last;
+    };
+    auto elapsedMs = [](std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+    uint64_t timedOut = ai_chat_sdk::RequestDeadline::timedOutRequests();
+
+    // 首 token 超时：很快返回空串，结束回调只触发一次
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(provider->sendMessageStream(messages, {{"first_token_timeout_ms", "200"}}, onChunk), "");
+    ASSERT_LT(elapsedMs(start), 1000);
+    ASSERT_EQ(finals, 1);
+
+    // 总预算：收到部分增量后放弃，返回已收到的内容
+    streamed.clear();
+    finals = 0;
+    start = std::chrono::steady_clock::now();
+    std::string partial = provider->sendMessageStream(messages, {{"timeout_ms", "2000"}}, onChunk);
+    ASSERT_LT(elapsedMs(start), 2500);
+    ASSERT_FALSE(partial.empty());
+    ASSERT_LT(partial.size(), text.size());
+    ASSERT_EQ(partial, streamed);
+    ASSERT_EQ(finals, 1);
+
+    // 全量接口与空闲超时
+    start = std::chrono::steady_clock::now();
+    ASSERT_EQ(provider->sendMessage(messages, {{"timeout_ms", "300"}}), "");
+    ASSERT_EQ(provider->sendMessageStream(messages, {{"idle_timeout_ms", "500"}}, nullptr), "");
+    ASSERT_LT(elapsedMs(start), 1500);
+    ASSERT_EQ(ai_chat_sdk::RequestDeadline::timedOutRequests(), timedOut + 4);
+
+    // 预算充足时正常完成
+    ASSERT_EQ(provider->sendMessageStream(messages, {{"timeout_ms", "10000"}, {"first_token_timeout_ms", "3000"}}, nullptr), text);
+
+    // BatchRunner：单行预算覆盖所有重试与退避
+    const std::string input = testing::TempDir() + "deadline_input.jsonl";
+    const std::string output = testing::TempDir() + "deadline_output.jsonl";
+    {
+        std::ofstream in(input, std::ios::trunc);
+        in << "{\"id\":\"slow\",\"prompt\":\"你好\"}\n";
+    }
+    ai_chat_sdk::BatchOptions options;
+    options._concurrency = 1;
+    options._resume = false;
+    options._maxAttempts = 3;
+    options._retryBackoffMs = 100;
+    options._requestTimeoutMs = 700;
+    ai_chat_sdk::BatchReport report;
+    start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(ai_chat_sdk::BatchRunner(provider, options).run(input, output, report));
+    ASSERT_LT(elapsedMs(start), 1500);
+    ASSERT_EQ(report._failed, 1u);
+}
+
+// 测试用例：上传进度刷新空闲计时；传输成功时不报告超时
+TEST(DeadlineTest, uploadProgressAndCompletedTransfer)
+{
+    uint64_t timedOut = ai_chat_sdk::RequestDeadline::timedOutRequests();
+    {
+        ai_chat_sdk::TimeoutPolicy policy;
+        policy._idleMs = 200;
+        ai_chat_sdk::RequestDeadline deadline(policy, nullptr);
+        ai_chat_sdk::HttpRequest request;
+        deadline.apply(request);
+        ASSERT_TRUE(request._onUploadProgress);
+
+        // 持续上传 600 毫秒，总时长超过空闲超时也不会被中止
+        for (int i = 0; i < 12; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            request._onUploadProgress();
+        }
+        ASSERT_FALSE(deadline.token()->isCancelled());
+
+        // 之后没有数据往来才超时
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        ASSERT_TRUE(deadline.token()->isCancelled());
+        ASSERT_STREQ(deadline.expired(false), "idle timeout");
+        ASSERT_STREQ(deadline.expired(false), "idle timeout");
+    }
+    {
+        // 截止时间边缘完整收到的响应照常返回，不计入超时
+        ai_chat_sdk::TimeoutPolicy policy;
+        policy._totalMs = 50;
+        ai_chat_sdk::RequestDeadline deadline(policy, nullptr);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT_EQ(deadline.expired(true), nullptr);
+    }
+    ASSERT_EQ(ai_chat_sdk::RequestDeadline::timedOutRequests(), timedOut + 1);
+}
+
+// 测试用例：同一个 Provider 在并发请求期间热更新配置
+TEST(ProviderConfigTest, hotRotateUnderLoad)
+{
+    const std::string text = "配置热更新期间进行中的请求继续使用旧快照。";
+    ai_chat_sdk_test::MockLLMServer server({ai_chat_sdk_test::makeSyntheticTrace(text, 8, 1, 5)});
+    ASSERT_GT(server.start(), 0);
+
+    auto provider = std::make_shared<ai_chat_sdk::DeepSeekProvider>();
+    ASSERT_FALSE(provider->rotateApiKey("mock-key-0"));
+    ASSERT_EQ(provider->configVersion(), 0u);
+    std::map<std::string, std::string> config = {{"api_key", "mock-key"}, {"endpoint", server.endpoint()}};
+    ASSERT_TRUE(provider->initModel(config));
+    ASSERT_EQ(provider->configVersion(), 1u);
+
+    // 多个线程共享同一个实例，另一个线程不断轮换密钥并重新初始化
+    const int kCallers = 6;
+    std::atomic<int> failed{0};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kCallers; ++i)
+    {
+        threads.emplace_back([&, i]()
+                             {
+            std::vector<ai_chat_sdk::Message> messages = {{"user", "问题 " + std::to_string(i)}};
+            for (int j = 0; j < 20; ++j)
+            {
+                std::string reply = j % 2 ? provider->sendMessageStream(messages, {}, nullptr) : provider->sendMessage(messages, {});
+                if (reply != text)
+                    failed++;
+            } });
+    }
+    std::thread rotator([&]()
+                        {
+        for (int n = 0; !stop; ++n)
+        {
+            if (n % 4 == 3)
+                provider->initModel(config);
+            else
+                provider->rotateApiKey("mock-key-" + std::to_string(n));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } });
+    for (auto &thread : threads)
+        thread.join();
+    stop = true;
+    rotator.join();
+    ASSERT_EQ(failed.load(), 0);
+    ASSERT_GT(provider->configVersion(), 1u);
+
+    // 初始化失败时保留原有配置
+    ASSERT_FALSE(provider->initModel({{"endpoint", server.endpoint()}}));
+    ASSERT_TRUE(provider->isAvailable());
+    ASSERT_EQ(provider->sendMessage({{"user", "你好"}}, {}), text);
+
+    // 装饰器把密钥轮换转发给被包装的模型
+    uint64_t version = provider->configVersion();
+    ai_chat_sdk::SingleFlightProvider singleFlight(provider);
+    ASSERT_TRUE(singleFlight.rotateApiKey("mock-key-sf"));
+    ASSERT_EQ(provider->configVersion(), version + 1);
+}
+
+namespace
+{
+    // 只读取配置快照的 Provider：sendMessage 取得快照后等待放行，模拟进行中的请求
+    class SnapshotProbeProvider : public ai_chat_sdk::LLMProvider
+    {
+    public:
+        bool initModel(const std::map<std::string, std::string> &modelConfig) override
+        {
+            auto config = std::make_shared<ai_chat_sdk::ProviderConfig>();
+            config->_apiKey = modelConfig.at("api_key");
+            publishConfig(config);
+            _isAvailable = true;
+            return true;
+        }
+        bool isAvailable() const override { return _isAvailable; }
+        std::string getModelName() const override { return "snapshot-probe"; }
+        std::string getModelDesc() const override { return "snapshot probe"; }
+        std::string sendMessage(const std::vector<ai_chat_sdk::Message> &, const std::map<std::string, std::string> &,
+                                ai_chat_sdk::CancelTokenPtr = nullptr, ai_chat_sdk::TokenUsage * = nullptr) override
+        {
+            ai_chat_sdk::ProviderConfigPtr snapshot = config();
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _started = true;
+                _cond.notify_all();
+                _cond.wait(lock, [this]()
+                           { return _released; });
+            }
+            return snapshot->_apiKey;
+        }
+        std::string sendMessageStream(const std::vector<ai_chat_sdk::Message> &messages, const std::map<std::string, std::string> &requestParam,
+                                      std::function<void(const std::string &, bool)>, ai_chat_sdk::CancelTokenPtr = nullptr,
+                                      ai_chat_sdk::TokenUsage * = nullptr) override
+        {
+            return sendMessage(messages, requestParam);
+        }
+
+        // 当前线程读到的快照 (经过线程本地缓存)
+        ai_chat_sdk::ProviderConfigPtr snapshot() const { return config(); }
+
+        void waitStarted()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [this]()
+                       { return _started; });
+        }
+        void release()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _released = true;
+            _cond.notify_all();
+        }
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        bool _started = false;
+        bool _released = false;
+    };
+}
+
+// 测试用例：进行中的请求在密钥轮换后继续使用旧密钥，线程本地缓存不延长快照的生命周期
+TEST(ProviderConfigTest, inflightKeepsOldKey)
+{
+    auto provider = std::make_shared<SnapshotProbeProvider>();
+    ASSERT_TRUE(provider->initModel({{"api_key", "old-key"}}));
+    ASSERT_EQ(provider->snapshot()->_apiKey, "old-key");
+
+    // 1. 请求取得快照后轮换密钥：进行中的请求仍使用旧密钥，之后的请求使用新密钥
+    std::string inflightKey;
+    std::thread caller([&]()
+                       { inflightKey = provider->sendMessage({{"user", "你好"}}, {}); });
+    provider->waitStarted();
+    ASSERT_TRUE(provider->rotateApiKey("new-key"));
+    ASSERT_EQ(provider->snapshot()->_apiKey, "new-key");
+    provider->release();
+    caller.join();
+    ASSERT_EQ(inflightKey, "old-key");
+
+    // 2. 被替换的快照不再被请求使用时立即释放，即使当前线程的缓存中还有它的记录
+    std::weak_ptr<const ai_chat_sdk::ProviderConfig> current = provider->snapshot();
+    ASSERT_FALSE(current.expired());
+    ASSERT_TRUE(provider->rotateApiKey("newer-key"));
+    ASSERT_TRUE(current.expired());
+
+    // 3. Provider 析构后缓存不再持有快照
+    current = provider->snapshot();
+    provider.reset();
+    ASSERT_TRUE(current.expired());
+}
+
+// 测试用例：大文档按引用发送，请求体流式转义后与内联发送逐字节一致
+TEST(StreamingBodyTest, mappedDocumentMatchesInline)
+{
+    // 1. 数据源每次只返回 1~3 字节，转义序列与 \r\n 跨块拆分
+    const std::string text = "引号\"反斜杠\\\r\n制表\t控制\x01结尾\r";
+    auto source = std::make_shared<ai_chat_sdk::CallbackSource>([&text](uint64_t offset, char *buf, size_t len) -> ssize_t
+                                                                {
+        size_t count = std::min<size_t>({len, text.size() - std::min<size_t>(offset, text.size()), 1 + offset % 3});
+        std::memcpy(buf, text.data() + offset, count);
+        return static_cast<ssize_t>(count); });
+    for (auto layout : {ai_chat_sdk::RequestLayout::Default, ai_chat_sdk::RequestLayout::CacheAware})
+    {
+        std::vector<ai_chat_sdk::Message> inlined = {{"system", "摘要"}, {"user", text}};
+        std::vector<ai_chat_sdk::Message> referenced = inlined;
+        referenced[1]._content.clear();
+        referenced[1]._contentSource = source;
+
+        ai_chat_sdk::JsonWriter expected;
+        ASSERT_TRUE(ai_chat_sdk::writeMessages(expected, inlined, layout));
+        ai_chat_sdk::JsonWriter skeleton;
+        std::vector<ai_chat_sdk::BodySplice> splices;
+        ASSERT_TRUE(ai_chat_sdk::writeMessages(skeleton, referenced, layout, &splices));
+        ASSERT_EQ(splices.size(), 1u);
+
+        auto body = std::make_shared<ai_chat_sdk::StreamingBody>(std::string(skeleton.view()), splices);
+        ai_chat_sdk::StreamingBody::Reader reader(body);
+        std::string streamed;
+        char buf[5];
+        for (size_t step = 1;; ++step)
+        {
+            ssize_t n = reader.read(buf, 1 + step % sizeof(buf));
+            ASSERT_GE(n, 0);
+            if (n == 0)
+                break;
+            streamed.append(buf, static_cast<size_t>(n));
+        }
+        ASSERT_EQ(streamed, std::string(expected.view()));
+    }
+
+    // 数据源读取失败：不记录插入点时整段读入，读取失败不能写出截断的文档
+    auto broken = std::make_shared<ai_chat_sdk::CallbackSource>([](uint64_t offset, char *buf, size_t len) -> ssize_t
+                                                                {
+        if (offset > 0)
+            return -1;
+        size_t count = std::min<size_t>(len, 4);
+        std::memset(buf, 'x', count);
+        return static_cast<ssize_t>(count); });
+    ai_chat_sdk::Message truncated("user");
+    truncated._contentSource = broken;
+    ai_chat_sdk::JsonWriter incomplete;
+    ASSERT_FALSE(ai_chat_sdk::writeMessages(incomplete, {truncated}, ai_chat_sdk::RequestLayout::Default));
+
+    // 2. 映射文件经 chunked 编码发给模型服务，服务端还原出的请求体与内联发送时相同
+    const std::string path = testing::TempDir() + "streaming_body_document.txt";
+    std::string document;
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        for (int i = 0; i < 20000; ++i)
+            document += "第" + std::to_string(i) + "段 \"引用\"\t内容\r\n";
+        out << document;
+    }
+    auto mapped = ai_chat_sdk::MappedFileSource::open(path);
+    ASSERT_TRUE(mapped);
+    ASSERT_EQ(mapped->size(), static_cast<int64_t>(document.size()));
+    ASSERT_FALSE(ai_chat_sdk::MappedFileSource::open(path + ".missing"));
+
+    // 发送期间文件被截断：读取返回错误，而不是访问失效的映射页面 (SIGBUS)
+    {
+        const std::string shrinking = testing::TempDir() + "streaming_body_truncated.txt";
+        {
+            std::ofstream out(shrinking, std::ios::binary | std::ios::trunc);
+            out << std::string(256 * 1024, 'a');
+        }
+        auto truncated = ai_chat_sdk::MappedFileSource::open(shrinking);
+        ASSERT_TRUE(truncated);
+        ai_chat_sdk::JsonWriter skeleton;
+        std::vector<ai_chat_sdk::BodySplice> splices;
+        ai_chat_sdk::Message doc("user");
+        doc._contentSource = truncated;
+        ASSERT_TRUE(ai_chat_sdk::writeMessages(skeleton, {doc}, ai_chat_sdk::RequestLayout::Default, &splices));
+        ai_chat_sdk::StreamingBody::Reader reader(std::make_shared<ai_chat_sdk::StreamingBody>(std::string(skeleton.view()), splices));
+        char buf[4096];
+        ASSERT_GT(reader.read(buf, sizeof(buf)), 0);
+        ASSERT_EQ(::truncate(shrinking.c_str(), 1024), 0);
+        ssize_t n = 0;
+        while ((n = reader.read(buf, sizeof(buf))) > 0)
+        {
+        }
+        ASSERT_EQ(n, -1);
+        char raw[16];
+        ASSERT_EQ(truncated->read(200 * 1024, raw, sizeof(raw)), -1);
+        ASSERT_EQ(truncated->read(0, raw, sizeof(raw)), 16);
+    }
+
+    const std::string reply = "文档的要点如下。";
+    ai_chat_sdk_test::MockLLMServer server({ai_chat_sdk_test::makeSyntheticTrace(reply, 8, 1, 5)});
+    ASSERT_GT(server.start(), 0);
+    auto provider = std::make_shared<ai_chat_sdk::DeepSeekProvider>();
+    ASSERT_TRUE(provider->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}}));
+
+    ai_chat_sdk::Message question("user");
+    question._contentSource = mapped;
+    ASSERT_EQ(provider->sendMessage({question}, {}), reply);
+    std::string streamedBody = server.lastRequestBody();
+    ASSERT_EQ(provider->sendMessage({{"user", document}}, {}), reply);
+    ASSERT_EQ(streamedBody, server.lastRequestBody());
+
+    // 3. 带外部内容的流式请求：请求体边读边发，响应仍逐个增量交付
+    int deltas = 0;
+    int finals = 0;
+    std::string streamed;
+    ASSERT_EQ(provider->sendMessageStream({question}, {}, [&](const std::string &chunk, bool last)
+                                          {
+        if (!chunk.empty())
+            ++deltas;
+        streamed += chunk;
+        finals += last; }),
+              reply);
+    ASSERT_GT(deltas, 1);
+    ASSERT_EQ(finals, 1);
+    ASSERT_EQ(streamed, reply);
+}
+
+// 测试用例：增量 JSON 解析——任意切分的增量得到相同事件，字段与数组元素在根对象结束前即可拿到
+TEST(JsonStreamParserTest, incrementalEvents)
+{
+    const std::string reply = "```json\n{\"title\": \"\\u6458\\u8981 \\ud83d\\ude00\", \"items\": [{\"id\": 1, \"ok\": true}, "
+                              "{\"id\": -2.5e1, \"note\": null}], \"a/b\": [], \"text\": \"\\\"\\\\\\n\"}\n```";
+    auto collect = [&reply](size_t step, std::vector<std::string> &events)
+    {
+        ai_chat_sdk::JsonStreamParser parser([&events](const ai_chat_sdk::JsonEvent &event)
+                                             {
+            if (event._type != ai_chat_sdk::JsonEventType::StringPart)
+                events.push_back(std::to_string(static_cast<int>(event._type)) + " " + std::string(event._path) + " " +
+                                 std::string(event._key) + "#" + std::to_string(event._index) + " " + std::string(event._text)); });
+        for (size_t offset = 0; offset < reply.size(); offset += step)
+            EXPECT_TRUE(parser.feed(std::string_view(reply).substr(offset, step)));
+        EXPECT_TRUE(parser.finish());
+        EXPECT_TRUE(parser.done());
+    };
+
+    // 1. 整块输入与逐字节输入 (切开 \uXXXX、数字与字面量) 的事件序列一致
+    std::vector<std::string> whole, bytewise;
+    collect(reply.size(), whole);
+    collect(1, bytewise);
+    ASSERT_EQ(whole, bytewise);
+    ASSERT_EQ(whole.front(), "0  #-1 ");
+    ASSERT_EQ(whole[1], "5 /title title#-1 摘要 😀");
+    ASSERT_EQ(whole[3], "0 /items/0 #0 ");
+    ASSERT_EQ(whole[4], "5 /items/0/id id#-1 1");
+    ASSERT_EQ(whole[9], "5 /items/1/note note#-1 null");
+    ASSERT_EQ(whole[14], "5 /text text#-1 \"\\\n");
+
+    // 2. 经 sendMessageStream：第一个元素在整个响应结束之前回调，长字符串逐段到达
+    ai_chat_sdk_test::MockLLMServer server({ai_chat_sdk_test::makeSyntheticTrace(
+        "{\"items\": [{\"id\": 1}, {\"id\": 2}], \"summary\": \"流式解析可以更早拿到结果。\"}", 6, 30, 5)});
+    ASSERT_GT(server.start(), 0);
+    auto provider = std::make_shared<ai_chat_sdk::DeepSeekProvider>();
+    ASSERT_TRUE(provider->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}}));
+
+    std::vector<int64_t> ids;
+    size_t deltasAtFirstItem = 0, deltas = 0, summaryParts = 0;
+    std::string summary;
+    auto parser = std::make_shared<ai_chat_sdk::JsonStreamParser>([&](const ai_chat_sdk::JsonEvent &event)
+                                                                  {
+        if (event._type == ai_chat_sdk::JsonEventType::EndObject && event._depth == 2)
+        {
+            if (ids.empty())
+                deltasAtFirstItem = deltas;
+            ids.push_back(event._index);
+        }
+        if (event._type == ai_chat_sdk::JsonEventType::StringPart && event._key == "summary")
+        {
+            ++summaryParts;
+            summary += event._text;
+        } });
+    auto onChunk = ai_chat_sdk::streamJsonCallback(parser, [&deltas](const std::string &chunk, bool)
+                                                   { deltas += chunk.empty() ? 0 : 1; });
+    provider->sendMessageStream({{"user", "列出条目"}}, {}, onChunk);
+    ASSERT_TRUE(parser->done()) << parser->error();
+    ASSERT_EQ(ids, (std::vector<int64_t>{0, 1}));
+    ASSERT_LT(deltasAtFirstItem, deltas);
+    ASSERT_EQ(summary, "流式解析可以更早拿到结果。");
+    ASSERT_GT(summaryParts, 1u);
+
+    // 3. 语法错误：报告位置，之后的输入被忽略；reset 后可解析下一个响应
+    parser->reset();
+    ASSERT_FALSE(parser->feed("{\"a\": tru3}"));
+    ASSERT_TRUE(parser->failed());
+    ASSERT_NE(parser->error().find("offset 9"), std::string::npos);
+    parser->reset();
+    ASSERT_TRUE(parser->feed("[1, 2"));
+    ASSERT_FALSE(parser->finish());
+}
+
+// 测试用例：传输层选择——未编译 nghttp2 或配置未知时回退到 httplib
+TEST(HttpTransportTest, createTransport)
+{
+    ASSERT_EQ(ai_chat_sdk::createTransport("httplib", "https://api.deepseek.com")->name(), "httplib");
+    ASSERT_EQ(ai_chat_sdk::createTransport("unknown", "https://api.deepseek.com")->name(), "httplib");
+    ASSERT_EQ(ai_chat_sdk::createTransport("reactor", "https://api.deepseek.com")->name(), "reactor");
+#ifdef CHATSDK_WITH_NGHTTP2
+    ASSERT_EQ(ai_chat_sdk::createTransport("http2", "https://api.deepseek.com")->name(), "http2");
+#else
+    ASSERT_EQ(ai_chat_sdk::createTransport("http2", "https://api.deepseek.com")->name(), "httplib");
+#endif
+}
+
+// 测试用例：epoll 传输——同一个 Provider 换成 reactor 后行为一致，大量并发流由少量循环线程驱动
+TEST(MockLLMServerTest, reactorTransport)
+{
+    const std::string text = "流式响应是指模型边生成边返回结果。";
+    ai_chat_sdk_test::MockServerConfig config;
+    config._threads = 256; // 200 个并发流各占一个服务端线程
+    ai_chat_sdk_test::MockLLMServer server({ai_chat_sdk_test::makeSyntheticTrace(text, 6, 20, 20)}, config);
+    ASSERT_GT(server.start(), 0);
+
+    auto provider = std::make_shared<ai_chat_sdk::DeepSeekProvider>();
+    ASSERT_TRUE(provider->initModel({{"api_key", "mock-key"}, {"endpoint", server.endpoint()}, {"transport", "reactor"}}));
+
+    std::vector<ai_chat_sdk::Message> messages = {{"user", "hello"}};
+    ASSERT_EQ(provider->sendMessage(messages, {}), text);
+    ASSERT_EQ(provider->sendMessageStream(messages, {}, nullptr), text);
+
+    // 异步接口：并发发起请求，不额外占用线程
+    auto transport = ai_chat_sdk::createTransport("reactor", server.endpoint());
+    const int count = 200;
+    std::atomic<int> okCount{0};
+    std::atomic<int> doneCount{0};
+    std::vector<ai_chat_sdk::HttpResponsePtr> responses;
+    for (int i = 0; i < count; ++i)
+    {
+        ai_chat_sdk::HttpRequest request;
+        request._path = "/chat/completions";
+        request._body = R"({"stream": true})";
+        auto response = std::make_shared<ai_chat_sdk::HttpResponse>();
+        responses.push_back(response);
+        transport->sendAsync(request, response, nullptr, [&, response](bool ok)
+                             {
+            if (ok && response->_status == 200 && !response->_body.empty())
+                ++okCount;
+            ++doneCount; }, nullptr);
+    }
+    while (doneCount.load() < count)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(okCount.load(), count);
+
+    // Provider 层异步流式接口：SSE 解析与回调都在事件循环线程上完成
+    std::atomic<int> streamOk{0};
+    std::atomic<int> streamDone{0};
+    for (int i = 0; i < count; ++i)
+    {
+        auto received = std::make_shared<std::string>();
+        provider->sendMessageStreamAsync(
+            messages, {}, [received](const std::string &delta, bool)
+            { *received += delta; },
+            [&, received](const std::string &fullResponse, const ai_chat_sdk::TokenUsage &)
+            {
+                if (fullResponse == text && *received == text)
+                    ++streamOk;
+                ++streamDone; });
+    }
+    while (streamDone.load() < count)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(streamOk.load(), count);
+
+    // 读空闲超时由时间轮触发
+    ai_chat_sdk::HttpRequest idle;
+    idle._path = "/chat/completions";
+    idle._body = R"({"stream": true})";
+    idle._readTimeoutSec = 1;
+    ai_chat_sdk_test::MockServerConfig stallConfig;
+    stallConfig._stallRate = 1.0;
+    stallConfig._stallMs = 3000;
+    ai_chat_sdk_test::MockLLMServer stallServer({ai_chat_sdk_test::makeSyntheticTrace(text)}, stallConfig);
+    ASSERT_GT(stallServer.start(), 0);
+    ai_chat_sdk::HttpResponse idleResponse;
+    ASSERT_FALSE(ai_chat_sdk::createTransport("reactor", stallServer.endpoint())->send(idle, idleResponse, nullptr, nullptr));
+    ASSERT_EQ(idleResponse._error, "read timeout");
+}
+
+// 测试用例：HTTP/2 多路复用——需要 h2 服务，设置 CHATSDK_H2_TEST_ENDPOINT (如 http://127.0.0.1:8443) 后运行
+TEST(HttpTransportTest, http2Multiplexing)
+{
+#ifndef CHATSDK_WITH_NGHTTP2
+    GTEST_SKIP() << "built without CHATSDK_WITH_NGHTTP2";
+#else
+    const char *endpoint = std::getenv("CHATSDK_H2_TEST_ENDPOINT");
+    if (endpoint == nullptr)
+    {
+        GTEST_SKIP() << "CHATSDK_H2_TEST_ENDPOINT not set";
+    }
+
+    ai_chat_sdk::TransportOptions options;
+    options._maxConnections = 1;
+    auto transport = ai_chat_sdk::createTransport("http2", endpoint, options);
+
+    // 并发请求共享同一条连接
+    std::vector<std::thread> workers;
+    std::atomic<int> okCount{0};
+    for (int i = 0; i < 8; ++i)
+    {
+        workers.emplace_back([&]()
+                             {
+            ai_chat_sdk::HttpRequest request;
+            request._method = "GET";
+            request._path = "/";
+            ai_chat_sdk::HttpResponse response;
+            if (transport->send(request, response, nullptr, nullptr) && response._status > 0)
+                ++okCount; });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    ASSERT_EQ(okCount.load(), 8);
+    ASSERT_EQ(std::static_pointer_cast<ai_chat_sdk::Http2Transport>(transport)->connectionCount(), 1u);
+#endif
+}
+
 // 主函数：初始化环境并运行所有测试
 int main(int argc, char **argv)
 {